@@ -256,6 +256,154 @@ static Result bench_unorderedmap(const Workload<KEY>& w) {
     return res;
 }
 
+static int iters_for(size_t n);
+static const char* fmt_n(size_t n, char* buf, size_t sz);
+
+// ==========================================================================
+// Interleaved lookups: plain loop vs find_batch vs coroutines by depth
+// ==========================================================================
+
+static constexpr size_t DEPTHS[] = {1, 2, 4, 8, 16, 32};
+static constexpr int N_DEPTHS = sizeof(DEPTHS) / sizeof(DEPTHS[0]);
+
+struct InterleaveResult {
+    double loop_ms;
+    double batch_ms;
+    double find_co_ms[N_DEPTHS];
+    double lb_loop_ms;
+    double lb_co_ms[N_DEPTHS];
+};
+
+template<typename KEY>
+static InterleaveResult bench_interleave(const Workload<KEY>& w) {
+    InterleaveResult res{};
+    gteitelbaum::kntrie<KEY, uint64_t> trie;
+    for (auto k : w.keys) trie.insert(k, static_cast<uint64_t>(k));
+
+    const auto& keys = w.find1_keys;
+    size_t n = keys.size();
+    std::vector<const uint64_t*> out(n);
+    std::vector<typename gteitelbaum::kntrie<KEY, uint64_t>::const_iterator> its(n);
+
+    auto timed = [&](auto&& body) {
+        double best = 1e30;
+        for (int r = 0; r < RUNS; ++r) {
+            double t0 = now_ms();
+            for (int i = 0; i < w.find_iters; ++i) body();
+            best = std::min(best, (now_ms() - t0) / w.find_iters);
+        }
+        return best;
+    };
+    auto sum_out = [&] {
+        uint64_t s = 0;
+        for (auto* v : out) s += v ? *v : 0;
+        do_not_optimize(s);
+    };
+
+    res.loop_ms = timed([&] {
+        for (size_t i = 0; i < n; ++i) out[i] = trie.find_value(keys[i]);
+        sum_out();
+    });
+    res.batch_ms = timed([&] {
+        trie.find_batch(keys.data(), n, out.data());
+        sum_out();
+    });
+    for (int d = 0; d < N_DEPTHS; ++d) {
+        res.find_co_ms[d] = timed([&] {
+            gteitelbaum::interleave_run(n, [&](size_t i) {
+                return trie.find_co(keys[i], out[i]);
+            }, DEPTHS[d]);
+            sum_out();
+        });
+    }
+
+    res.lb_loop_ms = timed([&] {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += trie.lower_bound(keys[i]).value();
+        do_not_optimize(s);
+    });
+    for (int d = 0; d < N_DEPTHS; ++d) {
+        res.lb_co_ms[d] = timed([&] {
+            gteitelbaum::interleave_run(n, [&](size_t i) {
+                return trie.lower_bound_co(keys[i], its[i]);
+            }, DEPTHS[d]);
+            uint64_t s = 0;
+            for (auto& it : its) s += it.value();
+            do_not_optimize(s);
+        });
+    }
+    return res;
+}
+
+template<typename KEY>
+static void run_interleave(size_t n, bool print_hdr) {
+    std::mt19937_64 rng(42);
+    auto w = make_workload<KEY>(n, "random", iters_for(n), rng);
+    auto r = bench_interleave(w);
+
+    if (print_hdr) {
+        std::printf("| N | op | loop | batch |");
+        for (auto d : DEPTHS) std::printf(" co%zu |", d);
+        std::printf("\n|---|----|------|-------|");
+        for (int d = 0; d < N_DEPTHS; ++d) std::printf("-----|");
+        std::printf("\n");
+    }
+    char nlabel[32];
+    fmt_n(w.keys.size(), nlabel, sizeof(nlabel));
+    std::printf("| %s | find | %.2f | %.2f |", nlabel, r.loop_ms, r.batch_ms);
+    for (int d = 0; d < N_DEPTHS; ++d) std::printf(" %.2f |", r.find_co_ms[d]);
+    std::printf("\n| | lower_bound | %.2f | |", r.lb_loop_ms);
+    for (int d = 0; d < N_DEPTHS; ++d) std::printf(" %.2f |", r.lb_co_ms[d]);
+    std::printf("\n");
+}
+
+// ==========================================================================
+// Boundary churn: PREFIXES subtrees of `fill` keys each; every round
+// inserts one fresh key per subtree and erases it again. At fill =
+// COMPACT_MAX the insert splits the leaf, so the erase is where a
+// coalesce would rebuild it.
+// ==========================================================================
+
+static constexpr size_t CHURN_PREFIXES = 256;
+static constexpr int    CHURN_ROUNDS   = 20;
+
+// Subtree = prefix; an odd multiplier spreads i over the low 16 bits
+static uint64_t churn_key(size_t prefix, size_t i) {
+    return (uint64_t(prefix) << 16) | uint16_t(i * 40503u);
+}
+
+// ns per insert + erase pair
+static double bench_boundary_churn(size_t fill) {
+    gteitelbaum::kntrie<uint64_t, uint64_t> trie;
+    for (size_t p = 0; p < CHURN_PREFIXES; ++p)
+        for (size_t i = 0; i < fill; ++i)
+            trie.insert(churn_key(p, i), i);
+
+    double best = 1e30;
+    for (int r = 0; r < RUNS; ++r) {
+        double t0 = now_ms();
+        for (int round = 0; round < CHURN_ROUNDS; ++round) {
+            for (size_t p = 0; p < CHURN_PREFIXES; ++p) {
+                uint64_t k = churn_key(p, fill + round);
+                trie.insert(k, k);
+                trie.erase(k);
+            }
+        }
+        best = std::min(best, now_ms() - t0);
+    }
+    do_not_optimize(trie.size());
+    return best * 1e6 / (CHURN_ROUNDS * CHURN_PREFIXES);
+}
+
+static void run_boundary_churn() {
+    const size_t fills[] = {gteitelbaum::COMPACT_MAX / 4, gteitelbaum::COMPACT_MAX * 3 / 4,
+                            gteitelbaum::COMPACT_MAX - 1, gteitelbaum::COMPACT_MAX};
+    std::printf("| keys per subtree | ns per insert+erase |\n");
+    std::printf("|------------------|---------------------|\n");
+    for (auto f : fills)
+        std::printf("| %zu | %.0f |\n", f, bench_boundary_churn(f));
+}
+
 static void md_header() {
     std::printf("| N | | F | I | M | B | E | C2 | F2 | M2 | B2 |\n");
     std::printf("|---|-|---|---|---|---|---|----|----|----|----|\n");
@@ -484,6 +632,23 @@ int main(int argc, char** argv) {
         return entries;
     };
 
+    std::printf("## Interleaved lookups: uint64_t \xe2\x80\x94 random\n\n");
+    std::printf("ms per pass over N keys (all hits). loop = one call per key, "
+                "batch = find_batch, coD = coroutines via interleave_run at depth D.\n\n");
+    bool first_il = true;
+    for (auto n : sizes) {
+        run_interleave<uint64_t>(n, first_il);
+        first_il = false;
+    }
+    std::printf("\n");
+
+    std::printf("## Boundary churn: uint64_t\n\n");
+    std::printf("%zu subtrees; each pair inserts a fresh key into one and erases it. "
+                "At %zu keys the insert splits the leaf; the erase must not coalesce "
+                "it straight back.\n\n", CHURN_PREFIXES, gteitelbaum::COMPACT_MAX);
+    run_boundary_churn();
+    std::printf("\n");
+
     auto u64_summary = build_summary(u64_results);
     auto i32_summary = build_summary(i32_results);
 
@@ -2,19 +2,30 @@
 #define KNTRIE_HPP
 
 #include "kntrie_impl.hpp"
+#include "kntrie_epoch.hpp"
 #include <stdexcept>
 #include <iterator>
 #include <vector>
 
 namespace gteitelbaum {
 
-template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>>
+template<typename KEY, typename VALUE, typename ALLOC, typename AGG = no_aggregate_t>
+class kntrie_snapshot;
+
+// AGG (see kntrie_support.hpp) opts in to range_aggregate(), e.g.
+// kntrie<uint64_t, int64_t, std::allocator<uint64_t>, sum_aggregate_t<int64_t>>.
+// Values are then only changed through the trie: no operator[] or
+// mutable at().
+template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>,
+         typename AGG = no_aggregate_t>
 class kntrie {
+    friend class kntrie_snapshot<KEY, VALUE, ALLOC, AGG>;
+
     static_assert(std::is_integral_v<KEY> && sizeof(KEY) >= 2,
                   "KEY must be integral and at least 16 bits");
 
     using UK     = std::make_unsigned_t<KEY>;
-    using impl_t = kntrie_impl<UK, VALUE, ALLOC>;
+    using impl_t = kntrie_impl<UK, VALUE, ALLOC, AGG>;
 
     static constexpr UK SIGN_BIT = std::is_signed_v<KEY>
         ? (UK(1) << (sizeof(KEY) * 8 - 1)) : UK(0);
@@ -33,47 +44,53 @@ public:
     using size_type       = std::size_t;
     using difference_type = std::ptrdiff_t;
     using allocator_type  = ALLOC;
+    using aggregate_type  = typename AGG::type;
 
     // ==================================================================
-    // Iterator — snapshot-based, bidirectional
+    // Iterator — leaf cursor + parent stack, bidirectional.
+    // ++/-- step within the current leaf; only a leaf boundary climbs.
+    // Any insert/erase invalidates all iterators.
     // ==================================================================
 
     class const_iterator {
         friend class kntrie;
-        const impl_t* parent_v = nullptr;
-        UK    ukey_v{};
-        VALUE value_v{};
-        bool  is_valid_v = false;
+        friend class kntrie_snapshot<KEY, VALUE, ALLOC, AGG>;
+        using cursor_t = typename impl_t::cursor_t;
 
-        const_iterator(const impl_t* p, UK uk, VALUE v, bool valid)
-            : parent_v(p), ukey_v(uk), value_v(v), is_valid_v(valid) {}
+        const impl_t* parent_v = nullptr;
+        cursor_t      cursor_v{};
+        bool          is_valid_v = false;
 
-        static const_iterator from_result(const impl_t* p,
-                                           const typename impl_t::iter_result_t& r) {
-            return const_iterator(p, r.key, r.value, r.found);
-        }
+        explicit const_iterator(const impl_t* p) : parent_v(p) {}
 
     public:
+        // Deref yields a proxy pair: key by value, VALUE by reference into
+        // the leaf slot (via value_traits::as_ptr). No VALUE copies.
         using iterator_category = std::bidirectional_iterator_tag;
         using value_type        = std::pair<const KEY, VALUE>;
         using difference_type   = std::ptrdiff_t;
-        using pointer           = const std::pair<const KEY, VALUE>*;
-        using reference         = const std::pair<const KEY, VALUE>&;
+        using reference         = std::pair<const KEY, const VALUE&>;
 
-        const_iterator() = default;
+        struct arrow_proxy_t {
+            reference ref_v;
+            const reference* operator->() const noexcept { return &ref_v; }
+        };
+        using pointer = arrow_proxy_t;
 
-        KEY          key()   const noexcept { return from_unsigned(ukey_v); }
-        const VALUE& value() const noexcept { return value_v; }
+        const_iterator() = default;
 
-        std::pair<const KEY, VALUE> operator*() const noexcept {
-            return {from_unsigned(ukey_v), value_v};
+        KEY key() const noexcept {
+            return from_unsigned(impl_t::cursor_key(cursor_v));
+        }
+        const VALUE& value() const noexcept {
+            return impl_t::cursor_value(cursor_v);
         }
 
+        reference operator*()  const noexcept { return {key(), value()}; }
+        pointer   operator->() const noexcept { return {**this}; }
+
         const_iterator& operator++() {
-            auto r = parent_v->iter_next(ukey_v);
-            ukey_v  = r.key;
-            value_v = r.value;
-            is_valid_v = r.found;
+            is_valid_v = impl_t::cursor_next(cursor_v);
             return *this;
         }
 
@@ -84,11 +101,8 @@ public:
         }
 
         const_iterator& operator--() {
-            auto r = is_valid_v ? parent_v->iter_prev(ukey_v)
-                                : parent_v->iter_last();
-            ukey_v     = r.key;
-            value_v    = r.value;
-            is_valid_v = r.found;
+            is_valid_v = is_valid_v ? impl_t::cursor_prev(cursor_v)
+                                    : parent_v->cursor_last(cursor_v);
             return *this;
         }
 
@@ -98,10 +112,25 @@ public:
             return tmp;
         }
 
+        // Move n entries (either way) in O(depth) rather than n steps.
+        // Past the last entry gives end(); before the first is undefined.
+        const_iterator& advance(difference_type n) {
+            if (n == 0) return *this;
+            if (!is_valid_v) {
+                if (n > 0) return *this;
+                is_valid_v = parent_v->cursor_last(cursor_v);
+                if (++n == 0 || !is_valid_v) return *this;
+            }
+            is_valid_v = impl_t::cursor_advance(cursor_v, n);
+            return *this;
+        }
+
         bool operator==(const const_iterator& o) const noexcept {
             if (!is_valid_v && !o.is_valid_v) return true;
             if (is_valid_v != o.is_valid_v) return false;
-            return ukey_v == o.ukey_v;
+            // Same leaf shares the upper key bytes
+            return cursor_v.leaf == o.cursor_v.leaf &&
+                   cursor_v.entry.key == o.cursor_v.entry.key;
         }
 
         bool operator!=(const const_iterator& o) const noexcept {
@@ -127,20 +156,16 @@ public:
         return *this;
     }
 
-    kntrie(const kntrie& o) {
-        for (auto [k, v] : o)
-            impl_.insert(to_unsigned(k), v);
-    }
+    // Copies each node block once; no per-key re-insertion
+    kntrie(const kntrie& o) : impl_(o.impl_) {}
 
     kntrie& operator=(const kntrie& o) {
-        if (this != &o) {
-            impl_.clear();
-            for (auto [k, v] : o)
-                impl_.insert(to_unsigned(k), v);
-        }
+        impl_ = o.impl_;
         return *this;
     }
 
+    kntrie clone() const { return kntrie(*this); }
+
     void swap(kntrie& o) noexcept { impl_.swap(o.impl_); }
     friend void swap(kntrie& a, kntrie& b) noexcept { a.swap(b); }
 
@@ -165,27 +190,58 @@ public:
         auto [ok, ins] = impl_.insert(to_unsigned(kv.first), kv.second);
         return {iterator{}, ins};
     }
+    std::pair<iterator, bool> insert(value_type&& kv) {
+        auto [ok, ins] = impl_.insert(to_unsigned(kv.first), std::move(kv.second));
+        return {iterator{}, ins};
+    }
     std::pair<bool, bool> insert(const KEY& key, const VALUE& value) {
         return impl_.insert(to_unsigned(key), value);
     }
-    std::pair<bool, bool> insert_or_assign(const KEY& key, const VALUE& value) {
-        return impl_.insert_or_assign(to_unsigned(key), value);
+    std::pair<bool, bool> insert(const KEY& key, VALUE&& value) {
+        return impl_.insert(to_unsigned(key), std::move(value));
+    }
+    template<typename M = VALUE>
+    std::pair<bool, bool> insert_or_assign(const KEY& key, M&& value) {
+        return impl_.insert_or_assign(to_unsigned(key), std::forward<M>(value));
     }
-    std::pair<bool, bool> assign(const KEY& key, const VALUE& value) {
-        return impl_.assign(to_unsigned(key), value);
+    template<typename M = VALUE>
+    std::pair<bool, bool> assign(const KEY& key, M&& value) {
+        return impl_.assign(to_unsigned(key), std::forward<M>(value));
     }
+
+    // Read-modify-write in one descent: update_fn(VALUE&) on the existing
+    // value, or insert make_fn() if key is absent. Returns {true, inserted}.
+    template<typename MakeFn, typename UpdateFn>
+    std::pair<bool, bool> upsert(const KEY& key, MakeFn&& make_fn, UpdateFn&& update_fn) {
+        return impl_.upsert(to_unsigned(key), std::forward<MakeFn>(make_fn),
+                            std::forward<UpdateFn>(update_fn));
+    }
+
+    // emplace(k, v) forwards v straight into the trie's value storage;
+    // other argument forms go through a value_type temporary.
     template<typename... Args>
     std::pair<iterator, bool> emplace(Args&&... args) {
-        value_type kv(std::forward<Args>(args)...);
-        return insert(kv);
+        if constexpr (sizeof...(Args) == 2) {
+            return [this](auto&& k, auto&& v) -> std::pair<iterator, bool> {
+                auto [ok, ins] = impl_.insert(to_unsigned(KEY(k)),
+                                              std::forward<decltype(v)>(v));
+                return {iterator{}, ins};
+            }(std::forward<Args>(args)...);
+        } else {
+            value_type kv(std::forward<Args>(args)...);
+            return insert(std::move(kv));
+        }
     }
 
+    // VALUE is constructed from args in place, only when key is absent.
+    // The iterator comes from an exact descent, not a lower_bound seek.
     template<typename... Args>
     std::pair<iterator, bool> try_emplace(const KEY& key, Args&&... args) {
-        if (contains(key)) return {find(key), false};
-        VALUE v(std::forward<Args>(args)...);
-        auto [ok, ins] = impl_.insert(to_unsigned(key), v);
-        return {find(key), ins};
+        UK uk = to_unsigned(key);
+        auto [ok, ins] = impl_.insert(uk, std::forward<Args>(args)...);
+        iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_find(it.cursor_v, uk);
+        return {it, ins};
     }
 
     iterator insert(const_iterator, const value_type& kv) { return insert(kv).first; }
@@ -196,24 +252,67 @@ public:
         for (; first != last; ++first) insert(*first);
     }
 
+    // Replace contents with (key, value) pairs given in ascending key
+    // order (duplicates keep the first). Built bottom-up in one pass with
+    // exactly sized leaves instead of one insert per entry. Order is
+    // only checked by a debug assert. If a value copy throws, the trie
+    // is left empty.
+    template<typename InputIt>
+    void assign_sorted(InputIt first, InputIt last) {
+        if constexpr (std::random_access_iterator<InputIt>) {
+            impl_.assign_sorted(static_cast<size_t>(last - first),
+                [&](size_t i) { return to_unsigned(first[i].first); },
+                [&](size_t i) -> const VALUE& { return first[i].second; });
+        } else {
+            std::vector<value_type> buf(first, last);
+            assign_sorted(buf.begin(), buf.end());
+        }
+    }
+
+    template<typename InputIt>
+    static kntrie from_sorted(InputIt first, InputIt last) {
+        kntrie t;
+        t.assign_sorted(first, last);
+        return t;
+    }
+
+    // Insert n (key, value) pairs with keys ascending. Runs of keys that
+    // land in the same leaf are merged into it in one pass. Existing keys
+    // are left unchanged. Returns the number inserted.
+    size_type insert_sorted_batch(const KEY* keys, const VALUE* values, size_t n) {
+        return impl_.insert_sorted_batch(n,
+            [&](size_t i) { return to_unsigned(keys[i]); },
+            [&](size_t i) -> const VALUE& { return values[i]; });
+    }
+
+    // Erase n keys given in ascending order. Each leaf holding hits is
+    // compacted once. Returns the number erased.
+    size_type erase_sorted_batch(const KEY* keys, size_t n) {
+        return impl_.erase_sorted_batch(n,
+            [&](size_t i) { return to_unsigned(keys[i]); });
+    }
+
     void clear() noexcept { impl_.clear(); }
     size_type erase(const KEY& key) { return impl_.erase(to_unsigned(key)) ? 1 : 0; }
 
+    // Erase may restructure leaves, so the result is re-seeked.
     iterator erase(const_iterator pos) {
         KEY k = pos.key();
-        auto next = pos;
-        ++next;
         impl_.erase(to_unsigned(k));
-        return next;
+        return lower_bound(k);
     }
 
+    // Subtrees wholly inside [first, last) are freed without visiting
+    // their keys; only the two boundary paths are rebuilt.
     iterator erase(const_iterator first, const_iterator last) {
-        std::vector<KEY> keys;
-        for (auto it = first; it != last; ++it)
-            keys.push_back(it.key());
-        for (auto k : keys)
-            impl_.erase(to_unsigned(k));
-        return last;
+        bool has_last = last.is_valid_v;
+        KEY last_key = has_last ? last.key() : KEY{};
+        if (first != last) {
+            UK hi = has_last ? UK(to_unsigned(last_key) - 1)
+                             : static_cast<UK>(~UK(0));
+            impl_.erase_range(to_unsigned(first.key()), hi);
+        }
+        return has_last ? lower_bound(last_key) : end();
     }
 
     // ==================================================================
@@ -222,24 +321,28 @@ public:
 
     const VALUE* find_value(const KEY& key) const noexcept { return impl_.find_value(to_unsigned(key)); }
     bool contains(const KEY& key) const noexcept { return impl_.contains(to_unsigned(key)); }
+
+    // out[i] = find_value(keys[i]). Lookups descend in small groups with
+    // child prefetches, so independent DRAM misses overlap.
+    void find_batch(const KEY* keys, size_t n, const VALUE** out) const noexcept {
+        impl_.find_batch(n, [&](size_t i) { return to_unsigned(keys[i]); }, out);
+    }
     size_type count(const KEY& key) const noexcept { return contains(key) ? 1 : 0; }
 
-    VALUE& operator[](const KEY& key) {
-        UK uk = to_unsigned(key);
-        const VALUE* v = impl_.find_value(uk);
-        if (v) return const_cast<VALUE&>(*v);
-        impl_.insert(uk, VALUE{});
-        return const_cast<VALUE&>(*impl_.find_value(uk));
+    // One descent, hit or miss; a miss value-initialises in place.
+    // Not for bool, which is stored as bits.
+    VALUE& operator[](const KEY& key) requires (!HAS_AGG<AGG> && !std::is_same_v<VALUE, bool>) {
+        return impl_.value_ref(to_unsigned(key));
     }
     const VALUE& at(const KEY& key) const {
         const VALUE* v = impl_.find_value(to_unsigned(key));
         if (!v) throw std::out_of_range("kntrie::at: key not found");
         return *v;
     }
-    VALUE& at(const KEY& key) {
-        const VALUE* v = impl_.find_value(to_unsigned(key));
+    VALUE& at(const KEY& key) requires (!HAS_AGG<AGG> && !std::is_same_v<VALUE, bool>) {
+        VALUE* v = impl_.find_value_mut(to_unsigned(key));
         if (!v) throw std::out_of_range("kntrie::at: key not found");
-        return const_cast<VALUE&>(*v);
+        return *v;
     }
 
     // ==================================================================
@@ -247,12 +350,12 @@ public:
     // ==================================================================
 
     const_iterator begin() const noexcept {
-        return const_iterator::from_result(&impl_, impl_.iter_first());
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_first(it.cursor_v);
+        return it;
     }
     const_iterator end() const noexcept {
-        const_iterator it;
-        it.parent_v = &impl_;
-        return it;
+        return const_iterator(&impl_);
     }
     const_iterator cbegin() const noexcept { return begin(); }
     const_iterator cend()   const noexcept { return end(); }
@@ -262,34 +365,137 @@ public:
     const_reverse_iterator crbegin() const noexcept { return rbegin(); }
     const_reverse_iterator crend()   const noexcept { return rend(); }
 
+    // Exact descent: a miss stops at the first absent byte, with no
+    // seek to the next key
     const_iterator find(const KEY& key) const noexcept {
-        UK uk = to_unsigned(key);
-        const VALUE* v = impl_.find_value(uk);
-        if (!v) return end();
-        return const_iterator(&impl_, uk, *v, true);
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_find(it.cursor_v, to_unsigned(key));
+        return it;
     }
 
     const_iterator lower_bound(const KEY& k) const noexcept {
-        UK uk = to_unsigned(k);
-        const VALUE* v = impl_.find_value(uk);
-        if (v) return const_iterator(&impl_, uk, *v, true);
-        auto r = impl_.iter_next(uk);
-        return const_iterator::from_result(&impl_, r);
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_lower_bound(it.cursor_v, to_unsigned(k));
+        return it;
     }
 
     const_iterator upper_bound(const KEY& k) const noexcept {
-        auto r = impl_.iter_next(to_unsigned(k));
-        return const_iterator::from_result(&impl_, r);
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_upper_bound(it.cursor_v, to_unsigned(k));
+        return it;
+    }
+
+    // Coroutine forms for interleave_run(): each lookup suspends after
+    // prefetching its next node so several can overlap DRAM misses.
+    // The trie must not be modified and out must stay alive until done.
+    lookup_task_t find_co(const KEY& key, const VALUE*& out) const {
+        return impl_.find_co(to_unsigned(key), &out);
+    }
+
+    lookup_task_t lower_bound_co(const KEY& key, const_iterator& out) const {
+        out = const_iterator(&impl_);
+        return impl_.lower_bound_co(to_unsigned(key), &out.cursor_v,
+                                     &out.is_valid_v);
     }
 
     std::pair<const_iterator, const_iterator> equal_range(const KEY& k) const noexcept {
         return {lower_bound(k), upper_bound(k)};
     }
 
+    // ==================================================================
+    // Order statistics — O(depth) from the per-bitmask descendant counts
+    // ==================================================================
+
+    // Number of keys < k
+    size_type rank(const KEY& k) const noexcept {
+        return impl_.rank(to_unsigned(k));
+    }
+
+    // The i-th smallest entry (0-based); end() if i >= size()
+    const_iterator select(size_type i) const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_select(it.cursor_v, i);
+        return it;
+    }
+
+    // Number of keys in [lo, hi]. Subtrees wholly inside are counted
+    // from their bitmask totals; only the two boundary leaves are searched.
+    size_type count_range(const KEY& lo, const KEY& hi) const noexcept {
+        if (hi < lo) return 0;
+        return impl_.template count_range<true>(to_unsigned(lo), to_unsigned(hi));
+    }
+
+    // count_range without the boundary leaf searches: each boundary leaf
+    // contributes in proportion to the part of its key span inside the
+    // range, as if its keys were evenly spread. Exact when every leaf
+    // the range touches lies wholly inside it.
+    size_type estimate_range(const KEY& lo, const KEY& hi) const noexcept {
+        if (hi < lo) return 0;
+        return impl_.template count_range<false>(to_unsigned(lo), to_unsigned(hi));
+    }
+
+    // ==================================================================
+    // Aggregates — with an AGG, each bitmask keeps the fold of every
+    // child subtree
+    // ==================================================================
+
+    // AGG fold of the values with keys in [lo, hi]; AGG::identity() if
+    // none. Whole subtrees come from their parents' aggregates; only the
+    // two boundary leaves are scanned.
+    aggregate_type range_aggregate(const KEY& lo, const KEY& hi) const noexcept
+        requires HAS_AGG<AGG> {
+        if (hi < lo) return AGG::identity();
+        return impl_.range_aggregate(to_unsigned(lo), to_unsigned(hi));
+    }
+
+    // ==================================================================
+    // Sampling — each draw is one weighted descent, O(depth)
+    // ==================================================================
+
+    // A uniformly random entry; end() if empty
+    template<typename RNG>
+    const_iterator sample(RNG& rng) const {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_sample(it.cursor_v, rng);
+        return it;
+    }
+
+    // k independent draws (with replacement); empty if the trie is empty
+    template<typename RNG>
+    std::vector<const_iterator> sample_n(RNG& rng, size_type k) const {
+        std::vector<const_iterator> out;
+        if (empty()) return out;
+        out.reserve(k);
+        for (size_type i = 0; i < k; ++i) out.push_back(sample(rng));
+        return out;
+    }
+
+    // ==================================================================
+    // Snapshot: O(1) read-only point-in-time view sharing every node with
+    // this trie. Later writes here copy the nodes on their path before
+    // changing them, so the view never changes. A copied leaf copies its
+    // values, out-of-line ones by copy construction. Sorted batches copy
+    // the paths of their keys; a range erase copies its two boundary
+    // paths and lets go of the shared subtrees between them uncopied.
+    // ==================================================================
+
+    kntrie_snapshot<KEY, VALUE, ALLOC, AGG> snapshot() {
+        return kntrie_snapshot<KEY, VALUE, ALLOC, AGG>(impl_);
+    }
+
     // ==================================================================
     // Debug / Stats
     // ==================================================================
 
+    // Live payload, not footprint: bytes in this object and in the live
+    // node and value blocks of its allocator, each counted at the size
+    // of the slab bin it was taken from. That includes nodes shared with
+    // live snapshots, nodes only snapshots still hold, and those of
+    // dropped snapshots until the next write releases them, so an
+    // emptied trie with snapshots out can still report kilobytes. Freed
+    // blocks waiting in the slab bins, unused mega-chunk space and the
+    // snapshot owner map are not counted. Without snapshots it equals
+    // debug_stats().total_bytes plus the out-of-line value blocks.
     size_t memory_usage() const noexcept { return impl_.memory_usage(); }
     auto   debug_stats() const noexcept  { return impl_.debug_stats(); }
     auto   debug_root_info() const       { return impl_.debug_root_info(); }
@@ -301,6 +507,295 @@ private:
     impl_t impl_;
 };
 
+// ==========================================================================
+// kntrie_snapshot — read-only view returned by kntrie::snapshot().
+//
+// It may be read, and dropped, on any thread while the source trie keeps
+// writing. Its nodes live in the source trie's allocator; if the source
+// is destroyed or assigned over first, that allocator stays alive until
+// the last of its snapshots is dropped. Move-only.
+// ==========================================================================
+
+template<typename KEY, typename VALUE, typename ALLOC, typename AGG>
+class kntrie_snapshot {
+    using trie_t = kntrie<KEY, VALUE, ALLOC, AGG>;
+    using impl_t = typename trie_t::impl_t;
+    friend trie_t;
+
+    explicit kntrie_snapshot(impl_t& src)
+        : impl_(src.share_root()), cow_v(src.cow_state()) {}
+
+public:
+    using key_type               = KEY;
+    using mapped_type            = VALUE;
+    using value_type             = typename trie_t::value_type;
+    using size_type              = std::size_t;
+    using aggregate_type         = typename trie_t::aggregate_type;
+    using const_iterator         = typename trie_t::const_iterator;
+    using iterator               = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator       = const_reverse_iterator;
+
+    kntrie_snapshot(kntrie_snapshot&&) noexcept = default;
+    kntrie_snapshot& operator=(kntrie_snapshot&& o) noexcept {
+        if (this != &o) {
+            release();
+            impl_ = std::move(o.impl_);
+            cow_v = std::move(o.cow_v);
+        }
+        return *this;
+    }
+    kntrie_snapshot(const kntrie_snapshot&) = delete;
+    kntrie_snapshot& operator=(const kntrie_snapshot&) = delete;
+    ~kntrie_snapshot() { release(); }
+
+    [[nodiscard]] bool      empty() const noexcept { return impl_.empty(); }
+    [[nodiscard]] size_type size()  const noexcept { return impl_.size(); }
+
+    const VALUE* find_value(const KEY& key) const noexcept {
+        return impl_.find_value(trie_t::to_unsigned(key));
+    }
+    bool contains(const KEY& key) const noexcept { return find_value(key) != nullptr; }
+    size_type count(const KEY& key) const noexcept { return contains(key) ? 1 : 0; }
+    const VALUE& at(const KEY& key) const {
+        const VALUE* v = find_value(key);
+        if (!v) throw std::out_of_range("kntrie_snapshot::at: key not found");
+        return *v;
+    }
+
+    const_iterator begin() const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_first(it.cursor_v);
+        return it;
+    }
+    const_iterator end() const noexcept { return const_iterator(&impl_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend()   const noexcept { return end(); }
+
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend()   const noexcept { return const_reverse_iterator(begin()); }
+
+    const_iterator find(const KEY& key) const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_find(it.cursor_v, trie_t::to_unsigned(key));
+        return it;
+    }
+    const_iterator lower_bound(const KEY& k) const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_lower_bound(it.cursor_v, trie_t::to_unsigned(k));
+        return it;
+    }
+    const_iterator upper_bound(const KEY& k) const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_upper_bound(it.cursor_v, trie_t::to_unsigned(k));
+        return it;
+    }
+    std::pair<const_iterator, const_iterator> equal_range(const KEY& k) const noexcept {
+        return {lower_bound(k), upper_bound(k)};
+    }
+
+    size_type rank(const KEY& k) const noexcept {
+        return impl_.rank(trie_t::to_unsigned(k));
+    }
+    const_iterator select(size_type i) const noexcept {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_select(it.cursor_v, i);
+        return it;
+    }
+    size_type count_range(const KEY& lo, const KEY& hi) const noexcept {
+        if (hi < lo) return 0;
+        return impl_.template count_range<true>(trie_t::to_unsigned(lo),
+                                                trie_t::to_unsigned(hi));
+    }
+    size_type estimate_range(const KEY& lo, const KEY& hi) const noexcept {
+        if (hi < lo) return 0;
+        return impl_.template count_range<false>(trie_t::to_unsigned(lo),
+                                                 trie_t::to_unsigned(hi));
+    }
+    aggregate_type range_aggregate(const KEY& lo, const KEY& hi) const noexcept
+        requires HAS_AGG<AGG> {
+        if (hi < lo) return AGG::identity();
+        return impl_.range_aggregate(trie_t::to_unsigned(lo), trie_t::to_unsigned(hi));
+    }
+    template<typename RNG>
+    const_iterator sample(RNG& rng) const {
+        const_iterator it(&impl_);
+        it.is_valid_v = impl_.cursor_sample(it.cursor_v, rng);
+        return it;
+    }
+    template<typename RNG>
+    std::vector<const_iterator> sample_n(RNG& rng, size_type k) const {
+        std::vector<const_iterator> out;
+        if (empty()) return out;
+        out.reserve(k);
+        for (size_type i = 0; i < k; ++i) out.push_back(sample(rng));
+        return out;
+    }
+
+private:
+    void release() noexcept {
+        if (cow_v) impl_.release_view(*cow_v);
+        cow_v.reset();
+    }
+
+    impl_t impl_;
+    std::shared_ptr<cow_state_t> cow_v;
+};
+
+// ==========================================================================
+// kntrie_concurrent — one writer thread, any number of lock-free readers.
+//
+// Readers see a published kntrie_snapshot through read(); every write
+// goes to the writer's trie, which copies the nodes on its path instead
+// of changing them (see kntrie_cow.hpp), then publishes a new snapshot
+// with a release store. A replaced snapshot is retired to the epoch
+// domain and freed by the writer once no reader can still be in it.
+//
+// Write members must be called from one thread at a time; read() from
+// any thread. A single write copies one root-to-leaf path, the leaf's
+// values included: values stored out of line are copy-constructed, so
+// one insert into a full leaf of strings copies up to COMPACT_MAX of
+// them. update() publishes once for many writes, and nodes it has
+// already copied are not copied again. Sorted batches copy the paths of
+// their keys; a range erase copies its two boundary paths.
+// ==========================================================================
+
+template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>>
+class kntrie_concurrent {
+    using trie_t = kntrie<KEY, VALUE, ALLOC>;
+
+public:
+    using key_type      = KEY;
+    using mapped_type   = VALUE;
+    using size_type     = std::size_t;
+    using snapshot_type = kntrie_snapshot<KEY, VALUE, ALLOC>;
+
+    // Pins the published snapshot; it and iterators into it stay valid
+    // until the guard is destroyed. Keep guards short: a live guard holds
+    // back reclamation of every later-retired snapshot.
+    class read_guard {
+        friend class kntrie_concurrent;
+
+        read_guard(const kntrie_concurrent& c)
+            : domain_v(&c.domain_v), slot_v(c.domain_v.enter()),
+              snap_v(c.current_v.load(std::memory_order_seq_cst)) {}
+
+    public:
+        read_guard(read_guard&& o) noexcept
+            : domain_v(std::exchange(o.domain_v, nullptr)),
+              slot_v(o.slot_v), snap_v(o.snap_v) {}
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+        ~read_guard() { if (domain_v) domain_v->leave(slot_v); }
+
+        const snapshot_type& operator*()  const noexcept { return *snap_v; }
+        const snapshot_type* operator->() const noexcept { return snap_v; }
+
+    private:
+        epoch_domain_t*      domain_v;
+        size_t               slot_v;
+        const snapshot_type* snap_v;
+    };
+
+    kntrie_concurrent() { publish(); }
+
+    kntrie_concurrent(const kntrie_concurrent&) = delete;
+    kntrie_concurrent& operator=(const kntrie_concurrent&) = delete;
+
+    // No reader may be inside a read_guard
+    ~kntrie_concurrent() {
+        for (auto& [snap, epoch] : retired_v) delete snap;
+        delete current_v.load(std::memory_order_relaxed);
+    }
+
+    // ==================================================================
+    // Readers
+    // ==================================================================
+
+    read_guard read() const noexcept { return read_guard(*this); }
+
+    // ==================================================================
+    // Writer
+    // ==================================================================
+
+    std::pair<bool, bool> insert(const KEY& key, const VALUE& value) {
+        return write([&](trie_t& t) { return t.insert(key, value); });
+    }
+    std::pair<bool, bool> insert(const KEY& key, VALUE&& value) {
+        return write([&](trie_t& t) { return t.insert(key, std::move(value)); });
+    }
+    template<typename M>
+    std::pair<bool, bool> insert_or_assign(const KEY& key, M&& value) {
+        return write([&](trie_t& t) { return t.insert_or_assign(key, std::forward<M>(value)); });
+    }
+    template<typename M>
+    std::pair<bool, bool> assign(const KEY& key, M&& value) {
+        return write([&](trie_t& t) { return t.assign(key, std::forward<M>(value)); });
+    }
+    template<typename MakeFn, typename UpdateFn>
+    std::pair<bool, bool> upsert(const KEY& key, MakeFn&& make_fn, UpdateFn&& update_fn) {
+        return write([&](trie_t& t) {
+            return t.upsert(key, std::forward<MakeFn>(make_fn),
+                            std::forward<UpdateFn>(update_fn));
+        });
+    }
+    size_type erase(const KEY& key) {
+        return write([&](trie_t& t) { return t.erase(key); });
+    }
+    void clear() {
+        write([](trie_t& t) { t.clear(); });
+    }
+
+    // fn(kntrie&) applies any number of writes, published together
+    template<typename F>
+    decltype(auto) update(F&& fn) { return write(std::forward<F>(fn)); }
+
+    // The writer's own (latest) state; writer thread only
+    const trie_t& trie() const noexcept { return trie_v; }
+
+    // Free retired snapshots no reader is still in; returns how many remain
+    size_t reclaim() {
+        uint64_t lo = domain_v.min_active();
+        size_t n = 0;
+        while (n < retired_v.size() && retired_v[n].second <= lo)
+            delete retired_v[n++].first;
+        retired_v.erase(retired_v.begin(), retired_v.begin() + n);
+        return retired_v.size();
+    }
+
+private:
+    // A write that throws may still have changed the trie; publish anyway
+    template<typename F>
+    decltype(auto) write(F&& fn) {
+        try {
+            if constexpr (std::is_void_v<std::invoke_result_t<F&, trie_t&>>) {
+                fn(trie_v);
+                publish();
+            } else {
+                decltype(auto) r = fn(trie_v);
+                publish();
+                return r;
+            }
+        } catch (...) {
+            publish();
+            throw;
+        }
+    }
+
+    void publish() {
+        auto* next = new snapshot_type(trie_v.snapshot());
+        const snapshot_type* prev = current_v.load(std::memory_order_relaxed);
+        current_v.store(next, std::memory_order_seq_cst);
+        if (prev) retired_v.emplace_back(prev, domain_v.advance());
+        reclaim();
+    }
+
+    trie_t                              trie_v;
+    mutable epoch_domain_t              domain_v;
+    std::atomic<const snapshot_type*>   current_v{nullptr};
+    std::vector<std::pair<const snapshot_type*, uint64_t>> retired_v;  // snapshot, epoch
+};
+
 } // namespace gteitelbaum
 
 #endif // KNTRIE_HPP
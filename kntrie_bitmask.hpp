@@ -85,6 +85,15 @@ struct bitmap_256_t {
         return static_cast<uint8_t>((idx << 6) + 63 - std::countl_zero(words[idx]));
     }
 
+    // Index of the n-th set bit (0-based). Undefined if n >= popcount().
+    uint8_t select(unsigned n) const noexcept {
+        int w = 0;
+        for (unsigned c; n >= (c = std::popcount(words[w])); ++w) n -= c;
+        uint64_t bits = words[w];
+        for (; n > 0; --n) bits &= bits - 1;
+        return static_cast<uint8_t>((w << 6) + std::countr_zero(bits));
+    }
+
     struct adj_result { uint8_t idx; uint16_t slot; bool found; };
 
     // Find smallest set bit > idx, with its slot. Fully branchless.
@@ -197,12 +206,13 @@ struct bitmap_256_t {
 // ==========================================================================
 // bitmask_ops  -- unified bitmask node + bitmap_256_t leaf operations
 //
-// Bitmask node (internal): [header(1)][bitmap(4)][sentinel(1)][children(n)][desc(n u16)]
+// Bitmask node (internal): [header(1)][bitmap(4)][sentinel(1)][children(n)][desc(1)][agg(n)]
 //   - Parent pointer targets &node[1] (bitmap), no LEAF_BIT
 //   - sentinel at offset 5 from bitmap = SENTINEL_TAGGED for branchless miss
 //   - real children at offset 5 from bitmap (after sentinel)
 //   - All children are tagged uint64_t values
-//   - desc array: uint64_t per child, stores exact child descendant count
+//   - desc: exact descendant count of the whole node
+//   - agg: AGG_U64 u64s per child, the AGG fold of its subtree (none by default)
 //
 // Bitmap256 leaf (suffix_type=0): [header(1 or 2)][bitmap(4)][values(n)]
 //   - Parent pointer targets &node[0] | LEAF_BIT
@@ -210,11 +220,18 @@ struct bitmap_256_t {
 //   - values at header_size + 4
 // ==========================================================================
 
-template<typename VALUE, typename ALLOC>
+template<typename VALUE, typename ALLOC, typename AGG = no_aggregate_t>
 struct bitmask_ops {
     using VT   = value_traits<VALUE, ALLOC>;
     using VST  = typename VT::slot_type;
     using BLD  = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
+    using agg_t = typename AGG::type;
+
+    // Per-child aggregate width; 0 without an AGG
+    static constexpr size_t AGG_U64 = agg_u64<AGG>;
+    static_assert(!HAS_AGG<AGG> || (VT::IS_INLINE && !VT::IS_BOOL),
+                  "aggregates need VALUE stored inline (and not bool)");
+    static_assert(AGG_U64 <= 2, "AGG::type must fit in 16 bytes");
 
     // ==================================================================
     // leaf_fn_t — function pointer table stored in leaf node[1].
@@ -225,15 +242,28 @@ struct bitmask_ops {
         uint64_t     key;     // full IK, left-aligned in u64
         const VST*   value;
         bool         found;
+        uint16_t     pos = 0; // compact: slot index, bitmap: suffix byte
     };
 
     struct leaf_fn_t {
         uint8_t skip;
         const VALUE* (*find)(const uint64_t*, uint64_t) noexcept;
+        // find for writing: every later read sees writes through it
+        VALUE*        (*slot)(uint64_t*, uint64_t) noexcept;
         leaf_result_t (*next)(const uint64_t*, uint64_t) noexcept;
         leaf_result_t (*prev)(const uint64_t*, uint64_t) noexcept;
         leaf_result_t (*first)(const uint64_t*) noexcept;
         leaf_result_t (*last)(const uint64_t*) noexcept;
+        // Positional stepping for cursors: entry after / before pos
+        leaf_result_t (*step_next)(const uint64_t*, uint16_t) noexcept;
+        leaf_result_t (*step_prev)(const uint64_t*, uint16_t) noexcept;
+        // Order statistics: entries with key < ik / the i-th entry
+        unsigned      (*rank)(const uint64_t*, uint64_t) noexcept;
+        leaf_result_t (*select)(const uint64_t*, unsigned) noexcept;
+        // Uniform entry from a random word; !found means draw again
+        leaf_result_t (*sample)(const uint64_t*, uint64_t) noexcept;
+        // AGG fold of entries with lo <= key < hi (no upper bound if hi_open)
+        agg_t         (*aggregate)(const uint64_t*, uint64_t, uint64_t, bool) noexcept;
     };
 
     // --- Typed leaf accessors ---
@@ -252,21 +282,43 @@ struct bitmask_ops {
     static const VALUE* sentinel_find(const uint64_t*, uint64_t) noexcept {
         return nullptr;
     }
+    static VALUE* sentinel_slot(uint64_t*, uint64_t) noexcept {
+        return nullptr;
+    }
     static leaf_result_t sentinel_iter(const uint64_t*, uint64_t) noexcept {
         return {0, nullptr, false};
     }
     static leaf_result_t sentinel_bound(const uint64_t*) noexcept {
         return {0, nullptr, false};
     }
+    static leaf_result_t sentinel_step(const uint64_t*, uint16_t) noexcept {
+        return {0, nullptr, false};
+    }
+    static unsigned sentinel_rank(const uint64_t*, uint64_t) noexcept {
+        return 0;
+    }
+    static leaf_result_t sentinel_select(const uint64_t*, unsigned) noexcept {
+        return {0, nullptr, false};
+    }
+    static leaf_result_t sentinel_sample(const uint64_t*, uint64_t) noexcept {
+        return {0, nullptr, false};
+    }
+    static agg_t sentinel_aggregate(const uint64_t*, uint64_t, uint64_t, bool) noexcept {
+        return AGG::identity();
+    }
 
     static inline const leaf_fn_t SENTINEL_FN = {
-        0, &sentinel_find, &sentinel_iter, &sentinel_iter,
+        0, &sentinel_find, &sentinel_slot, &sentinel_iter, &sentinel_iter,
         &sentinel_bound, &sentinel_bound,
+        &sentinel_step, &sentinel_step,
+        &sentinel_rank, &sentinel_select, &sentinel_sample,
+        &sentinel_aggregate,
     };
 
-    // 3 u64s: header(entries=0), fn_ptr, prefix(0)
+    // header(entries=0), fn_ptr, prefix(0), then an empty bitmap: a
+    // miss at the last bitmask level reaches bitmap_find, not the fn
     static const uint64_t* sentinel_node_ptr() noexcept {
-        alignas(8) static const uint64_t SENTINEL_NODE[3] = {
+        alignas(8) static const uint64_t SENTINEL_NODE[LEAF_HEADER_U64 + BITMAP_256_U64] = {
             0,
             reinterpret_cast<uint64_t>(&SENTINEL_FN),
             0,
@@ -286,7 +338,8 @@ struct bitmask_ops {
     // ==================================================================
 
     static constexpr size_t bitmask_size_u64(size_t n_children, size_t hu = HEADER_U64) noexcept {
-        return hu + BITMAP_256_U64 + 1 + n_children + desc_u64(n_children);
+        return hu + BITMAP_256_U64 + 1 + n_children + desc_u64(n_children)
+             + n_children * AGG_U64;
     }
 
     static constexpr size_t bitmap_leaf_size_u64(size_t count, size_t hu = LEAF_HEADER_U64) noexcept {
@@ -374,6 +427,14 @@ struct bitmask_ops {
         return *descendants_ptr_mut(node, chain_hs(sc), nc);
     }
 
+    // Per-child aggregates of a skip chain (after the descendants count)
+    static const uint64_t* chain_aggs(const uint64_t* node, uint8_t sc, unsigned nc) noexcept {
+        return descendants_ptr(node, chain_hs(sc), nc) + 1;
+    }
+    static uint64_t* chain_aggs_mut(uint64_t* node, uint8_t sc, unsigned nc) noexcept {
+        return descendants_ptr_mut(node, chain_hs(sc), nc) + 1;
+    }
+
     // Final bitmap reference (const)
     static const bitmap_256_t& chain_bitmap(const uint64_t* node, uint8_t sc) noexcept {
         return bm(node, chain_hs(sc));
@@ -484,7 +545,8 @@ struct bitmask_ops {
     static uint64_t* make_bitmask(const uint8_t* indices,
                                    const uint64_t* child_tagged_ptrs,
                                    unsigned n_children, BLD& bld,
-                                   uint64_t descendants_ = 0) {
+                                   uint64_t descendants_ = 0,
+                                   const uint64_t* aggs_ = nullptr) {
         bitmap_256_t bm = bitmap_256_t::from_indices(indices, n_children);
 
         constexpr size_t hs = 1;
@@ -503,6 +565,7 @@ struct bitmask_ops {
                                     indices, child_tagged_ptrs, n_children);
 
         *descendants_ptr_mut(nn, hs, n_children) = descendants_;
+        init_aggs(nn, hs, n_children, aggs_);
         return nn;
     }
 
@@ -521,10 +584,12 @@ struct bitmask_ops {
                                       const uint8_t* final_indices,
                                       const uint64_t* final_children_tagged,
                                       unsigned final_n_children, BLD& bld,
-                                      uint64_t descendants_ = 0) {
+                                      uint64_t descendants_ = 0,
+                                      const uint64_t* aggs_ = nullptr) {
         // Allocation: header(1) + skip_count*6 + bitmap(4) + sentinel(1) + children(N) + desc(1)
+        //             + agg(N)
         size_t needed = 1 + static_cast<size_t>(skip_count) * 6 + 5 + final_n_children
-                       + desc_u64(final_n_children);
+                       + desc_u64(final_n_children) + final_n_children * AGG_U64;
         size_t au64 = round_up_u64(needed);
         uint64_t* nn = bld.alloc_node(au64);
 
@@ -558,6 +623,7 @@ struct bitmask_ops {
 
         // Single descendants count (after children)
         nn[final_offset + 5 + final_n_children] = descendants_;
+        init_aggs(nn, final_offset, final_n_children, aggs_);
 
         return nn;
     }
@@ -586,9 +652,10 @@ struct bitmask_ops {
             children[slot] = old_ch[slot];
         });
 
+        const uint64_t* old_aggs = chain_aggs(old_node, old_sc, final_nc);
         if (rem_skip == 0) {
             return tag_bitmask(
-                make_bitmask(indices, children, final_nc, bld, old_descendants));
+                make_bitmask(indices, children, final_nc, bld, old_descendants, old_aggs));
         }
 
         // rem_skip > 0: extract skip bytes for [from_pos..old_sc-1]
@@ -597,7 +664,8 @@ struct bitmask_ops {
             sb[i] = skip_byte(old_node, from_pos + i);
 
         return tag_bitmask(
-            make_skip_chain(sb, rem_skip, indices, children, final_nc, bld, old_descendants));
+            make_skip_chain(sb, rem_skip, indices, children, final_nc, bld,
+                            old_descendants, old_aggs));
     }
 
     // ==================================================================
@@ -632,7 +700,8 @@ struct bitmask_ops {
         });
 
         auto* new_chain = make_skip_chain(all_bytes, total_skip, indices, children,
-                                          nc, bld, old_descendants);
+                                          nc, bld, old_descendants,
+                                          chain_aggs(child, child_sc, nc));
         bld.dealloc_node(child, ch->alloc_u64());
         return tag_bitmask(new_chain);
     }
@@ -684,6 +753,49 @@ struct bitmask_ops {
         return chain_descendants(node, hdr->skip(), hdr->entries());
     }
 
+    // ==================================================================
+    // Subtree aggregates (AGG_U64 > 0). A final bitmap's aggs hold the
+    // AGG fold of each child; chain embeds keep none.
+    // ==================================================================
+
+    static agg_t fold_aggs(const uint64_t* aggs, unsigned from, unsigned to) noexcept {
+        agg_t a = AGG::identity();
+        for (unsigned i = from; i < to; ++i)
+            a = AGG::combine(a, agg_load<AGG>(aggs + i * AGG_U64));
+        return a;
+    }
+
+    // Aggs of a final bitmap with nc children, from its bitmap pointer
+    static const uint64_t* aggs_at(const uint64_t* bm, unsigned nc) noexcept {
+        return bm + BITMAP_256_U64 + 1 + nc + 1;
+    }
+
+    // A leaf folds its entries, a bitmask its children's aggs
+    static agg_t subtree_aggregate(uint64_t tagged) noexcept {
+        if (tagged & LEAF_BIT) {
+            const uint64_t* leaf = untag_leaf(tagged);
+            return leaf_fn(leaf)->aggregate(leaf, 0, 0, true);
+        }
+        const uint64_t* node = bm_to_node_const(tagged);
+        auto* hdr = get_header(node);
+        unsigned nc = hdr->entries();
+        return fold_aggs(chain_aggs(node, hdr->skip(), nc), 0, nc);
+    }
+
+    // Recompute slot's agg after its child changed in place
+    static void refresh_agg(uint64_t* node, uint8_t sc, int slot) noexcept {
+        unsigned nc = get_header(node)->entries();
+        agg_store<AGG>(chain_aggs_mut(node, sc, nc) + slot * AGG_U64,
+                       subtree_aggregate(chain_child(node, sc, slot)));
+    }
+
+    // Fold a into slot's agg: an entry joined the child
+    static void combine_agg(uint64_t* node, uint8_t sc, int slot, agg_t a) noexcept {
+        unsigned nc = get_header(node)->entries();
+        uint64_t* p = chain_aggs_mut(node, sc, nc) + slot * AGG_U64;
+        agg_store<AGG>(p, AGG::combine(agg_load<AGG>(p), a));
+    }
+
     // ==================================================================
 
     template<typename Fn>
@@ -805,14 +917,45 @@ struct bitmask_ops {
         }
     }
 
+    // Entries with suffix < key
+    static unsigned bitmap_rank(const uint64_t* node, uint8_t suffix,
+                                size_t header_size) noexcept {
+        return bm(node, header_size).find_slot<slot_mode::UNFILTERED>(suffix);
+    }
+
+    // AGG fold of entries with lo <= suffix < hi (no upper bound if
+    // hi_open). Inline, non-bool values only.
+    static agg_t bitmap_aggregate(const uint64_t* node, uint8_t lo, uint8_t hi,
+                                  bool hi_open, size_t header_size) noexcept {
+        const bitmap_256_t& bmp = bm(node, header_size);
+        unsigned from = bmp.find_slot<slot_mode::UNFILTERED>(lo);
+        unsigned to = hi_open ? bmp.popcount()
+                              : bmp.find_slot<slot_mode::UNFILTERED>(hi);
+        const VST* vd = bl_vals(node, header_size);
+        agg_t a = AGG::identity();
+        for (unsigned i = from; i < to; ++i)
+            a = AGG::combine(a, AGG::lift(*VT::as_ptr(vd[i])));
+        return a;
+    }
+
+    // The i-th entry (i < entries)
+    static iter_bm_result bitmap_iter_at(const uint64_t* node, unsigned i,
+                                          size_t header_size) noexcept {
+        uint8_t idx = bm(node, header_size).select(i);
+        if constexpr (VT::IS_BOOL)
+            return {idx, bool_slots::ptr(val_bm(node, header_size).has_bit(idx)), true};
+        else
+            return {idx, &bl_vals(node, header_size)[i], true};
+    }
+
     // ==================================================================
     // Bitmap256 leaf: insert
     // ==================================================================
 
-    template<bool INSERT = true, bool ASSIGN = true>
+    template<bool INSERT = true, bool ASSIGN = true, typename HIT = no_hit_t>
     requires (INSERT || ASSIGN)
     static insert_result_t bitmap_insert(uint64_t* node, uint8_t suffix,
-                                          VST value, BLD& bld) {
+                                          VST value, BLD& bld, HIT hit = {}) {
         auto* h = get_header(node);
         size_t hs = LEAF_HEADER_U64;
         bitmap_256_t& bm = bm_mut(node, hs);
@@ -823,6 +966,11 @@ struct bitmask_ops {
                 if constexpr (ASSIGN) {
                     if (value) val_bm_mut(node, hs).set_bit(suffix);
                     else       val_bm_mut(node, hs).clear_bit(suffix);
+                } else if constexpr (HAS_HIT<HIT>) {
+                    bool b = val_bm(node, hs).has_bit(suffix);
+                    hit(b);
+                    if (b) val_bm_mut(node, hs).set_bit(suffix);
+                    else   val_bm_mut(node, hs).clear_bit(suffix);
                 }
                 return {tag_leaf(node), false, false};
             }
@@ -858,6 +1006,8 @@ struct bitmask_ops {
                     int slot = bm.find_slot<slot_mode::UNFILTERED>(suffix);
                     bld.destroy_value(vd[slot]);
                     VT::write_slot(&vd[slot], value);
+                } else if constexpr (HAS_HIT<HIT>) {
+                    hit(VT::as_ref(vd[bm.find_slot<slot_mode::UNFILTERED>(suffix)]));
                 }
                 return {tag_leaf(node), false, false};
             }
@@ -1006,7 +1156,7 @@ struct bitmask_ops {
     static uint64_t* make_single_bitmap(uint8_t suffix, VST value, BLD& bld) {
         constexpr size_t hs = LEAF_HEADER_U64;
         size_t sz = round_up_u64(bitmap_leaf_size_u64(1));
-        uint64_t* node = bld.alloc_node(sz);
+        uint64_t* node = bld.alloc_node_zeroed(sz);
         auto* h = get_header(node);
         h->set_entries(1);
         h->set_alloc_u64(sz);
@@ -1063,12 +1213,57 @@ struct bitmask_ops {
         bld.dealloc_node(node, h->alloc_u64());
     }
 
+    // ==================================================================
+    // Clone: one block copy per node
+    // ==================================================================
+
+    // Bitmap256 leaf; C-type values are deep-copied
+    static uint64_t* bitmap_clone(const uint64_t* node, BLD& bld) {
+        auto* h = get_header(node);
+        size_t au64 = h->alloc_u64();
+        uint64_t* nn = bld.alloc_node(au64, false);  // au64 is already rounded
+        std::memcpy(nn, node, au64 * 8);
+        if constexpr (VT::HAS_DESTRUCTOR) {
+            uint16_t count = h->entries();
+            const VST* vd = bl_vals(node, LEAF_HEADER_U64);
+            VST* nvd = bl_vals_mut(nn, LEAF_HEADER_U64);
+            uint16_t i = 0;
+            try {
+                for (; i < count; ++i)
+                    nvd[i] = bld.store_value(static_cast<const VALUE&>(*vd[i]));
+            } catch (...) {
+                while (i > 0) bld.destroy_value(nvd[--i]);
+                bld.dealloc_node(nn, au64);
+                throw;
+            }
+        }
+        return nn;
+    }
+
+    // Bitmask / skip chain: embeds re-pointed into the copy; the copy
+    // holds the same child pointers.
+    static uint64_t* copy_bitmask(const uint64_t* node, BLD& bld) {
+        size_t au64 = get_header(node)->alloc_u64();
+        uint64_t* nn = bld.alloc_node(au64, false);  // au64 is already rounded
+        std::memcpy(nn, node, au64 * 8);
+        fix_embeds(nn, get_header(nn)->skip());
+        return nn;
+    }
+
+    // As copy_bitmask, with every real child set to the sentinel for the
+    // caller to fill in.
+    static uint64_t* clone_bitmask(const uint64_t* node, BLD& bld) {
+        uint64_t* nn = copy_bitmask(node, bld);
+        auto* h = get_header(nn);
+        std::fill_n(chain_children_mut(nn, h->skip()), h->entries(), SENTINEL_TAGGED);
+        return nn;
+    }
+
     // --- Chain header size: 1 (base header) + sc * 6 (embed slots) ---
     static constexpr size_t chain_hs(uint8_t sc) noexcept {
         return 1 + static_cast<size_t>(sc) * 6;
     }
 
-private:
     // --- Fix embed internal pointers after reallocation ---
     static void fix_embeds(uint64_t* nn, uint8_t sc) noexcept {
         for (uint8_t e = 0; e < sc; ++e) {
@@ -1080,6 +1275,40 @@ private:
         nn[fo + BITMAP_256_U64] = SENTINEL_TAGGED;
     }
 
+private:
+    // --- Aggs of a fresh node: copied when its children come from an
+    //     existing node (src, in slot order), else folded per child ---
+    static void init_aggs(uint64_t* nn, size_t hs, unsigned nc,
+                          const uint64_t* src) noexcept {
+        if constexpr (AGG_U64 > 0) {
+            uint64_t* dst = descendants_ptr_mut(nn, hs, nc) + 1;
+            if (src) {
+                std::memcpy(dst, src, nc * AGG_U64 * 8);
+                return;
+            }
+            const uint64_t* ch = real_children(nn, hs);
+            for (unsigned i = 0; i < nc; ++i)
+                agg_store<AGG>(dst + i * AGG_U64, subtree_aggregate(ch[i]));
+        }
+    }
+
+    // --- Move oc aggs from src to dst, opening (INSERT) or closing a gap
+    //     at slot. dst may overlap src one u64 either side, as when the
+    //     descendants count shifts in place ---
+    template<bool INSERT>
+    static void move_aggs(const uint64_t* src, uint64_t* dst, unsigned oc,
+                          int slot) noexcept {
+        constexpr size_t W = AGG_U64 * 8;
+        if constexpr (INSERT) {
+            std::memmove(dst + (slot + 1) * AGG_U64, src + slot * AGG_U64, (oc - slot) * W);
+            std::memmove(dst, src, slot * W);
+        } else {
+            std::memmove(dst, src, slot * W);
+            std::memmove(dst + slot * AGG_U64, src + (slot + 1) * AGG_U64,
+                         (oc - 1 - slot) * W);
+        }
+    }
+
     // --- Shared add child core: works for any header size ---
     static uint64_t* add_child_at(uint64_t* node, node_header_t* h, size_t hs,
                                     uint8_t idx, uint64_t child_tagged,
@@ -1094,6 +1323,9 @@ private:
         if (needed <= h->alloc_u64()) {
             // Save descendants (children shift will overwrite it)
             uint64_t saved = *descendants_ptr(node, hs, oc);
+            if constexpr (AGG_U64 > 0)
+                move_aggs<true>(descendants_ptr(node, hs, oc) + 1,
+                                descendants_ptr_mut(node, hs, nc) + 1, oc, isl);
 
             // Insert child
             uint64_t* rch = real_children_mut(node, hs);
@@ -1104,6 +1336,9 @@ private:
 
             // Write descendants at new position
             *descendants_ptr_mut(node, hs, nc) = saved;
+            if constexpr (AGG_U64 > 0)
+                agg_store<AGG>(descendants_ptr_mut(node, hs, nc) + 1 + isl * AGG_U64,
+                               subtree_aggregate(child_tagged));
             return node;
         }
 
@@ -1127,6 +1362,11 @@ private:
                                     oc, isl, child_tagged);
 
         *descendants_ptr_mut(nn, hs, nc) = saved;
+        if constexpr (AGG_U64 > 0) {
+            uint64_t* aggs = descendants_ptr_mut(nn, hs, nc) + 1;
+            move_aggs<true>(descendants_ptr(node, hs, oc) + 1, aggs, oc, isl);
+            agg_store<AGG>(aggs + isl * AGG_U64, subtree_aggregate(child_tagged));
+        }
 
         bld.dealloc_node(node, h->alloc_u64());
         return nn;
@@ -1151,6 +1391,9 @@ private:
             bitmap_256_t::arr_remove(bm_mut(node, hs), real_children_mut(node, hs),
                                   oc, slot, idx);
             h->set_entries(nc);
+            if constexpr (AGG_U64 > 0)
+                move_aggs<false>(descendants_ptr(node, hs, oc) + 1,
+                                 descendants_ptr_mut(node, hs, nc) + 1, oc, slot);
 
             *descendants_ptr_mut(node, hs, nc) = saved;
             return node;
@@ -1176,6 +1419,9 @@ private:
                                     oc, slot);
 
         *descendants_ptr_mut(nn, hs, nc) = saved;
+        if constexpr (AGG_U64 > 0)
+            move_aggs<false>(descendants_ptr(node, hs, oc) + 1,
+                             descendants_ptr_mut(nn, hs, nc) + 1, oc, slot);
 
         bld.dealloc_node(node, h->alloc_u64());
         return nn;
@@ -91,6 +91,38 @@ struct compact_ops {
             return VT::as_ptr(vals(node, ts, header_size)[base - kd]);
     }
 
+    // Writable slot for suffix, nullptr if absent (not for bool). Readers
+    // may take any slot of a dup run, so the run is first narrowed to one
+    // slot: its extras become copies of the neighbouring key. Out-of-line
+    // dups all point at the same VALUE and are left as they are.
+    static VALUE* value_slot(uint64_t* node, node_header_t h,
+                             K suffix) noexcept {
+        static_assert(!VT::IS_BOOL);
+        unsigned ts = h.total_slots();
+        size_t hs = LEAF_HEADER_U64;
+        K* kd = keys(node, hs);
+        const K* base = adaptive_search<K>::find_base(kd, ts, suffix);
+        if (*base != suffix) [[unlikely]] return nullptr;
+        int idx = base - kd;
+        VST* vd = vals_mut(node, ts, hs);
+        if constexpr (VT::IS_INLINE) {
+            int first = idx;
+            while (first > 0 && kd[first - 1] == suffix) --first;
+            if (first < idx) [[unlikely]] {
+                // A dup run always has a neighbour: one entry means ts == 1
+                int from = first > 0 ? first - 1 : idx + 1;
+                int lo = first > 0 ? first : first + 1;
+                int hi = first > 0 ? idx - 1 : idx;
+                for (int i = lo; i <= hi; ++i) {
+                    kd[i] = kd[from];
+                    VT::write_slot(&vd[i], vd[from]);
+                }
+                if (first == 0) idx = 0;
+            }
+        }
+        return const_cast<VALUE*>(VT::as_ptr(vd[idx]));
+    }
+
     // ==================================================================
     // Factory: build from pre-sorted working arrays
     // ==================================================================
@@ -150,32 +182,17 @@ struct compact_ops {
     // Iterator helpers: first, last, next, prev
     // ==================================================================
 
-    struct iter_leaf_result { K suffix; const VST* value; bool found; };
+    struct iter_leaf_result { K suffix; const VST* value; bool found; uint16_t pos = 0; };
 
     static iter_leaf_result iter_first(const uint64_t* node,
                                         const node_header_t* h) noexcept {
-        unsigned ts = h->total_slots();
-        size_t hs = LEAF_HEADER_U64;
-        const K* kd = keys(node, hs);
-        if constexpr (VT::IS_BOOL)
-            return {kd[0], bool_vals(node, ts, hs).ptr_at(0), true};
-        else {
-            const VST* vd = vals(node, ts, hs);
-            return {kd[0], &vd[0], true};
-        }
+        return entry_at(node, h->total_slots(), 0);
     }
 
     static iter_leaf_result iter_last(const uint64_t* node,
                                        const node_header_t* h) noexcept {
         unsigned ts = h->total_slots();
-        size_t hs = LEAF_HEADER_U64;
-        const K* kd = keys(node, hs);
-        if constexpr (VT::IS_BOOL)
-            return {kd[ts - 1], bool_vals(node, ts, hs).ptr_at(ts - 1), true};
-        else {
-            const VST* vd = vals(node, ts, hs);
-            return {kd[ts - 1], &vd[ts - 1], true};
-        }
+        return entry_at(node, ts, ts - 1);
     }
 
     // Smallest suffix > key
@@ -188,12 +205,7 @@ struct compact_ops {
         const K* base = adaptive_search<K>::find_base(kd, ts, suffix);
         unsigned pos = static_cast<unsigned>(base - kd) + (*base <= suffix);
         if (pos >= ts) return {0, nullptr, false};
-        if constexpr (VT::IS_BOOL)
-            return {kd[pos], bool_vals(node, ts, hs).ptr_at(pos), true};
-        else {
-            const VST* vd = vals(node, ts, hs);
-            return {kd[pos], &vd[pos], true};
-        }
+        return entry_at(node, ts, pos);
     }
 
     // Largest suffix < key (key is known to exist)
@@ -207,13 +219,95 @@ struct compact_ops {
         unsigned pos = static_cast<unsigned>(base - kd);
         while (pos > 0 && kd[pos - 1] == suffix) --pos;
         if (pos == 0) return {0, nullptr, false};
-        --pos;
-        if constexpr (VT::IS_BOOL)
-            return {kd[pos], bool_vals(node, ts, hs).ptr_at(pos), true};
-        else {
-            const VST* vd = vals(node, ts, hs);
-            return {kd[pos], &vd[pos], true};
+        return entry_at(node, ts, pos - 1);
+    }
+
+    // Entry after slot pos: skip the rest of pos's dup run
+    static iter_leaf_result iter_step_next(const uint64_t* node,
+                                            const node_header_t* h,
+                                            unsigned pos) noexcept {
+        unsigned ts = h->total_slots();
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        K cur = kd[pos];
+        do { ++pos; } while (pos < ts && kd[pos] == cur);
+        if (pos >= ts) return {0, nullptr, false};
+        return entry_at(node, ts, pos);
+    }
+
+    // Entry before slot pos: back up past the start of pos's dup run
+    static iter_leaf_result iter_step_prev(const uint64_t* node,
+                                            const node_header_t* h,
+                                            unsigned pos) noexcept {
+        unsigned ts = h->total_slots();
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        K cur = kd[pos];
+        while (pos > 0 && kd[pos - 1] == cur) --pos;
+        if (pos == 0) return {0, nullptr, false};
+        return entry_at(node, ts, pos - 1);
+    }
+
+    // ==================================================================
+    // Order statistics. Dup slots sit wherever inserts and erases left
+    // them, so slot position alone does not give the entry index: both
+    // count dup-run starts over a prefix of the key array.
+    // ==================================================================
+
+    // Entries with suffix < key
+    static unsigned iter_rank(const uint64_t* node, const node_header_t* h,
+                              K suffix) noexcept {
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        unsigned end = slot_lower_bound(kd, h->total_slots(), suffix);
+        if (end == 0) return 0;
+        return 1 + run_starts(kd, 1, end);
+    }
+
+    // The i-th entry (i < entries). Entry i sits at slot i or later;
+    // each pass jumps ahead by the entries still missing, which cannot
+    // overshoot since a slot starts at most one run.
+    static iter_leaf_result iter_select(const uint64_t* node,
+                                         const node_header_t* h,
+                                         unsigned i) noexcept {
+        unsigned ts = h->total_slots();
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        unsigned pos = i;
+        unsigned seen = 1 + run_starts(kd, 1, pos + 1);
+        while (seen <= i) {
+            unsigned from = pos + 1;
+            pos += i + 1 - seen;
+            seen += run_starts(kd, from, pos + 1);
         }
+        return entry_at(node, ts, pos);
+    }
+
+    // Uniform entry from a random word: pick a slot and keep it only if
+    // it starts its dup run. Slots are under twice the entries, so this
+    // takes under two draws on average.
+    static iter_leaf_result iter_sample(const uint64_t* node,
+                                         const node_header_t* h,
+                                         uint64_t r) noexcept {
+        unsigned ts = h->total_slots();
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        unsigned pos = static_cast<unsigned>(scale_random(r, ts));
+        if (pos > 0 && kd[pos] == kd[pos - 1]) return {0, nullptr, false};
+        return entry_at(node, ts, pos);
+    }
+
+    // AGG fold of entries with lo <= suffix < hi (no upper bound if
+    // hi_open). Inline, non-bool values only.
+    template<typename AGG>
+    static typename AGG::type iter_aggregate(const uint64_t* node,
+                                             const node_header_t* h,
+                                             K lo, K hi, bool hi_open) noexcept {
+        unsigned ts = h->total_slots();
+        const K* kd = keys(node, LEAF_HEADER_U64);
+        const VST* vd = vals(node, ts, LEAF_HEADER_U64);
+        unsigned from = slot_lower_bound(kd, ts, lo);
+        unsigned to = hi_open ? ts : slot_lower_bound(kd, ts, hi);
+        typename AGG::type a = AGG::identity();
+        for (unsigned i = from; i < to; ++i)
+            if (i == from || kd[i] != kd[i - 1])
+                a = AGG::combine(a, AGG::lift(*VT::as_ptr(vd[i])));
+        return a;
     }
 
     // ==================================================================
@@ -237,17 +331,51 @@ struct compact_ops {
         bld.dealloc_node(node, h->alloc_u64());
     }
 
+    // ==================================================================
+    // Clone: one block copy, dups included. A C-type run is deep-copied
+    // once and the copy shared across the run, as in the source.
+    // ==================================================================
+
+    static uint64_t* clone(const uint64_t* node, BLD& bld) {
+        auto* h = get_header(node);
+        size_t au64 = h->alloc_u64();
+        uint64_t* nn = bld.alloc_node(au64, false);  // au64 is already rounded
+        std::memcpy(nn, node, au64 * 8);
+        if constexpr (VT::HAS_DESTRUCTOR) {
+            unsigned ts = h->total_slots();
+            size_t hs = LEAF_HEADER_U64;
+            const K* kd = keys(node, hs);
+            const VST* vd = vals(node, ts, hs);
+            VST* nvd = vals_mut(nn, ts, hs);
+            unsigned i = 0;
+            try {
+                for (; i < ts; ++i)
+                    nvd[i] = (i > 0 && kd[i] == kd[i - 1])
+                        ? nvd[i - 1]
+                        : bld.store_value(static_cast<const VALUE&>(*vd[i]));
+            } catch (...) {
+                for (unsigned j = 0; j < i; ++j)
+                    if (j == 0 || kd[j] != kd[j - 1]) bld.destroy_value(nvd[j]);
+                bld.dealloc_node(nn, au64);
+                throw;
+            }
+        }
+        return nn;
+    }
+
     // ==================================================================
     // Insert
     //
     // INSERT: allow inserting new keys
     // ASSIGN: allow overwriting existing values
+    // HIT:    hit(VALUE&) on an existing value; dups are resynced after
     // ==================================================================
 
-    template<bool INSERT = true, bool ASSIGN = true>
+    template<bool INSERT = true, bool ASSIGN = true, typename HIT = no_hit_t>
     requires (INSERT || ASSIGN)
     static insert_result_t insert(uint64_t* node, node_header_t* h,
-                                  K suffix, VST value, BLD& bld) {
+                                  K suffix, VST value, BLD& bld,
+                                  HIT hit = {}) {
         unsigned entries = h->entries();
         unsigned ts = h->total_slots();
         size_t hs = LEAF_HEADER_U64;
@@ -272,6 +400,20 @@ struct compact_ops {
                     for (int i = idx - 1; i >= 0 && kd[i] == suffix; --i)
                         VT::write_slot(&vd[i], value);
                 }
+            } else if constexpr (HAS_HIT<HIT>) {
+                int idx = base - kd;
+                if constexpr (VT::IS_BOOL) {
+                    auto bv = bool_vals_mut(node, ts, hs);
+                    bool b = bv.get(idx);
+                    hit(b);
+                    for (int i = idx; i >= 0 && kd[i] == suffix; --i)
+                        bv.set(i, b);
+                } else {
+                    VST* vd = vals_mut(node, ts, hs);
+                    hit(VT::as_ref(vd[idx]));
+                    for (int i = idx - 1; i >= 0 && kd[i] == suffix; --i)
+                        VT::write_slot(&vd[i], vd[idx]);
+                }
             }
             return {tag_leaf(node), false, false};
         }
@@ -467,6 +609,34 @@ private:
             reinterpret_cast<const char*>(node + header_size) + kb)) };
     }
 
+    // Dup runs starting in slots [from, to), from >= 1. Branchless so
+    // the compiler can vectorize it.
+    static unsigned run_starts(const K* kd, unsigned from, unsigned to) noexcept {
+        unsigned n = 0;
+        for (unsigned i = from; i < to; ++i) n += kd[i] != kd[i - 1];
+        return n;
+    }
+
+    // First slot with key >= suffix (ts if none): the start of its run
+    static unsigned slot_lower_bound(const K* kd, unsigned ts, K suffix) noexcept {
+        const K* base = adaptive_search<K>::find_base(kd, ts, suffix);
+        unsigned pos = static_cast<unsigned>(base - kd) + (*base < suffix);
+        while (pos > 0 && kd[pos - 1] == suffix) --pos;
+        return pos;
+    }
+
+    // Iterator result for slot pos
+    static iter_leaf_result entry_at(const uint64_t* node, unsigned ts,
+                                      unsigned pos) noexcept {
+        size_t hs = LEAF_HEADER_U64;
+        K suffix = keys(node, hs)[pos];
+        uint16_t p = static_cast<uint16_t>(pos);
+        if constexpr (VT::IS_BOOL)
+            return {suffix, bool_vals(node, ts, hs).ptr_at(pos), true, p};
+        else
+            return {suffix, &vals(node, ts, hs)[pos], true, p};
+    }
+
     // ==================================================================
     // Dedup + skip one key, writing into output arrays
     // ==================================================================
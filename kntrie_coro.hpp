@@ -0,0 +1,153 @@
+#ifndef KNTRIE_CORO_HPP
+#define KNTRIE_CORO_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+
+namespace gteitelbaum {
+
+// ==========================================================================
+// frame_pool_t — per-thread freelist for coroutine frames.
+//
+// interleave_run creates one task per request; without recycling the
+// frame allocation costs more than the lookup. Frames are bucketed by
+// 64-byte class up to FRAME_MAX; larger ones go to the heap.
+// ==========================================================================
+
+struct frame_pool_t {
+    static constexpr size_t FRAME_CLASS = 64;
+    static constexpr size_t FRAME_MAX   = 512;
+    static constexpr size_t NUM_CLASSES = FRAME_MAX / FRAME_CLASS;
+
+    struct free_t { free_t* next; };
+    free_t* heads_v[NUM_CLASSES] = {};
+
+    ~frame_pool_t() {
+        for (auto*& h : heads_v)
+            while (h) { free_t* n = h->next; ::operator delete(h); h = n; }
+    }
+
+    static frame_pool_t& local() noexcept {
+        thread_local frame_pool_t pool;
+        return pool;
+    }
+
+    static size_t class_of(size_t sz) noexcept { return (sz - 1) / FRAME_CLASS; }
+
+    static void* get(size_t sz) {
+        if (sz > FRAME_MAX) return ::operator new(sz);
+        free_t*& h = local().heads_v[class_of(sz)];
+        if (h) { free_t* p = h; h = p->next; return p; }
+        return ::operator new((class_of(sz) + 1) * FRAME_CLASS);
+    }
+
+    static void put(void* p, size_t sz) noexcept {
+        if (sz > FRAME_MAX) { ::operator delete(p); return; }
+        free_t*& h = local().heads_v[class_of(sz)];
+        h = ::new (p) free_t{h};
+    }
+};
+
+// ==========================================================================
+// lookup_task_t — coroutine for one interleaved lookup.
+//
+// A lookup suspends right after prefetching the next node, so a scheduler
+// can resume other lookups while that line is in flight. Starts suspended;
+// done() once the result has been written to the caller's out slot.
+// ==========================================================================
+
+struct lookup_task_t {
+    struct promise_type {
+        static void* operator new(size_t sz) { return frame_pool_t::get(sz); }
+        static void operator delete(void* p, size_t sz) noexcept {
+            frame_pool_t::put(p, sz);
+        }
+
+        lookup_task_t get_return_object() noexcept {
+            return lookup_task_t{handle_t::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    lookup_task_t() noexcept = default;
+    explicit lookup_task_t(handle_t h) noexcept : handle_v(h) {}
+    lookup_task_t(lookup_task_t&& o) noexcept
+        : handle_v(std::exchange(o.handle_v, {})) {}
+    lookup_task_t& operator=(lookup_task_t&& o) noexcept {
+        if (this != &o) {
+            if (handle_v) handle_v.destroy();
+            handle_v = std::exchange(o.handle_v, {});
+        }
+        return *this;
+    }
+    lookup_task_t(const lookup_task_t&) = delete;
+    lookup_task_t& operator=(const lookup_task_t&) = delete;
+    ~lookup_task_t() { if (handle_v) handle_v.destroy(); }
+
+    explicit operator bool() const noexcept { return bool(handle_v); }
+    bool done() const noexcept { return handle_v.done(); }
+    void resume() const { handle_v.resume(); }
+
+    // Run to completion without interleaving
+    void run() const { while (!handle_v.done()) handle_v.resume(); }
+
+private:
+    handle_t handle_v{};
+};
+
+// co_await prefetch_yield_t{p}: prefetch p, then hand control back
+struct prefetch_yield_t {
+    const void* addr;
+    bool await_ready() const noexcept {
+        __builtin_prefetch(addr);
+        return false;
+    }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    void await_resume() const noexcept {}
+};
+
+// ==========================================================================
+// interleave_run — round-robin scheduler.
+//
+// make_task(i) returns the lookup_task_t for request i, i in [0, n).
+// At most `depth` tasks are in flight; a finished slot is refilled with
+// the next request. depth 1 degenerates to sequential lookups.
+// ==========================================================================
+
+inline constexpr size_t MAX_INTERLEAVE = 64;
+
+template<typename MAKE_TASK>
+void interleave_run(size_t n, MAKE_TASK&& make_task, size_t depth) {
+    if (depth < 1) depth = 1;
+    if (depth > MAX_INTERLEAVE) depth = MAX_INTERLEAVE;
+
+    lookup_task_t slots[MAX_INTERLEAVE];
+    size_t next = 0, live = 0;
+    for (; live < depth && next < n; ++live)
+        slots[live] = make_task(next++);
+
+    while (live) {
+        for (size_t i = 0; i < depth; ++i) {
+            if (!slots[i]) continue;
+            slots[i].resume();
+            if (!slots[i].done()) continue;
+            if (next < n) {
+                slots[i] = make_task(next++);
+            } else {
+                slots[i] = lookup_task_t{};
+                --live;
+            }
+        }
+    }
+}
+
+} // namespace gteitelbaum
+
+#endif // KNTRIE_CORO_HPP
@@ -0,0 +1,324 @@
+#ifndef KNTRIE_COW_HPP
+#define KNTRIE_COW_HPP
+
+#include "kntrie_iter_ops.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gteitelbaum {
+
+// ==========================================================================
+// cow_state_t — node sharing between a trie and its snapshots.
+//
+// extra_v counts the owners beyond the first of every node block that is
+// reachable from more than one parent slot or root; a node absent from
+// it has exactly one owner. Only the writing trie touches extra_v.
+//
+// A snapshot dropped on any thread hands its root to retire() and then
+// leaves views_v; the writer releases retired roots (take_retired) before
+// its next write.
+//
+// bld_box_v holds an empty builder of the writer's type. If the writer
+// is destroyed or assigned over while snapshots are live, it swaps its
+// builder in here, since the snapshots' nodes live in those slabs; the
+// last owner of the state then frees the retired roots and the slabs.
+// ==========================================================================
+
+struct cow_state_t {
+    std::unordered_map<const uint64_t*, uint32_t> extra_v;
+
+    std::mutex mutex_v;
+    std::vector<std::pair<uint64_t, uint8_t>> retired_v;  // tagged root, root skip
+    std::atomic<bool>   has_retired_v{false};
+    std::atomic<size_t> views_v{0};                       // live snapshots
+
+    void* bld_box_v = nullptr;
+    void (*free_box_v)(cow_state_t&, void*) noexcept = nullptr;
+
+    cow_state_t() = default;
+    cow_state_t(const cow_state_t&) = delete;
+    cow_state_t& operator=(const cow_state_t&) = delete;
+    ~cow_state_t() { if (bld_box_v) free_box_v(*this, bld_box_v); }
+
+    void retire(uint64_t root, uint8_t skip) {
+        std::lock_guard<std::mutex> lock(mutex_v);
+        retired_v.emplace_back(root, skip);
+        has_retired_v.store(true, std::memory_order_release);
+    }
+
+    std::vector<std::pair<uint64_t, uint8_t>> take_retired() {
+        std::vector<std::pair<uint64_t, uint8_t>> out;
+        if (!has_retired_v.load(std::memory_order_acquire)) return out;
+        std::lock_guard<std::mutex> lock(mutex_v);
+        out.swap(retired_v);
+        has_retired_v.store(false, std::memory_order_relaxed);
+        return out;
+    }
+};
+
+// ==========================================================================
+// kntrie_cow_ops<VALUE, ALLOC, KEY_BITS, AGG> — path copying for snapshots.
+//
+// A write first makes private every node it may change or free, then
+// runs the ordinary in-place operation. A shared leaf is copied with
+// its values; out-of-line values are copy-constructed, since the write
+// may assign or destroy them. A shared bitmask is copied shallowly and
+// each of its children gains an owner. The old node loses one owner
+// and stays with the snapshots, which therefore never see a change.
+// ==========================================================================
+
+template<typename VALUE, typename ALLOC, int KEY_BITS, typename AGG = no_aggregate_t>
+struct kntrie_cow_ops {
+    using BO       = bitmask_ops<VALUE, ALLOC, AGG>;
+    using VT       = value_traits<VALUE, ALLOC>;
+    using BLD      = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
+    using OPS      = kntrie_ops<VALUE, ALLOC, KEY_BITS, AGG>;
+    using ITER_OPS = kntrie_iter_ops<VALUE, ALLOC, KEY_BITS, AGG>;
+
+    // ==================================================================
+    // Owner counts
+    // ==================================================================
+
+    static const uint64_t* node_of(uint64_t tagged) noexcept {
+        return (tagged & LEAF_BIT) ? untag_leaf(tagged) : bm_to_node_const(tagged);
+    }
+
+    static bool shared(const cow_state_t& cs, uint64_t tagged) noexcept {
+        return tagged != BO::SENTINEL_TAGGED &&
+               cs.extra_v.find(node_of(tagged)) != cs.extra_v.end();
+    }
+
+    static void add_ref(cow_state_t& cs, uint64_t tagged) {
+        if (tagged != BO::SENTINEL_TAGGED) ++cs.extra_v[node_of(tagged)];
+    }
+
+    // Drop one owner; false if the caller was the only one
+    static bool drop_ref(cow_state_t& cs, uint64_t tagged) noexcept {
+        auto it = cs.extra_v.find(node_of(tagged));
+        if (it == cs.extra_v.end()) return false;
+        if (--it->second == 0) cs.extra_v.erase(it);
+        return true;
+    }
+
+    // ==================================================================
+    // unshare: give slot a private copy of its node if it is shared
+    // ==================================================================
+
+    template<int BITS> requires (BITS >= 8)
+    static void unshare(cow_state_t& cs, uint64_t& slot, BLD& bld) {
+        if (!shared(cs, slot)) return;
+        uint64_t old = slot;
+        if (old & LEAF_BIT) {
+            const uint64_t* node = untag_leaf(old);
+            slot = tag_leaf(ITER_OPS::template clone_leaf_skip<BITS>(
+                node, get_header(node)->skip(), bld));
+        } else {
+            uint64_t* nn = BO::copy_bitmask(bm_to_node_const(old), bld);
+            auto* h = get_header(nn);
+            const uint64_t* ch = BO::chain_children(nn, h->skip());
+            for (unsigned i = 0; i < h->entries(); ++i)
+                add_ref(cs, ch[i]);
+            slot = tag_bitmask(nn);
+        }
+        drop_ref(cs, old);
+    }
+
+    // Before a point insert / assign at ik: every node on ik's path.
+    // Insert changes nothing off the path.
+    template<int BITS> requires (BITS >= 8)
+    static void unshare_path(cow_state_t& cs, uint64_t& slot, uint64_t ik,
+                             BLD& bld) {
+        unshare<BITS>(cs, slot, bld);
+        if (slot & LEAF_BIT) return;
+
+        uint64_t* node = bm_to_node(slot);
+        uint8_t sc = get_header(node)->skip();
+        if (!OPS::template chain_matches<BITS>(node, sc, ik)) return;  // split happens here
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            auto cl = BO::chain_lookup(node, sc, OPS::template extract_byte<FB>(ik));
+            if (cl.found)
+                unshare_path<FB - 8>(cs, BO::chain_children_mut(node, sc)[cl.slot],
+                                     ik, bld);
+        });
+    }
+
+    // Before a point erase at ik: the path, plus what erase may rebuild
+    // off it. A subtree small enough to coalesce is made private whole;
+    // the sibling in a two-child node may be collapsed into it.
+    template<int BITS> requires (BITS >= 8)
+    static void unshare_erase_path(cow_state_t& cs, uint64_t& slot,
+                                   uint64_t ik, BLD& bld) {
+        unshare<BITS>(cs, slot, bld);
+        if (slot & LEAF_BIT) return;
+
+        uint64_t* node = bm_to_node(slot);
+        auto* hdr = get_header(node);
+        uint8_t sc = hdr->skip();
+        if (BO::chain_descendants(node, sc, hdr->entries()) <= COALESCE_MAX + 1) {
+            unshare_all<BITS>(cs, slot, bld);
+            return;
+        }
+        if (!OPS::template chain_matches<BITS>(node, sc, ik)) return;
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            auto cl = BO::chain_lookup(node, sc, OPS::template extract_byte<FB>(ik));
+            if (!cl.found) return;
+            uint64_t* ch = BO::chain_children_mut(node, sc);
+            if (hdr->entries() == 2)
+                unshare<FB - 8>(cs, ch[cl.slot ^ 1], bld);
+            unshare_erase_path<FB - 8>(cs, ch[cl.slot], ik, bld);
+        });
+    }
+
+    // Before a sorted batch over iks [lo, hi): the nodes on their paths,
+    // grouped per child the way the batch walks them. An erase batch may
+    // also rebuild off the path, as in unshare_erase_path: a subtree it
+    // may shrink to a coalesce is made private whole, and a node that may
+    // drop to one child gets private children.
+    template<int BITS, bool ERASE, typename IK_AT> requires (BITS >= 8)
+    static void unshare_batch(cow_state_t& cs, uint64_t& slot, IK_AT& ik_at,
+                              size_t lo, size_t hi, BLD& bld) {
+        unshare<BITS>(cs, slot, bld);
+        if (slot & LEAF_BIT) return;
+
+        uint64_t* node = bm_to_node(slot);
+        auto* hdr = get_header(node);
+        uint8_t sc = hdr->skip();
+        size_t run = hi - lo;
+        if (ERASE && BO::chain_descendants(node, sc, hdr->entries()) <= COALESCE_MAX + run) {
+            unshare_all<BITS>(cs, slot, bld);
+            return;
+        }
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            uint64_t* ch = BO::chain_children_mut(node, sc);
+            if (ERASE && hdr->entries() <= run + 1)
+                for (unsigned i = 0; i < hdr->entries(); ++i)
+                    unshare<FB - 8>(cs, ch[i], bld);
+            // Keys off the chain may land in a child here too; copying
+            // that path is harmless
+            for (size_t i = lo; i < hi;) {
+                uint8_t ti = OPS::template extract_byte<FB>(ik_at(i));
+                size_t a = i + 1;
+                while (a < hi && OPS::template extract_byte<FB>(ik_at(a)) == ti) ++a;
+                auto cl = BO::chain_lookup(node, sc, ti);
+                if (cl.found)
+                    unshare_batch<FB - 8, ERASE>(cs, ch[cl.slot], ik_at, i, a, bld);
+                i = a;
+            }
+        });
+    }
+
+    // Before a range erase of [key_lo, key_hi], following the classing
+    // of ITER_OPS::erase_range: the nodes on the two boundary paths.
+    // Subtrees wholly inside stay shared, since the erase drops them with
+    // release. Where at most COALESCE_MAX keys survive they will be
+    // coalesced, so they are made private (keep); a node that may drop
+    // to one child gets private children.
+    template<int BITS> requires (BITS >= 8)
+    static void unshare_range(cow_state_t& cs, uint64_t& slot, uint64_t base,
+                              uint64_t key_lo, uint64_t key_hi, bool keep,
+                              BLD& bld) {
+        if (slot == BO::SENTINEL_TAGGED) [[unlikely]] return;
+        uint64_t top = base | ITER_OPS::template low_bits<BITS>();
+        if (!(slot & LEAF_BIT)) {
+            const uint64_t* node = bm_to_node_const(slot);
+            uint8_t sc = get_header(node)->skip();
+            if (sc > 0) [[unlikely]] {
+                for (uint8_t pos = 0; pos < sc; ++pos)
+                    base |= uint64_t(BO::skip_byte(node, pos))
+                            << (OPS::template byte_shift<BITS>() - 8 * pos);
+                top = base | ((uint64_t(1) <<
+                    (OPS::template byte_shift<BITS>() - 8 * (sc - 1))) - 1);
+            }
+        }
+        if (key_hi < base || key_lo > top) {
+            if (keep) unshare_all<BITS>(cs, slot, bld);
+            return;
+        }
+        if (key_lo <= base && top <= key_hi) return;
+
+        unshare<BITS>(cs, slot, bld);
+        if (slot & LEAF_BIT) return;
+
+        if (!keep) {
+            uint64_t total = BO::exact_subtree_count(slot);
+            constexpr int SHIFT = OPS::template byte_shift<BITS>();
+            uint64_t below_lo = ITER_OPS::subtree_rank(slot, total, key_lo, SHIFT);
+            uint64_t to_hi = key_hi == ~uint64_t(0) ? total
+                : ITER_OPS::subtree_rank(slot, total, key_hi + 1, SHIFT);
+            keep = total - (to_hi - below_lo) <= COALESCE_MAX;
+        }
+
+        uint64_t* node = bm_to_node(slot);
+        uint8_t sc = get_header(node)->skip();
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            constexpr int SHIFT = OPS::template byte_shift<FB>();
+            uint64_t* ch = BO::chain_children_mut(node, sc);
+            const bitmap_256_t& bm = BO::chain_bitmap(node, sc);
+            int kept[256];
+            unsigned nk = 0;
+            bm.for_each_set([&](uint8_t ti, int i) {
+                uint64_t cb = base | (uint64_t(ti) << SHIFT);
+                if (key_lo > cb || (cb | ITER_OPS::template low_bits<FB - 8>()) > key_hi)
+                    kept[nk++] = i;
+                unshare_range<FB - 8>(cs, ch[i], cb, key_lo, key_hi, keep, bld);
+            });
+            if (nk <= 2)
+                for (unsigned k = 0; k < nk; ++k)
+                    unshare<FB - 8>(cs, ch[kept[k]], bld);
+        });
+    }
+
+    // Before a bulk operation: every node below slot
+    template<int BITS> requires (BITS >= 8)
+    static void unshare_all(cow_state_t& cs, uint64_t& slot, BLD& bld) {
+        if (cs.extra_v.empty()) return;
+        unshare<BITS>(cs, slot, bld);
+        if (slot & LEAF_BIT) return;
+
+        uint64_t* node = bm_to_node(slot);
+        auto* hdr = get_header(node);
+        uint8_t sc = hdr->skip();
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            uint64_t* ch = BO::chain_children_mut(node, sc);
+            for (unsigned i = 0; i < hdr->entries(); ++i)
+                unshare_all<FB - 8>(cs, ch[i], bld);
+        });
+    }
+
+    // ==================================================================
+    // release: drop one owner of a subtree; nodes left without an owner
+    // are freed, values included
+    // ==================================================================
+
+    template<int BITS> requires (BITS >= 8)
+    static void release(cow_state_t& cs, uint64_t tagged, BLD& bld) noexcept {
+        if (tagged == BO::SENTINEL_TAGGED) return;
+        if (cs.extra_v.empty()) {
+            ITER_OPS::template remove_subtree<BITS>(tagged, bld);
+            return;
+        }
+        if (drop_ref(cs, tagged)) return;
+        if (tagged & LEAF_BIT) {
+            ITER_OPS::template remove_subtree<BITS>(tagged, bld);
+            return;
+        }
+
+        uint64_t* node = bm_to_node(tagged);
+        auto* hdr = get_header(node);
+        uint8_t sc = hdr->skip();
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            const uint64_t* ch = BO::chain_children(node, sc);
+            for (unsigned i = 0; i < hdr->entries(); ++i)
+                release<FB - 8>(cs, ch[i], bld);
+        });
+        BO::dealloc_bitmask(node, bld);
+    }
+};
+
+} // namespace gteitelbaum
+
+#endif // KNTRIE_COW_HPP
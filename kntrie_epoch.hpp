@@ -0,0 +1,79 @@
+#ifndef KNTRIE_EPOCH_HPP
+#define KNTRIE_EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace gteitelbaum {
+
+// ==========================================================================
+// epoch_domain_t — epoch-based reclamation for one writer, many readers.
+//
+// A reader announces the global epoch in a free slot before it loads any
+// shared pointer and clears the slot when done. The writer unlinks an
+// object, then advance()s and tags the object with the returned epoch;
+// once min_active() reaches that tag no reader can still hold it.
+//
+// Readers never block the writer: the writer only ever defers. A reader
+// finding all MAX_READERS slots busy spins until one frees.
+// ==========================================================================
+
+struct epoch_domain_t {
+    static constexpr size_t   MAX_READERS = 256;
+    static constexpr uint64_t IDLE        = 0;
+    static constexpr uint64_t QUIESCENT   = ~uint64_t(0);
+
+    struct alignas(64) slot_t {
+        std::atomic<uint64_t> epoch_v{IDLE};
+    };
+
+    alignas(64) std::atomic<uint64_t> epoch_v{1};
+    slot_t slots_v[MAX_READERS];
+
+    // Reader: claim a slot in the current epoch; returns its index
+    size_t enter() noexcept {
+        size_t i = home_slot();
+        for (size_t tries = 1;; ++tries) {
+            uint64_t want = IDLE;
+            uint64_t e = epoch_v.load(std::memory_order_seq_cst);
+            if (slots_v[i].epoch_v.compare_exchange_strong(
+                    want, e, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return i;
+            i = (i + 1) % MAX_READERS;
+            if (tries % MAX_READERS == 0) std::this_thread::yield();
+        }
+    }
+
+    void leave(size_t slot) noexcept {
+        slots_v[slot].epoch_v.store(IDLE, std::memory_order_release);
+    }
+
+    // Writer: call after unlinking; objects unlinked so far carry the result
+    uint64_t advance() noexcept {
+        return epoch_v.fetch_add(1, std::memory_order_seq_cst) + 1;
+    }
+
+    // Writer: oldest epoch a reader is in, QUIESCENT if there are none
+    uint64_t min_active() const noexcept {
+        uint64_t lo = QUIESCENT;
+        for (const auto& s : slots_v) {
+            uint64_t e = s.epoch_v.load(std::memory_order_seq_cst);
+            if (e != IDLE && e < lo) lo = e;
+        }
+        return lo;
+    }
+
+private:
+    // Spread threads over the slots so a claim rarely contends
+    static size_t home_slot() noexcept {
+        static std::atomic<size_t> next{0};
+        thread_local size_t home = next.fetch_add(1, std::memory_order_relaxed) % MAX_READERS;
+        return home;
+    }
+};
+
+} // namespace gteitelbaum
+
+#endif // KNTRIE_EPOCH_HPP
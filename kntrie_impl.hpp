@@ -3,13 +3,16 @@
 
 #include "kntrie_ops.hpp"
 #include "kntrie_iter_ops.hpp"
+#include "kntrie_coro.hpp"
+#include "kntrie_cow.hpp"
 #include <memory>
 #include <cstring>
 #include <algorithm>
 
 namespace gteitelbaum {
 
-template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>>
+template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>,
+         typename AGG = no_aggregate_t>
 class kntrie_impl {
     static_assert(std::is_integral_v<KEY> && sizeof(KEY) >= 2,
                   "KEY must be integral and at least 16 bits");
@@ -19,25 +22,30 @@ public:
     using mapped_type    = VALUE;
     using size_type      = std::size_t;
     using allocator_type = ALLOC;
+    using aggregate_type = typename AGG::type;
 
 private:
     using KO   = key_ops<KEY>;
     using IK   = typename KO::IK;
     using VT   = value_traits<VALUE, ALLOC>;
     using VST  = typename VT::slot_type;
-    using BO   = bitmask_ops<VALUE, ALLOC>;
+    using BO   = bitmask_ops<VALUE, ALLOC, AGG>;
     using BLD  = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
 
     static constexpr int IK_BITS  = KO::IK_BITS;
     static constexpr int KEY_BITS = KO::KEY_BITS;
 
-    using OPS  = kntrie_ops<VALUE, ALLOC, KEY_BITS>;
-    using ITER_OPS = kntrie_iter_ops<VALUE, ALLOC, KEY_BITS>;
+    using OPS  = kntrie_ops<VALUE, ALLOC, KEY_BITS, AGG>;
+    using ITER_OPS = kntrie_iter_ops<VALUE, ALLOC, KEY_BITS, AGG>;
+    using COW_OPS  = kntrie_cow_ops<VALUE, ALLOC, KEY_BITS, AGG>;
 
     // MAX_ROOT_SKIP: leave 1 byte for subtree root dispatch + 1 byte minimum
     // u16: 0, u32: 2, u64: 6
     static constexpr int MAX_ROOT_SKIP = KEY_BITS / 8 - 2;
 
+    // One key step in root-level (left-aligned) ik space
+    static constexpr uint64_t KEY_UNIT = uint64_t(1) << (64 - KEY_BITS);
+
     // ==================================================================
     // key_to_u64: left-align internal key in uint64_t
     // ==================================================================
@@ -51,36 +59,21 @@ private:
     // root_fn_t — function pointer table for root dispatch
     // ==================================================================
 
-    using root_find_fn_t     = const VALUE* (*)(uint64_t ptr, uint64_t prefix,
-                                                 uint64_t ik) noexcept;
-    using root_findleaf_fn_t = const uint64_t* (*)(uint64_t ptr, uint64_t prefix,
-                                                    uint64_t ik) noexcept;
-    using root_iter_fn_t     = typename BO::leaf_result_t (*)(uint64_t ptr, uint64_t prefix,
-                                                               uint64_t ik) noexcept;
+    using root_find_fn_t = const VALUE* (*)(uint64_t ptr, uint64_t prefix,
+                                             uint64_t ik) noexcept;
 
     struct root_fn_t {
-        uint8_t             skip;
-        root_find_fn_t      find;
-        root_findleaf_fn_t  find_next;
-        root_findleaf_fn_t  find_prev;
-        root_iter_fn_t      iter_next;
-        root_iter_fn_t      iter_prev;
+        uint8_t        skip;
+        root_find_fn_t find;
     };
 
     // --- Sentinel root fn (empty trie) ---
     static const VALUE* sentinel_root_find(uint64_t, uint64_t, uint64_t) noexcept {
         return nullptr;
     }
-    static const uint64_t* sentinel_root_findleaf(uint64_t, uint64_t, uint64_t) noexcept {
-        return nullptr;
-    }
-    static typename BO::leaf_result_t sentinel_root_iter(uint64_t, uint64_t, uint64_t) noexcept {
-        return {0, nullptr, false};
-    }
 
     static inline const root_fn_t SENTINEL_ROOT_FN = {
-        0, &sentinel_root_find, &sentinel_root_findleaf, &sentinel_root_findleaf,
-        &sentinel_root_iter, &sentinel_root_iter,
+        0, &sentinel_root_find,
     };
 
     // --- Root find implementation ---
@@ -95,86 +88,6 @@ private:
         return OPS::template find_node<BITS>(ptr, ik);
     }
 
-    // --- Root find_next_leaf: find leaf that may contain next key > ik ---
-    template<int SKIP>
-    static const uint64_t* root_find_next_impl(uint64_t ptr, uint64_t prefix,
-                                                uint64_t ik) noexcept {
-        constexpr int BITS = KEY_BITS - 8 * SKIP;
-        if constexpr (SKIP > 0) {
-            constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
-            uint64_t diff = (ik ^ prefix) & MASK;
-            if (diff) [[unlikely]] {
-                int shift = std::countl_zero(diff) & ~7;
-                uint8_t kb = static_cast<uint8_t>(ik >> (56 - shift));
-                uint8_t pb = static_cast<uint8_t>(prefix >> (56 - shift));
-                if (kb < pb)
-                    return OPS::template descend_min_leaf<BITS>(ptr);
-                return nullptr;
-            }
-        }
-        return OPS::template find_leaf_next<BITS>(ptr, ik);
-    }
-
-    // --- Root find_prev_leaf: find leaf that may contain prev key < ik ---
-    template<int SKIP>
-    static const uint64_t* root_find_prev_impl(uint64_t ptr, uint64_t prefix,
-                                                uint64_t ik) noexcept {
-        constexpr int BITS = KEY_BITS - 8 * SKIP;
-        if constexpr (SKIP > 0) {
-            constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
-            uint64_t diff = (ik ^ prefix) & MASK;
-            if (diff) [[unlikely]] {
-                int shift = std::countl_zero(diff) & ~7;
-                uint8_t kb = static_cast<uint8_t>(ik >> (56 - shift));
-                uint8_t pb = static_cast<uint8_t>(prefix >> (56 - shift));
-                if (kb > pb)
-                    return OPS::template descend_max_leaf<BITS>(ptr);
-                return nullptr;
-            }
-        }
-        return OPS::template find_leaf_prev<BITS>(ptr, ik);
-    }
-
-    // --- Root iter_next: find smallest entry with key > ik ---
-    template<int SKIP>
-    static typename BO::leaf_result_t root_iter_next_impl(
-            uint64_t ptr, uint64_t prefix, uint64_t ik) noexcept {
-        constexpr int BITS = KEY_BITS - 8 * SKIP;
-        if constexpr (SKIP > 0) {
-            constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
-            uint64_t diff = (ik ^ prefix) & MASK;
-            if (diff) [[unlikely]] {
-                int shift = std::countl_zero(diff) & ~7;
-                uint8_t kb = static_cast<uint8_t>(ik >> (56 - shift));
-                uint8_t pb = static_cast<uint8_t>(prefix >> (56 - shift));
-                if (kb < pb)
-                    return OPS::template descend_first<BITS>(ptr);
-                return {0, nullptr, false};
-            }
-        }
-        return OPS::template iter_next_tree<BITS>(ptr, ik);
-    }
-
-    // --- Root iter_prev: find largest entry with key < ik ---
-    template<int SKIP>
-    static typename BO::leaf_result_t root_iter_prev_impl(
-            uint64_t ptr, uint64_t prefix, uint64_t ik) noexcept {
-        constexpr int BITS = KEY_BITS - 8 * SKIP;
-        if constexpr (SKIP > 0) {
-            constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
-            uint64_t diff = (ik ^ prefix) & MASK;
-            if (diff) [[unlikely]] {
-                int shift = std::countl_zero(diff) & ~7;
-                uint8_t kb = static_cast<uint8_t>(ik >> (56 - shift));
-                uint8_t pb = static_cast<uint8_t>(prefix >> (56 - shift));
-                if (kb > pb)
-                    return OPS::template descend_last<BITS>(ptr);
-                return {0, nullptr, false};
-            }
-        }
-        return OPS::template iter_prev_tree<BITS>(ptr, ik);
-    }
-
     // --- Build ROOT_FNS array ---
     template<size_t... Is>
     static constexpr auto make_root_fns(std::index_sequence<Is...>) {
@@ -182,10 +95,6 @@ private:
             root_fn_t{
                 static_cast<uint8_t>(Is),
                 &root_find_impl<static_cast<int>(Is)>,
-                &root_find_next_impl<static_cast<int>(Is)>,
-                &root_find_prev_impl<static_cast<int>(Is)>,
-                &root_iter_next_impl<static_cast<int>(Is)>,
-                &root_iter_prev_impl<static_cast<int>(Is)>,
             }...
         };
     }
@@ -199,17 +108,23 @@ private:
 
     template<typename F>
     decltype(auto) skip_switch(F&& fn_) const {
+        return skip_switch(root_fn_v->skip, std::forward<F>(fn_));
+    }
+
+    // For a root other than this trie's own (a retired snapshot's)
+    template<typename F>
+    static decltype(auto) skip_switch(uint8_t skip, F&& fn_) {
         if constexpr (MAX_ROOT_SKIP <= 0) {
             return fn_.template operator()<KEY_BITS>();
         } else if constexpr (MAX_ROOT_SKIP <= 2) {
-            switch (root_fn_v->skip) {
+            switch (skip) {
             case 0: return fn_.template operator()<KEY_BITS>();
             case 1: return fn_.template operator()<KEY_BITS - 8>();
             case 2: return fn_.template operator()<KEY_BITS - 16>();
             default: __builtin_unreachable();
             }
         } else {
-            switch (root_fn_v->skip) {
+            switch (skip) {
             case 0: return fn_.template operator()<KEY_BITS>();
             case 1: return fn_.template operator()<KEY_BITS - 8>();
             case 2: return fn_.template operator()<KEY_BITS - 16>();
@@ -226,31 +141,14 @@ private:
     const root_fn_t* root_fn_v;
     uint64_t  root_ptr_v;       // tagged child (SENTINEL, leaf, or bitmask)
     uint64_t  root_prefix_v;    // shared prefix bytes, left-aligned
-    uint64_t  begin_v;          // tagged ptr to min leaf
-    uint64_t  end_v;            // tagged ptr to max leaf
     size_t    size_v;
     BLD       bld_v;
+    std::shared_ptr<cow_state_t> cow_v;  // set once a snapshot was taken
 
     void set_root_skip(uint8_t skip) noexcept {
         root_fn_v = &ROOT_FNS[skip];
     }
 
-    uint64_t refresh_begin() const noexcept {
-        if (root_ptr_v == BO::SENTINEL_TAGGED) return BO::SENTINEL_TAGGED;
-        const uint64_t* leaf = skip_switch([&]<int BITS>() -> const uint64_t* {
-            return OPS::template descend_min_leaf<BITS>(root_ptr_v);
-        });
-        return leaf ? tag_leaf(leaf) : BO::SENTINEL_TAGGED;
-    }
-
-    uint64_t refresh_end() const noexcept {
-        if (root_ptr_v == BO::SENTINEL_TAGGED) return BO::SENTINEL_TAGGED;
-        const uint64_t* leaf = skip_switch([&]<int BITS>() -> const uint64_t* {
-            return OPS::template descend_max_leaf<BITS>(root_ptr_v);
-        });
-        return leaf ? tag_leaf(leaf) : BO::SENTINEL_TAGGED;
-    }
-
 public:
     // ==================================================================
     // Constructor / Destructor
@@ -260,48 +158,58 @@ public:
         : root_fn_v(&SENTINEL_ROOT_FN),
           root_ptr_v(BO::SENTINEL_TAGGED),
           root_prefix_v(0),
-          begin_v(BO::SENTINEL_TAGGED),
-          end_v(BO::SENTINEL_TAGGED),
           size_v(0),
           bld_v() {}
 
-    ~kntrie_impl() { remove_all(); bld_v.drain(); }
+    ~kntrie_impl() { release_storage(); }
 
-    kntrie_impl(const kntrie_impl&) = delete;
-    kntrie_impl& operator=(const kntrie_impl&) = delete;
+    // Structural copy: each node block is copied once and only child
+    // pointers are rewritten. If a value copy throws, the destructor
+    // frees the partial tree.
+    kntrie_impl(const kntrie_impl& o) : kntrie_impl() {
+        if (o.size_v == 0) return;
+        root_fn_v = o.root_fn_v;
+        root_prefix_v = o.root_prefix_v;
+        skip_switch([&]<int BITS>() -> int {
+            ITER_OPS::template clone_subtree<BITS>(o.root_ptr_v, root_ptr_v, bld_v);
+            return 0;
+        });
+        size_v = o.size_v;
+    }
+
+    kntrie_impl& operator=(const kntrie_impl& o) {
+        if (this != &o) {
+            kntrie_impl tmp(o);
+            swap(tmp);
+        }
+        return *this;
+    }
 
     kntrie_impl(kntrie_impl&& o) noexcept
         : root_fn_v(o.root_fn_v),
           root_ptr_v(o.root_ptr_v),
           root_prefix_v(o.root_prefix_v),
-          begin_v(o.begin_v),
-          end_v(o.end_v),
           size_v(o.size_v),
-          bld_v(std::move(o.bld_v)) {
+          bld_v(std::move(o.bld_v)),
+          cow_v(std::move(o.cow_v)) {
         o.root_fn_v = &SENTINEL_ROOT_FN;
         o.root_ptr_v = BO::SENTINEL_TAGGED;
         o.root_prefix_v = 0;
-        o.begin_v = BO::SENTINEL_TAGGED;
-        o.end_v = BO::SENTINEL_TAGGED;
         o.size_v = 0;
     }
 
     kntrie_impl& operator=(kntrie_impl&& o) noexcept {
         if (this != &o) {
-            remove_all();
-            bld_v.drain();
+            release_storage();
             root_fn_v = o.root_fn_v;
             root_ptr_v = o.root_ptr_v;
             root_prefix_v = o.root_prefix_v;
-            begin_v = o.begin_v;
-            end_v = o.end_v;
             size_v = o.size_v;
             bld_v = std::move(o.bld_v);
+            cow_v = std::move(o.cow_v);
             o.root_fn_v = &SENTINEL_ROOT_FN;
             o.root_ptr_v = BO::SENTINEL_TAGGED;
             o.root_prefix_v = 0;
-            o.begin_v = BO::SENTINEL_TAGGED;
-            o.end_v = BO::SENTINEL_TAGGED;
             o.size_v = 0;
         }
         return *this;
@@ -311,10 +219,9 @@ public:
         std::swap(root_fn_v, o.root_fn_v);
         std::swap(root_ptr_v, o.root_ptr_v);
         std::swap(root_prefix_v, o.root_prefix_v);
-        std::swap(begin_v, o.begin_v);
-        std::swap(end_v, o.end_v);
         std::swap(size_v, o.size_v);
         bld_v.swap(o.bld_v);
+        cow_v.swap(o.cow_v);
     }
 
     [[nodiscard]] bool      empty() const noexcept { return size_v == 0; }
@@ -323,10 +230,8 @@ public:
 
     void clear() noexcept {
         remove_all();
-        bld_v.drain();
+        if (!cow_v) bld_v.drain();  // else snapshot nodes live in the slabs
         size_v = 0;
-        begin_v = BO::SENTINEL_TAGGED;
-        end_v = BO::SENTINEL_TAGGED;
     }
 
     // ==================================================================
@@ -338,25 +243,237 @@ public:
         return root_fn_v->find(root_ptr_v, root_prefix_v, ik);
     }
 
+    // For writing through the result (at): with snapshots outstanding
+    // the key's path is made private first. The leaf's slot fn keeps
+    // compact dup slots in step with the write. Not with an AGG, which
+    // such writes would leave stale, nor bool, whose slots are bits.
+    VALUE* find_value_mut(const KEY& key) requires (!HAS_AGG<AGG> && !VT::IS_BOOL) {
+        uint64_t ik = key_to_u64(key);
+        uint8_t skip = root_fn_v->skip;
+        if (skip > 0 && ((ik ^ root_prefix_v) & (~uint64_t(0) << (64 - 8 * skip))))
+            [[unlikely]] return nullptr;
+        if (cow_active()) [[unlikely]] {
+            if (!find_value(key)) return nullptr;
+            skip_switch([&]<int BITS>() -> int {
+                COW_OPS::template unshare_path<BITS>(*cow_v, root_ptr_v, ik, bld_v);
+                return 0;
+            });
+        }
+        uint64_t* leaf = OPS::leaf_below(root_ptr_v, ik, 56 - 8 * skip);
+        return BO::leaf_fn(leaf)->slot(leaf, ik);
+    }
+
     bool contains(const KEY& key) const noexcept {
         return find_value(key) != nullptr;
     }
 
+    // Batched find: out[i] = find_value(key_at(i)), with lookups in
+    // groups of OPS::FIND_GROUP descending together to overlap misses.
+    template<typename KEY_AT>
+    void find_batch(size_t n, KEY_AT&& key_at, const VALUE** out) const noexcept {
+        constexpr unsigned G = OPS::FIND_GROUP;
+        uint8_t skip = root_fn_v->skip;
+        uint64_t mask = skip ? ~uint64_t(0) << (64 - 8 * skip) : 0;
+        uint64_t iks[G], ptrs[G];
+        for (size_t base = 0; base < n; base += G) {
+            unsigned g = static_cast<unsigned>(std::min<size_t>(G, n - base));
+            for (unsigned i = 0; i < g; ++i) {
+                uint64_t ik = key_to_u64(key_at(base + i));
+                iks[i] = ik;
+                ptrs[i] = ((ik ^ root_prefix_v) & mask) ? BO::SENTINEL_TAGGED
+                                                        : root_ptr_v;
+            }
+            OPS::find_group(iks, ptrs, g, skip, out + base);
+        }
+    }
+
 public:
     // ==================================================================
     // Insert / Insert-or-assign / Assign
     // ==================================================================
 
-    std::pair<bool, bool> insert(const KEY& key, const VALUE& value) {
-        return insert_dispatch<true, false>(key, value);
+    // The value is built once, in its final storage, from ARGS
+    // (a VALUE to copy or move, or VALUE constructor arguments).
+
+    template<typename... ARGS>
+    std::pair<bool, bool> insert(const KEY& key, ARGS&&... args) {
+        return insert_dispatch<true, false>(key, std::forward<ARGS>(args)...);
+    }
+
+    template<typename... ARGS>
+    std::pair<bool, bool> insert_or_assign(const KEY& key, ARGS&&... args) {
+        return insert_dispatch<true, true>(key, std::forward<ARGS>(args)...);
     }
 
-    std::pair<bool, bool> insert_or_assign(const KEY& key, const VALUE& value) {
-        return insert_dispatch<true, true>(key, value);
+    template<typename... ARGS>
+    std::pair<bool, bool> assign(const KEY& key, ARGS&&... args) {
+        return insert_dispatch<false, true>(key, std::forward<ARGS>(args)...);
+    }
+
+    // operator[]: key's value, value-initialised in place if absent.
+    // A hit is one branchless descent; a miss inserts, and the insert
+    // reports the leaf it left key in instead of a find after it.
+    VALUE& value_ref(const KEY& key) requires (!HAS_AGG<AGG> && !VT::IS_BOOL) {
+        if (VALUE* v = find_value_mut(key)) [[likely]] return *v;
+
+        uint64_t ik = key_to_u64(key);
+        VST sv;
+        if constexpr (VT::IS_TRIVIAL)
+            sv = bld_v.store_value();
+        else
+            sv = bld_v.reserve_value();
+
+        insert_result_t r;
+        try {
+            r = insert_at_root<true, false>(ik, sv, no_hit_t{});
+        } catch (...) {
+            if constexpr (!VT::IS_TRIVIAL) bld_v.release_value(sv);
+            throw;
+        }
+        ++size_v;
+
+        if constexpr (!VT::IS_TRIVIAL) {
+            build_placed(key, sv);
+            return *sv;
+        } else {
+            return *BO::leaf_fn(r.leaf)->slot(r.leaf, ik);
+        }
     }
 
-    std::pair<bool, bool> assign(const KEY& key, const VALUE& value) {
-        return insert_dispatch<false, true>(key, value);
+    // ==================================================================
+    // Upsert: one descent. If key is present, update_fn(VALUE&) modifies
+    // it in place; otherwise a value built from make_fn() is inserted.
+    // make_fn runs only on insert: inline values go in as a placeholder
+    // that the reported slot then takes, out-of-line ones are built into
+    // a reserved block. Inline bool slots are bits and inline aggregates
+    // are folded in on the way down, so those look first instead (two
+    // descents on a miss).
+    // Returns {true, inserted}.
+    // ==================================================================
+
+    template<typename MAKE_FN, typename UPDATE_FN>
+    std::pair<bool, bool> upsert(const KEY& key, MAKE_FN&& make_fn,
+                                 UPDATE_FN&& update_fn) {
+        auto hit = [&update_fn](VALUE& v) { update_fn(v); };
+        uint64_t ik = key_to_u64(key);
+
+        if constexpr (VT::IS_TRIVIAL && (VT::IS_BOOL || HAS_AGG<AGG>)) {
+            VST sv = contains(key) ? VST{} : bld_v.store_value(make_fn());
+            bool did_insert = insert_at_root<true, false>(ik, sv, hit).inserted;
+            if (did_insert) ++size_v;
+            return {true, did_insert};
+        } else if constexpr (VT::IS_TRIVIAL) {
+            insert_result_t r = insert_at_root<true, false>(ik, bld_v.store_value(), hit);
+            if (!r.inserted) return {true, false};
+            ++size_v;
+            try {
+                *BO::leaf_fn(r.leaf)->slot(r.leaf, ik) = make_fn();
+            } catch (...) {  // take the placeholder back out
+                erase(key);
+                throw;
+            }
+            return {true, true};
+        } else {
+            VST sv = bld_v.reserve_value();
+            bool did_insert;
+            try {
+                did_insert = insert_at_root<true, false>(ik, sv, hit).inserted;
+            } catch (...) {  // update_fn threw; sv was never placed
+                bld_v.release_value(sv);
+                throw;
+            }
+            if (did_insert) ++size_v;
+
+            // Converts inside build_placed, so a throwing make_fn is
+            // unwound like a throwing constructor
+            struct made_t {
+                MAKE_FN& fn;
+                operator VALUE() const { return fn(); }
+            };
+            if (did_insert) build_placed(key, sv, made_t{make_fn});
+            else bld_v.release_value(sv);
+            return {true, did_insert};
+        }
+    }
+
+    // ==================================================================
+    // Bulk build: replace contents from an ascending source.
+    // key_at(i) -> KEY, value_at(i) -> const VALUE&, for i in [0, n).
+    // ==================================================================
+
+    template<typename KEY_AT, typename VALUE_AT>
+    void assign_sorted(size_t n, KEY_AT&& key_at, VALUE_AT&& value_at) {
+        clear();
+        if (n == 0) return;
+
+        auto ik_at  = [&](size_t i) { return key_to_u64(key_at(i)); };
+        auto val_at = [&](size_t i) { return bld_v.store_value(value_at(i)); };
+#ifndef NDEBUG
+        for (size_t i = 1; i < n; ++i)
+            assert(ik_at(i - 1) <= ik_at(i) && "assign_sorted: keys not ascending");
+#endif
+
+        // Root skip = bytes shared by the whole range (first vs last)
+        uint64_t first = ik_at(0);
+        uint64_t diff = first ^ ik_at(n - 1);
+        int common = diff ? std::countl_zero(diff) / 8 : KEY_BITS / 8;
+        uint8_t skip = static_cast<uint8_t>(std::min(common, MAX_ROOT_SKIP));
+
+        // The root is only set once the build is done: a throw leaves
+        // the empty trie clear() made
+        size_t entries = 0;
+        uint64_t root = skip_switch(skip, [&]<int BITS>() -> uint64_t {
+            return OPS::template build_sorted<BITS, true>(
+                ik_at, val_at, 0, n, entries, bld_v);
+        });
+        set_root_skip(skip);
+        if constexpr (MAX_ROOT_SKIP > 0)
+            root_prefix_v = first;
+        root_ptr_v = root;
+        size_v = entries;
+    }
+
+    // ==================================================================
+    // Sorted batch insert: key_at(i) ascending, value_at(i) -> const
+    // VALUE&. Existing keys are left unchanged; duplicates keep the
+    // first. Each leaf the batch reaches is merged once. Returns the
+    // number of keys inserted.
+    // ==================================================================
+
+    template<typename KEY_AT, typename VALUE_AT>
+    size_t insert_sorted_batch(size_t n, KEY_AT&& key_at, VALUE_AT&& value_at) {
+        if (n == 0) return 0;
+        if (size_v == 0) {
+            assign_sorted(n, key_at, value_at);
+            return size_v;
+        }
+        auto ik_at  = [&](size_t i) { return key_to_u64(key_at(i)); };
+        auto val_at = [&](size_t i) { return bld_v.store_value(value_at(i)); };
+        if (cow_active()) [[unlikely]]
+            skip_switch([&]<int BITS>() -> int {
+                COW_OPS::template unshare_batch<BITS, false>(
+                    *cow_v, root_ptr_v, ik_at, 0, n, bld_v);
+                return 0;
+            });
+
+        // Sorted: the divergence of first or last bounds the whole batch
+        uint8_t skip = root_fn_v->skip;
+        if (skip > 0) {
+            uint64_t mask = ~uint64_t(0) << (64 - 8 * skip);
+            uint64_t diff = ((ik_at(0) ^ root_prefix_v) |
+                             (ik_at(n - 1) ^ root_prefix_v)) & mask;
+            if (diff) [[unlikely]]
+                reduce_root_skip(static_cast<uint8_t>(std::countl_zero(diff) / 8));
+        }
+
+        size_t inserted = 0;
+        skip_switch([&]<int BITS>() -> int {
+            root_ptr_v = OPS::template insert_batch<BITS>(
+                root_ptr_v, ik_at, val_at, 0, n, inserted, bld_v);
+            return 0;
+        });
+        size_v += inserted;
+        return inserted;
     }
 
     // ==================================================================
@@ -374,12 +491,13 @@ public:
             if ((ik ^ root_prefix_v) & mask) return false;
         }
 
-        // Capture begin/end state before mutation
-        const uint64_t* bl = untag_leaf(begin_v);
-        const uint64_t* el = untag_leaf(end_v);
-        uint64_t min_key = BO::leaf_fn(bl)->first(bl).key;
-        uint64_t max_key = BO::leaf_fn(el)->last(el).key;
-        bld_v.set_watches(bl, el);
+        if (cow_active()) [[unlikely]] {
+            if (!find_value(key)) return false;
+            skip_switch([&]<int BITS>() -> int {
+                COW_OPS::template unshare_erase_path<BITS>(*cow_v, root_ptr_v, ik, bld_v);
+                return 0;
+            });
+        }
 
         bool erased = skip_switch([&]<int BITS>() -> bool {
             auto r = OPS::template erase_node<BITS>(root_ptr_v, ik, bld_v);
@@ -394,19 +512,137 @@ public:
                 root_fn_v = &SENTINEL_ROOT_FN;
                 root_ptr_v = BO::SENTINEL_TAGGED;
                 root_prefix_v = 0;
-                begin_v = BO::SENTINEL_TAGGED;
-                end_v = BO::SENTINEL_TAGGED;
-            } else {
-                if (ik == min_key || bld_v.freed_a())
-                    begin_v = refresh_begin();
-                if (ik == max_key || bld_v.freed_b())
-                    end_v = refresh_end();
             }
         }
-        bld_v.clear_watches();
         return erased;
     }
 
+    // ==================================================================
+    // Sorted batch erase: key_at(i) ascending. Each leaf holding hits is
+    // compacted once and each bitmask above them settles once. Returns
+    // the number of keys erased.
+    // ==================================================================
+
+    template<typename KEY_AT>
+    size_t erase_sorted_batch(size_t n, KEY_AT&& key_at) {
+        if (n == 0 || size_v == 0) return 0;
+        auto ik_at = [&](size_t i) { return key_to_u64(key_at(i)); };
+
+        // Keys outside the root prefix cannot be present
+        size_t lo = 0, hi = n;
+        uint8_t skip = root_fn_v->skip;
+        if (skip > 0) {
+            uint64_t mask = ~uint64_t(0) << (64 - 8 * skip);
+            uint64_t key_lo = root_prefix_v & mask;
+            hi = OPS::first_above(ik_at, lo, hi, key_lo | ~mask);
+            if (key_lo > 0) lo = OPS::first_above(ik_at, lo, hi, key_lo - 1);
+            if (lo == hi) return 0;
+        }
+        if (cow_active()) [[unlikely]]
+            skip_switch([&]<int BITS>() -> int {
+                COW_OPS::template unshare_batch<BITS, true>(
+                    *cow_v, root_ptr_v, ik_at, lo, hi, bld_v);
+                return 0;
+            });
+
+        size_t erased = 0;
+        uint64_t r = skip_switch([&]<int BITS>() -> uint64_t {
+            return OPS::template erase_batch<BITS>(
+                root_ptr_v, ik_at, lo, hi, erased, bld_v);
+        });
+        root_ptr_v = r ? r : BO::SENTINEL_TAGGED;
+        size_v -= erased;
+        if (size_v == 0) {
+            root_fn_v = &SENTINEL_ROOT_FN;
+            root_ptr_v = BO::SENTINEL_TAGGED;
+            root_prefix_v = 0;
+        }
+        return erased;
+    }
+
+    // ==================================================================
+    // Range erase: remove every key in [lo, hi]. Subtrees inside the
+    // range are freed whole; only the two boundary paths are rebuilt.
+    // Returns the number of keys erased.
+    // ==================================================================
+
+    size_t erase_range(const KEY& lo, const KEY& hi) {
+        if (size_v == 0 || hi < lo) return 0;
+        uint64_t ik_lo = key_to_u64(lo);
+        uint64_t ik_hi = key_to_u64(hi);
+        if constexpr (KEY_BITS < 64)
+            ik_hi |= ~uint64_t(0) >> KEY_BITS;  // cover the unused low bits
+
+        uint64_t base = 0;
+        uint8_t skip = root_fn_v->skip;
+        if (skip > 0)
+            base = root_prefix_v & (~uint64_t(0) << (64 - 8 * skip));
+
+        // With snapshots, subtrees inside the range may be shared: they
+        // lose an owner instead of being freed
+        bool cow = cow_active();
+        auto drop = [&]<int BITS>(uint64_t tagged) {
+            if (cow) [[unlikely]] COW_OPS::template release<BITS>(*cow_v, tagged, bld_v);
+            else ITER_OPS::template remove_subtree<BITS>(tagged, bld_v);
+        };
+
+        size_t erased = 0;
+        uint64_t r = skip_switch([&]<int BITS>() -> uint64_t {
+            if (cow) [[unlikely]]
+                COW_OPS::template unshare_range<BITS>(
+                    *cow_v, root_ptr_v, base, ik_lo, ik_hi, false, bld_v);
+            return ITER_OPS::template erase_range<BITS>(
+                root_ptr_v, base, ik_lo, ik_hi, erased, bld_v, drop);
+        });
+        root_ptr_v = r ? r : BO::SENTINEL_TAGGED;
+        size_v -= erased;
+        if (size_v == 0) {
+            root_fn_v = &SENTINEL_ROOT_FN;
+            root_ptr_v = BO::SENTINEL_TAGGED;
+            root_prefix_v = 0;
+        }
+        return erased;
+    }
+
+    // ==================================================================
+    // Snapshots (see kntrie_cow.hpp). share_root returns, in O(1), a
+    // read-only impl holding this trie's nodes; writes here then copy the
+    // nodes they touch first. The snapshot side gives its root back with
+    // release_view, from any thread.
+    // ==================================================================
+
+    kntrie_impl share_root() {
+        if (!cow_v) {
+            auto cs = std::make_shared<cow_state_t>();
+            cs->bld_box_v = new BLD(bld_v.get_allocator());
+            cs->free_box_v = &free_orphan;
+            cow_v = std::move(cs);
+        }
+        kntrie_impl view;
+        if (size_v > 0) {
+            COW_OPS::add_ref(*cow_v, root_ptr_v);
+            view.root_fn_v = root_fn_v;
+            view.root_ptr_v = root_ptr_v;
+            view.root_prefix_v = root_prefix_v;
+            view.size_v = size_v;
+        }
+        cow_v->views_v.fetch_add(1, std::memory_order_relaxed);
+        return view;
+    }
+
+    const std::shared_ptr<cow_state_t>& cow_state() const noexcept { return cow_v; }
+
+    // Snapshot side: hand the root to the writer and leave this empty
+    void release_view(cow_state_t& cs) noexcept {
+        if (root_ptr_v != BO::SENTINEL_TAGGED)
+            cs.retire(root_ptr_v, root_fn_v->skip);
+        cs.views_v.fetch_sub(1, std::memory_order_release);
+        root_fn_v = &SENTINEL_ROOT_FN;
+        root_ptr_v = BO::SENTINEL_TAGGED;
+        root_prefix_v = 0;
+        size_v = 0;
+    }
+
     // ==================================================================
     // Stats / Memory
     // ==================================================================
@@ -439,7 +675,10 @@ public:
         return s;
     }
 
-    size_t memory_usage() const noexcept { return debug_stats().total_bytes; }
+    // O(1): live node + value blocks tracked by the builder at their bin
+    // size, snapshot-held ones included (see kntrie::memory_usage).
+    // debug_stats() still walks the tree (nodes only) when a breakdown is needed.
+    size_t memory_usage() const noexcept { return sizeof(*this) + bld_v.live_bytes(); }
 
     struct root_info_t {
         uint16_t entries; uint8_t skip;
@@ -468,41 +707,142 @@ public:
     // Iterator support
     // ==================================================================
 
-    struct iter_result_t { KEY key; VALUE value; bool found; };
+    using cursor_t = typename ITER_OPS::cursor_t;
+
+    bool cursor_first(cursor_t& c) const noexcept {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        if (size_v == 0) return false;
+        ITER_OPS::cursor_descend_first(c, root_ptr_v);
+        return true;
+    }
+
+    bool cursor_last(cursor_t& c) const noexcept {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        if (size_v == 0) return false;
+        ITER_OPS::cursor_descend_last(c, root_ptr_v);
+        return true;
+    }
+
+    static bool cursor_next(cursor_t& c) noexcept { return ITER_OPS::cursor_next(c); }
+    static bool cursor_prev(cursor_t& c) noexcept { return ITER_OPS::cursor_prev(c); }
+
+    // key itself; false if absent
+    bool cursor_find(cursor_t& c, const KEY& key) const noexcept {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        return ITER_OPS::cursor_seek_exact(c, root_ptr_v, key_to_u64(key));
+    }
+
+    // Smallest key >= key
+    bool cursor_lower_bound(cursor_t& c, const KEY& key) const noexcept {
+        uint64_t ik = key_to_u64(key);
+        if (ik == 0) return cursor_first(c);
+        return cursor_seek_after(c, ik - KEY_UNIT);
+    }
+
+    // Smallest key > key
+    bool cursor_upper_bound(cursor_t& c, const KEY& key) const noexcept {
+        return cursor_seek_after(c, key_to_u64(key));
+    }
+
+    // ==================================================================
+    // Order statistics (see kntrie_iter_ops): O(depth) via the exact
+    // descendant counts every bitmask keeps
+    // ==================================================================
+
+    // Keys < key
+    size_t rank(const KEY& key) const noexcept {
+        if (size_v == 0) return 0;
+        auto c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        return ITER_OPS::rank(c, root_ptr_v, size_v, key_to_u64(key));
+    }
+
+    // Keys in [lo, hi]. EXACT false interpolates inside the two boundary
+    // leaves instead of searching them.
+    template<bool EXACT>
+    size_t count_range(const KEY& lo, const KEY& hi) const noexcept {
+        if (size_v == 0 || hi < lo) return 0;
+        auto c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        bool hi_open = hi == static_cast<KEY>(~KEY(0));
+        uint64_t ik_hi = hi_open ? 0 : key_to_u64(static_cast<KEY>(hi + 1));
+        return ITER_OPS::template count_range<EXACT>(
+            c, root_ptr_v, size_v, key_to_u64(lo), ik_hi, hi_open);
+    }
+
+    // AGG fold of the values with keys in [lo, hi]
+    aggregate_type range_aggregate(const KEY& lo, const KEY& hi) const noexcept {
+        if (size_v == 0 || hi < lo) return AGG::identity();
+        auto c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        bool hi_open = hi == static_cast<KEY>(~KEY(0));
+        uint64_t ik_hi = hi_open ? 0 : key_to_u64(static_cast<KEY>(hi + 1));
+        return ITER_OPS::range_aggregate(c, root_ptr_v, key_to_u64(lo), ik_hi, hi_open);
+    }
 
-    iter_result_t to_iter_result(const typename BO::leaf_result_t& r) const noexcept {
-        IK internal = static_cast<IK>(r.key >> (64 - IK_BITS));
-        return {KO::to_key(internal), *VT::as_ptr(*r.value), true};
+    // The i-th smallest key
+    bool cursor_select(cursor_t& c, size_t i) const noexcept {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        if (i >= size_v) return false;
+        ITER_OPS::cursor_descend_select(c, root_ptr_v, i, size_v);
+        return true;
     }
 
-    iter_result_t iter_first() const noexcept {
-        if (begin_v == BO::SENTINEL_TAGGED) return {KEY{}, VALUE{}, false};
-        const uint64_t* leaf = untag_leaf(begin_v);
-        auto r = BO::leaf_fn(leaf)->first(leaf);
-        if (!r.found) return {KEY{}, VALUE{}, false};
-        return to_iter_result(r);
+    // Uniform random entry
+    template<typename RNG>
+    bool cursor_sample(cursor_t& c, RNG& rng) const {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        if (size_v == 0) return false;
+        ITER_OPS::cursor_sample(c, root_ptr_v, size_v, rng);
+        return true;
     }
 
-    iter_result_t iter_last() const noexcept {
-        if (end_v == BO::SENTINEL_TAGGED) return {KEY{}, VALUE{}, false};
-        const uint64_t* leaf = untag_leaf(end_v);
-        auto r = BO::leaf_fn(leaf)->last(leaf);
-        if (!r.found) return {KEY{}, VALUE{}, false};
-        return to_iter_result(r);
+    static bool cursor_advance(cursor_t& c, std::ptrdiff_t n) noexcept {
+        return ITER_OPS::cursor_advance(c, n);
     }
 
-    iter_result_t iter_next(KEY key) const noexcept {
+    // ==================================================================
+    // Coroutine lookups (see interleave_run): each suspends after
+    // prefetching the next node. The trie must outlive the task and stay
+    // unmodified until it completes; out must stay valid as well.
+    // ==================================================================
+
+    lookup_task_t find_co(KEY key, const VALUE** out) const {
         uint64_t ik = key_to_u64(key);
-        auto r = root_fn_v->iter_next(root_ptr_v, root_prefix_v, ik);
-        if (!r.found) return {KEY{}, VALUE{}, false};
-        return to_iter_result(r);
+        uint8_t skip = root_fn_v->skip;
+        uint64_t mask = skip ? ~uint64_t(0) << (64 - 8 * skip) : 0;
+        if ((ik ^ root_prefix_v) & mask) { *out = nullptr; co_return; }
+
+        uint64_t ptr = root_ptr_v;
+        int shift = 56 - 8 * skip;
+        while (!(ptr & LEAF_BIT)) {
+            ptr = OPS::find_step(ptr, ik, shift);
+            shift -= 8;
+            co_await prefetch_yield_t{OPS::node_addr(ptr)};
+        }
+        const uint64_t* node = untag_leaf(ptr);
+        *out = BO::leaf_fn(node)->find(node, ik);
     }
 
-    iter_result_t iter_prev(KEY key) const noexcept {
+    lookup_task_t lower_bound_co(KEY key, cursor_t* c, bool* found) const {
         uint64_t ik = key_to_u64(key);
-        auto r = root_fn_v->iter_prev(root_ptr_v, root_prefix_v, ik);
-        if (!r.found) return {KEY{}, VALUE{}, false};
-        return to_iter_result(r);
+        if (ik == 0 || size_v == 0) { *found = cursor_first(*c); co_return; }
+        ik -= KEY_UNIT;
+
+        using seek_t = typename ITER_OPS::seek_t;
+        *c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        uint64_t ptr = root_ptr_v;
+        seek_t st = ITER_OPS::cursor_seek_root(*c, ptr, ik);
+        while (st == seek_t::DESCEND) {
+            co_await prefetch_yield_t{OPS::node_addr(ptr)};
+            st = ITER_OPS::cursor_seek_step(*c, ptr, ik);
+        }
+        *found = (st == seek_t::FOUND);
+    }
+
+    static KEY cursor_key(const cursor_t& c) noexcept {
+        return KO::to_key(static_cast<IK>(c.key() >> (64 - IK_BITS)));
+    }
+
+    static const VALUE& cursor_value(const cursor_t& c) noexcept {
+        return *VT::as_ptr(*c.entry.value);
     }
 
 private:
@@ -510,31 +850,65 @@ private:
     // Insert dispatch
     // ==================================================================
 
-    template<bool INSERT, bool ASSIGN>
-    std::pair<bool, bool> insert_dispatch(const KEY& key, const VALUE& value) {
+    template<bool INSERT, bool ASSIGN, typename... ARGS>
+    std::pair<bool, bool> insert_dispatch(const KEY& key, ARGS&&... args) {
         uint64_t ik = key_to_u64(key);
-        VST sv = bld_v.store_value(value);
+        // Assign-only: a missing key must not consume the value
+        if constexpr (!INSERT) {
+            if (!find_value(key)) return {true, false};
+        }
+
+        // Out-of-line values are placed as raw storage and built only
+        // once the slot is taken (see builder::reserve_value). An assign
+        // always takes it, and destroys the old value on the way down,
+        // so it builds first: args may refer to that old value.
+        constexpr bool DEFER = !VT::IS_TRIVIAL && !ASSIGN;
+        VST sv;
+        if constexpr (DEFER)
+            sv = bld_v.reserve_value();
+        else
+            sv = bld_v.store_value(std::forward<ARGS>(args)...);
+
+        bool did_insert;
+        if constexpr (VT::IS_TRIVIAL) {
+            did_insert = insert_at_root<INSERT, ASSIGN>(ik, sv, no_hit_t{}).inserted;
+        } else {
+            try {
+                did_insert = insert_at_root<INSERT, ASSIGN>(ik, sv, no_hit_t{}).inserted;
+            } catch (...) {
+                if constexpr (DEFER) bld_v.release_value(sv);
+                else                 bld_v.destroy_value(sv);
+                throw;
+            }
+        }
+        if (did_insert) ++size_v;
+
+        // Plain insert: sv was placed, or rejected for an existing key
+        if constexpr (DEFER) {
+            if (did_insert) build_placed(key, sv, std::forward<ARGS>(args)...);
+            else bld_v.release_value(sv);
+        }
+        return {true, did_insert};
+    }
+
+    // Root prefix handling + insert_node. Does not touch size_v.
+    // The result's leaf is where an INSERT left ik.
+    template<bool INSERT, bool ASSIGN, typename HIT>
+    insert_result_t insert_at_root(uint64_t ik, VST sv, HIT hit) {
+        if (cow_active()) [[unlikely]]
+            skip_switch([&]<int BITS>() -> int {
+                COW_OPS::template unshare_path<BITS>(*cow_v, root_ptr_v, ik, bld_v);
+                return 0;
+            });
 
         // First insert: establish root fn and optional prefix
         if (size_v == 0) [[unlikely]] {
-            if constexpr (!INSERT) { bld_v.destroy_value(sv); return {true, false}; }
             set_root_skip(MAX_ROOT_SKIP);
             if constexpr (MAX_ROOT_SKIP > 0)
                 root_prefix_v = ik;
             // Fall through to normal insert
         }
 
-        // Capture begin/end state before mutation
-        bool is_first = (size_v == 0);
-        uint64_t min_key = 0, max_key = 0;
-        if (!is_first) {
-            const uint64_t* bl = untag_leaf(begin_v);
-            const uint64_t* el = untag_leaf(end_v);
-            min_key = BO::leaf_fn(bl)->first(bl).key;
-            max_key = BO::leaf_fn(el)->last(el).key;
-            bld_v.set_watches(bl, el);
-        }
-
         uint8_t skip = root_fn_v->skip;
 
         // Check prefix — find first divergence
@@ -542,7 +916,6 @@ private:
             uint64_t diff = ik ^ root_prefix_v;
             uint64_t mask = ~uint64_t(0) << (64 - 8 * skip);
             if (diff & mask) [[unlikely]] {
-                if constexpr (!INSERT) { bld_v.destroy_value(sv); bld_v.clear_watches(); return {true, false}; }
                 int clz = std::countl_zero(diff & mask);
                 uint8_t div_pos = static_cast<uint8_t>(clz / 8);
                 reduce_root_skip(div_pos);
@@ -551,30 +924,83 @@ private:
         }
 
         // Insert into subtree
-        bool did_insert = skip_switch([&]<int BITS>() -> bool {
+        return skip_switch([&]<int BITS>() -> insert_result_t {
             auto r = OPS::template insert_node<BITS, INSERT, ASSIGN>(
-                root_ptr_v, ik, sv, bld_v);
+                root_ptr_v, ik, sv, bld_v, hit);
             if (r.tagged_ptr != root_ptr_v) root_ptr_v = r.tagged_ptr;
-            return r.inserted;
+            return r;
         });
+    }
 
-        if (did_insert) {
-            ++size_v;
-            if (is_first) [[unlikely]] {
-                begin_v = refresh_begin();
-                end_v = refresh_end();
-            } else {
-                if (ik < min_key || bld_v.freed_a())
-                    begin_v = refresh_begin();
-                if (ik > max_key || bld_v.freed_b())
-                    end_v = refresh_end();
-            }
-            bld_v.clear_watches();
-            return {true, true};
+    // Construct a value whose block is already in the trie. If the
+    // constructor throws, the key is erased so no unbuilt value is visible.
+    template<typename... ARGS>
+    void build_placed(const KEY& key, VST sv, ARGS&&... args) {
+        try {
+            bld_v.construct_value(sv, std::forward<ARGS>(args)...);
+        } catch (...) {
+            bld_v.unbuilt_v = sv;
+            erase(key);
+            bld_v.unbuilt_v = nullptr;
+            throw;
         }
-        bld_v.clear_watches();
-        bld_v.destroy_value(sv);
-        return {true, false};
+    }
+
+    bool cursor_seek_after(cursor_t& c, uint64_t ik) const noexcept {
+        c = ITER_OPS::cursor_at_root(root_prefix_v, root_fn_v->skip);
+        if (size_v == 0) return false;
+        return ITER_OPS::cursor_seek_after(c, root_ptr_v, ik);
+    }
+
+    // ==================================================================
+    // Copy-on-write upkeep
+    // ==================================================================
+
+    // True if nodes may be shared with snapshots, so a write must first
+    // make private the nodes it touches.
+    bool cow_active() {
+        if (!cow_v) [[likely]] return false;
+        release_retired();
+        return cow_v && !cow_v->extra_v.empty();
+    }
+
+    // Release the roots of dropped snapshots. Once none is left nothing
+    // is shared, and writes go back to plain in-place updates.
+    void release_retired() {
+        bool last = cow_v->views_v.load(std::memory_order_acquire) == 0;
+        for (auto [root, skip] : cow_v->take_retired())
+            skip_switch(skip, [&]<int BITS>() -> int {
+                COW_OPS::template release<BITS>(*cow_v, root, bld_v);
+                return 0;
+            });
+        if (last) {
+            assert(cow_v->extra_v.empty());
+            cow_v.reset();
+        }
+    }
+
+    // Drop the tree and free the slabs. With snapshots still live their
+    // nodes sit in those slabs, so the builder goes to the shared state
+    // instead (see cow_state_t).
+    void release_storage() noexcept {
+        remove_all();
+        if (cow_v) {
+            static_cast<BLD*>(cow_v->bld_box_v)->swap(bld_v);
+            cow_v.reset();
+        }
+        bld_v.drain();
+    }
+
+    // cow_state_t::free_box_v: the writer left, so the last owner of the
+    // state frees the snapshots' roots and then the slabs
+    static void free_orphan(cow_state_t& cs, void* box) noexcept {
+        auto* bld = static_cast<BLD*>(box);
+        for (auto [root, skip] : cs.take_retired())
+            skip_switch(skip, [&]<int BITS>() -> int {
+                COW_OPS::template release<BITS>(cs, root, *bld);
+                return 0;
+            });
+        delete bld;
     }
 
     // ==================================================================
@@ -639,16 +1065,16 @@ private:
     // ==================================================================
 
     void remove_all() noexcept {
+        if (cow_v) release_retired();
         if (root_ptr_v == BO::SENTINEL_TAGGED) return;
         skip_switch([&]<int BITS>() -> int {
-            ITER_OPS::template remove_subtree<BITS>(root_ptr_v, bld_v);
+            if (cow_v) COW_OPS::template release<BITS>(*cow_v, root_ptr_v, bld_v);
+            else       ITER_OPS::template remove_subtree<BITS>(root_ptr_v, bld_v);
             return 0;
         });
         root_fn_v = &SENTINEL_ROOT_FN;
         root_ptr_v = BO::SENTINEL_TAGGED;
         root_prefix_v = 0;
-        begin_v = BO::SENTINEL_TAGGED;
-        end_v = BO::SENTINEL_TAGGED;
     }
 };
 
@@ -4,6 +4,7 @@
 #include "kntrie_bitmask.hpp"
 #include "kntrie_compact.hpp"
 #include "kntrie_ops.hpp"
+#include <random>
 
 namespace gteitelbaum {
 
@@ -18,19 +19,572 @@ struct kntrie_stats_t {
 };
 
 // ======================================================================
-// kntrie_iter_ops<VALUE, ALLOC> — destroy, stats.
+// kntrie_iter_ops<VALUE, ALLOC, KEY_BITS, AGG> — destroy, stats, cursors.
 //
-// Iteration moved to fn-pointer dispatch in kntrie_ops.
+// Leaf-level stepping is fn-pointer dispatch (leaf_fn_t::step_next/prev).
 // All functions take uint64_t ik. No NK narrowing.
 // ======================================================================
 
-template<typename VALUE, typename ALLOC, int KEY_BITS>
+template<typename VALUE, typename ALLOC, int KEY_BITS, typename AGG = no_aggregate_t>
 struct kntrie_iter_ops {
-    using BO  = bitmask_ops<VALUE, ALLOC>;
+    using BO  = bitmask_ops<VALUE, ALLOC, AGG>;
     using VT  = value_traits<VALUE, ALLOC>;
     using VST = typename VT::slot_type;
     using BLD = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
-    using OPS = kntrie_ops<VALUE, ALLOC, KEY_BITS>;
+    using OPS = kntrie_ops<VALUE, ALLOC, KEY_BITS, AGG>;
+
+    using leaf_result_t = typename BO::leaf_result_t;
+    using agg_t         = typename AGG::type;
+
+    // ==================================================================
+    // Cursor: leaf position + stack of bitmask levels above it.
+    //
+    // Every bitmask level (chain embeds included) is a bitmap with its
+    // children at bm[BITMAP_256_U64 + 1 + slot], so the walk is runtime
+    // and needs no BITS. ++/-- step inside the leaf and only climb when
+    // the leaf is exhausted. Key bytes above the leaf come from the path;
+    // the leaf result supplies the bytes from its own depth down.
+    // ==================================================================
+
+    // u16: 1, u32: 3, u64: 7 — BITS==8 is always a leaf
+    static constexpr int MAX_PATH = KEY_BITS / 8 - 1;
+    static constexpr uint64_t KEY_UNIT = uint64_t(1) << (64 - KEY_BITS);
+
+    struct cursor_t {
+        const uint64_t* path[MAX_PATH];  // bitmap per bitmask level
+        uint8_t         bytes[MAX_PATH]; // key byte taken at that level
+        uint8_t         depth;           // bitmask levels above leaf
+        uint8_t         root_skip;
+        uint64_t        prefix;          // root-level key bytes above leaf
+        const uint64_t* leaf;
+        leaf_result_t   entry;
+
+        uint64_t key() const noexcept {
+            return entry.key | (prefix & high_mask(root_skip + depth));
+        }
+    };
+
+    // Mask of the top n key bytes of a root-level ik
+    static constexpr uint64_t high_mask(int n) noexcept {
+        return n == 0 ? 0 : ~uint64_t(0) << (64 - 8 * n);
+    }
+
+    static cursor_t cursor_at_root(uint64_t root_prefix, uint8_t root_skip) noexcept {
+        cursor_t c;
+        c.depth = 0;
+        c.root_skip = root_skip;
+        c.prefix = root_prefix & high_mask(root_skip);
+        c.leaf = nullptr;
+        c.entry = {0, nullptr, false};
+        return c;
+    }
+
+    static const bitmap_256_t& bitmap_at(const uint64_t* bm) noexcept {
+        return *reinterpret_cast<const bitmap_256_t*>(bm);
+    }
+
+    static void cursor_push(cursor_t& c, const uint64_t* bm, uint8_t b) noexcept {
+        int shift = 56 - 8 * (c.root_skip + c.depth);
+        c.prefix = (c.prefix & ~(uint64_t(0xFF) << shift))
+                 | (uint64_t(b) << shift);
+        c.path[c.depth] = bm;
+        c.bytes[c.depth] = b;
+        ++c.depth;
+    }
+
+    static void cursor_descend_first(cursor_t& c, uint64_t ptr) noexcept {
+        while (!(ptr & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            cursor_push(c, bm, bitmap_at(bm).first_set_bit());
+            ptr = bm[BITMAP_256_U64 + 1];
+        }
+        c.leaf = untag_leaf(ptr);
+        c.entry = BO::leaf_fn(c.leaf)->first(c.leaf);
+    }
+
+    static void cursor_descend_last(cursor_t& c, uint64_t ptr) noexcept {
+        while (!(ptr & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            cursor_push(c, bm, bmp.last_set_bit());
+            ptr = bm[BITMAP_256_U64 + bmp.popcount()];
+        }
+        c.leaf = untag_leaf(ptr);
+        c.entry = BO::leaf_fn(c.leaf)->last(c.leaf);
+    }
+
+    // Leaf exhausted: pop to the nearest level with a later sibling
+    static bool cursor_climb_next(cursor_t& c) noexcept {
+        while (c.depth > 0) {
+            --c.depth;
+            const uint64_t* bm = c.path[c.depth];
+            auto adj = bitmap_at(bm).next_set_after(c.bytes[c.depth]);
+            if (adj.found) {
+                cursor_push(c, bm, adj.idx);
+                cursor_descend_first(c, bm[BITMAP_256_U64 + 1 + adj.slot]);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool cursor_climb_prev(cursor_t& c) noexcept {
+        while (c.depth > 0) {
+            --c.depth;
+            const uint64_t* bm = c.path[c.depth];
+            auto adj = bitmap_at(bm).prev_set_before(c.bytes[c.depth]);
+            if (adj.found) {
+                cursor_push(c, bm, adj.idx);
+                cursor_descend_last(c, bm[BITMAP_256_U64 + 1 + adj.slot]);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool cursor_next(cursor_t& c) noexcept {
+        auto r = BO::leaf_fn(c.leaf)->step_next(c.leaf, c.entry.pos);
+        if (r.found) [[likely]] { c.entry = r; return true; }
+        return cursor_climb_next(c);
+    }
+
+    static bool cursor_prev(cursor_t& c) noexcept {
+        auto r = BO::leaf_fn(c.leaf)->step_prev(c.leaf, c.entry.pos);
+        if (r.found) [[likely]] { c.entry = r; return true; }
+        return cursor_climb_prev(c);
+    }
+
+    // --- Seek: smallest key > ik, one level per step ---
+    // cursor_seek_root checks the root prefix; each cursor_seek_step
+    // consumes one node. DESCEND leaves ptr on the next node, which the
+    // caller may prefetch (or yield on) before stepping again.
+    enum class seek_t : uint8_t { DESCEND, FOUND, END };
+
+    static seek_t cursor_seek_root(cursor_t& c, uint64_t ptr, uint64_t ik) noexcept {
+        if (c.root_skip > 0) {
+            uint64_t kp = ik & high_mask(c.root_skip);
+            if (kp != c.prefix) [[unlikely]] {
+                if (kp > c.prefix) return seek_t::END;
+                cursor_descend_first(c, ptr);
+                return seek_t::FOUND;
+            }
+        }
+        return seek_t::DESCEND;
+    }
+
+    static seek_t cursor_seek_step(cursor_t& c, uint64_t& ptr, uint64_t ik) noexcept {
+        if (ptr & LEAF_BIT) {
+            c.leaf = untag_leaf(ptr);
+            auto r = BO::leaf_fn(c.leaf)->next(c.leaf, ik);
+            if (r.found) { c.entry = r; return seek_t::FOUND; }
+            return cursor_climb_next(c) ? seek_t::FOUND : seek_t::END;
+        }
+        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+        const bitmap_256_t& bmp = bitmap_at(bm);
+        uint8_t b = static_cast<uint8_t>(
+            ik >> (56 - 8 * (c.root_skip + c.depth)));
+        int slot = bmp.find_slot<slot_mode::FAST_EXIT>(b);
+        if (slot >= 0) [[likely]] {
+            cursor_push(c, bm, b);
+            ptr = bm[BITMAP_256_U64 + 1 + slot];
+            return seek_t::DESCEND;
+        }
+        auto adj = bmp.next_set_after(b);
+        if (adj.found) {
+            cursor_push(c, bm, adj.idx);
+            cursor_descend_first(c, bm[BITMAP_256_U64 + 1 + adj.slot]);
+            return seek_t::FOUND;
+        }
+        return cursor_climb_next(c) ? seek_t::FOUND : seek_t::END;
+    }
+
+    // c must come from cursor_at_root.
+    static bool cursor_seek_after(cursor_t& c, uint64_t ptr, uint64_t ik) noexcept {
+        seek_t st = cursor_seek_root(c, ptr, ik);
+        while (st == seek_t::DESCEND)
+            st = cursor_seek_step(c, ptr, ik);
+        return st == seek_t::FOUND;
+    }
+
+    // Cursor at ik itself: a plain descent with no neighbour fallback,
+    // false as soon as ik is known absent. c must come from cursor_at_root.
+    static bool cursor_seek_exact(cursor_t& c, uint64_t ptr, uint64_t ik) noexcept {
+        if (c.root_skip > 0 && (ik & high_mask(c.root_skip)) != c.prefix)
+            [[unlikely]] return false;
+        while (!(ptr & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            uint8_t b = static_cast<uint8_t>(
+                ik >> (56 - 8 * (c.root_skip + c.depth)));
+            int slot = bitmap_at(bm).find_slot<slot_mode::FAST_EXIT>(b);
+            if (slot < 0) return false;
+            cursor_push(c, bm, b);
+            ptr = bm[BITMAP_256_U64 + 1 + slot];
+        }
+        c.leaf = untag_leaf(ptr);
+        // ik is the leaf's first key > ik - 1, unless ik's bytes below
+        // the path are all zero: then it can only be the leaf's first key
+        const auto* fn = BO::leaf_fn(c.leaf);
+        c.entry = (ik & ~high_mask(c.root_skip + c.depth))
+                ? fn->next(c.leaf, ik - KEY_UNIT) : fn->first(c.leaf);
+        return c.entry.found && c.key() == ik;
+    }
+
+    // ==================================================================
+    // Order statistics: rank / select / advance in O(depth).
+    //
+    // A bitmap with two or more bits is always a final bitmap, so its
+    // children are real nodes and exact_subtree_count() sizes each one.
+    // A single-bit bitmap (chain embed, or a one-child bitmask) passes
+    // its whole subtree through, so its child is never sized: the walk
+    // carries the current subtree's total down instead. Each level sums
+    // the siblings on the shorter side of the target.
+    // ==================================================================
+
+    // Sum of exact_subtree_count over child slots [from, to)
+    static uint64_t sum_counts(const uint64_t* bm, int from, int to) noexcept {
+        uint64_t sum = 0;
+        for (int s = from; s < to; ++s)
+            sum += BO::exact_subtree_count(bm[BITMAP_256_U64 + 1 + s]);
+        return sum;
+    }
+
+    // Leaf entries with key < ik; the leaf's keys differ only in the low
+    // `bits` bits of an ik. EXACT asks the leaf; otherwise interpolate
+    // between its first and last keys, which never scans.
+    template<bool EXACT>
+    static uint64_t leaf_rank(const uint64_t* leaf, uint64_t ik, int bits) noexcept {
+        const auto* fn = BO::leaf_fn(leaf);
+        if constexpr (EXACT) {
+            return fn->rank(leaf, ik);
+        } else {
+            uint64_t low_mask = bits >= 64 ? ~uint64_t(0)
+                                           : (uint64_t(1) << bits) - 1;
+            uint64_t k = ik & low_mask;
+            uint64_t first = fn->first(leaf).key & low_mask;
+            uint64_t last  = fn->last(leaf).key & low_mask;
+            uint64_t e = get_header(leaf)->entries();
+            if (k <= first) return 0;
+            if (k > last)   return e;
+            double frac = double(k - first) / (double(last - first) + 1.0);
+            return std::min<uint64_t>(e - 1, 1 + uint64_t(frac * double(e - 1)));
+        }
+    }
+
+    // Entries with key < ik under ptr, whose subtree holds total; shift
+    // is the byte ptr's first bitmap dispatches on
+    template<bool EXACT = true>
+    static uint64_t subtree_rank(uint64_t ptr, uint64_t total, uint64_t ik,
+                                 int shift) noexcept {
+        uint64_t below = 0;
+        for (; !(ptr & LEAF_BIT); shift -= 8) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            uint8_t b = static_cast<uint8_t>(ik >> shift);
+            int nc = bmp.popcount();
+            if (nc == 1) {
+                uint8_t only = bmp.first_set_bit();
+                if (only != b) return below + (only < b ? total : 0);
+                ptr = bm[BITMAP_256_U64 + 1];
+                continue;
+            }
+            int lt = bmp.find_slot<slot_mode::UNFILTERED>(b);
+            // Count the shorter side: below b, or total minus b and above
+            below += lt <= nc / 2 ? sum_counts(bm, 0, lt)
+                                  : total - sum_counts(bm, lt, nc);
+            if (!bmp.has_bit(b)) return below;
+            ptr = bm[BITMAP_256_U64 + 1 + lt];
+            total = BO::exact_subtree_count(ptr);
+        }
+        return below + leaf_rank<EXACT>(untag_leaf(ptr), ik, shift + 8);
+    }
+
+    // Entries with key < ik. c must come from cursor_at_root; only its
+    // root prefix is used.
+    static uint64_t rank(const cursor_t& c, uint64_t ptr, uint64_t total,
+                         uint64_t ik) noexcept {
+        if (c.root_skip > 0) {
+            uint64_t kp = ik & high_mask(c.root_skip);
+            if (kp != c.prefix) return kp < c.prefix ? 0 : total;
+        }
+        return subtree_rank(ptr, total, ik, 56 - 8 * c.root_skip);
+    }
+
+    // Entries with lo <= key < hi (hi_open: no upper bound). Descends
+    // once while lo and hi share a child; where they part, children
+    // strictly between are summed whole and only the two boundary
+    // children are ranked. lo < hi when !hi_open.
+    template<bool EXACT = true>
+    static uint64_t count_range(const cursor_t& c, uint64_t ptr, uint64_t total,
+                                uint64_t lo, uint64_t hi, bool hi_open) noexcept {
+        if (c.root_skip > 0) {
+            uint64_t mask = high_mask(c.root_skip);
+            if ((lo & mask) > c.prefix) return 0;
+            if (!hi_open && (hi & mask) < c.prefix) return 0;
+            if ((lo & mask) < c.prefix) lo = c.prefix;
+            if (!hi_open && (hi & mask) > c.prefix) hi_open = true;
+        }
+        int shift = 56 - 8 * c.root_skip;
+        for (; !(ptr & LEAF_BIT); shift -= 8) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const uint64_t* ch = bm + BITMAP_256_U64 + 1;
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            unsigned bl = static_cast<uint8_t>(lo >> shift);
+            unsigned bh = hi_open ? 256 : static_cast<uint8_t>(hi >> shift);
+            int nc = bmp.popcount();
+
+            // One child on both paths (or the only child): follow it
+            if (nc == 1 || bl == bh) {
+                unsigned b = nc == 1 ? bmp.first_set_bit() : bl;
+                if (b < bl || b > bh) return 0;
+                int slot = nc == 1 ? 0 : bmp.find_slot<slot_mode::FAST_EXIT>(uint8_t(b));
+                if (slot < 0) return 0;
+                if (nc > 1) total = BO::exact_subtree_count(ch[slot]);
+                if (b == bl && b == bh) { ptr = ch[slot]; continue; }
+                if (b == bl)
+                    return total - subtree_rank<EXACT>(ch[slot], total, lo, shift - 8);
+                if (b == bh)
+                    return subtree_rank<EXACT>(ch[slot], total, hi, shift - 8);
+                return total;
+            }
+
+            // The paths part here. Slots [mid_lo, mid_hi) lie strictly
+            // between; the boundary children (if present) are ranked.
+            bool lo_hit = bmp.has_bit(uint8_t(bl));
+            bool hi_hit = bh < 256 && bmp.has_bit(uint8_t(bh));
+            int lo_slot = bmp.find_slot<slot_mode::UNFILTERED>(uint8_t(bl));
+            int hi_slot = bh < 256 ? bmp.find_slot<slot_mode::UNFILTERED>(uint8_t(bh)) : nc;
+            int mid_lo = lo_slot + lo_hit, mid_hi = hi_slot;
+            uint64_t lo_cnt = lo_hit ? BO::exact_subtree_count(ch[lo_slot]) : 0;
+            uint64_t hi_cnt = hi_hit ? BO::exact_subtree_count(ch[hi_slot]) : 0;
+            uint64_t n = mid_hi - mid_lo <= nc / 2
+                ? sum_counts(bm, mid_lo, mid_hi)
+                : total - lo_cnt - hi_cnt - sum_counts(bm, 0, lo_slot)
+                        - sum_counts(bm, hi_slot + hi_hit, nc);
+            if (lo_hit)
+                n += lo_cnt - subtree_rank<EXACT>(ch[lo_slot], lo_cnt, lo, shift - 8);
+            if (hi_hit)
+                n += subtree_rank<EXACT>(ch[hi_slot], hi_cnt, hi, shift - 8);
+            return n;
+        }
+        const uint64_t* leaf = untag_leaf(ptr);
+        uint64_t upto = hi_open ? total : leaf_rank<EXACT>(leaf, hi, shift + 8);
+        return upto - leaf_rank<EXACT>(leaf, lo, shift + 8);
+    }
+
+    // ==================================================================
+    // Range aggregates: the AGG fold of every value with lo <= key < hi.
+    // The count_range walk, with a final bitmap's per-child aggs in
+    // place of subtree counts. AGG need not be invertible (min / max),
+    // so a boundary child folds its own side of the key instead of
+    // subtracting the other.
+    // ==================================================================
+
+    // Whole subtree: single-bit bitmaps pass through to the node below
+    static agg_t whole_aggregate(uint64_t ptr) noexcept {
+        while (!(ptr & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            int nc = bitmap_at(bm).popcount();
+            if (nc > 1) return BO::fold_aggs(BO::aggs_at(bm, nc), 0, nc);
+            ptr = bm[BITMAP_256_U64 + 1];
+        }
+        const uint64_t* leaf = untag_leaf(ptr);
+        return BO::leaf_fn(leaf)->aggregate(leaf, 0, 0, true);
+    }
+
+    // Keys < ik (BELOW) or >= ik under ptr; shift is the byte ptr's
+    // first bitmap dispatches on
+    template<bool BELOW>
+    static agg_t side_aggregate(uint64_t ptr, uint64_t ik, int shift) noexcept {
+        agg_t a = AGG::identity();
+        for (; !(ptr & LEAF_BIT); shift -= 8) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            uint8_t b = static_cast<uint8_t>(ik >> shift);
+            int nc = bmp.popcount();
+            if (nc == 1) {
+                uint8_t only = bmp.first_set_bit();
+                if (only != b)
+                    return (only < b) == BELOW ? AGG::combine(a, whole_aggregate(ptr)) : a;
+                ptr = bm[BITMAP_256_U64 + 1];
+                continue;
+            }
+            int lt = bmp.find_slot<slot_mode::UNFILTERED>(b);
+            bool hit = bmp.has_bit(b);
+            const uint64_t* aggs = BO::aggs_at(bm, nc);
+            a = AGG::combine(a, BELOW ? BO::fold_aggs(aggs, 0, lt)
+                                      : BO::fold_aggs(aggs, lt + hit, nc));
+            if (!hit) return a;
+            ptr = bm[BITMAP_256_U64 + 1 + lt];
+        }
+        const uint64_t* leaf = untag_leaf(ptr);
+        return AGG::combine(a, BELOW
+            ? BO::leaf_fn(leaf)->aggregate(leaf, 0, ik, false)
+            : BO::leaf_fn(leaf)->aggregate(leaf, ik, 0, true));
+    }
+
+    // lo < hi when !hi_open; c as for count_range
+    static agg_t range_aggregate(const cursor_t& c, uint64_t ptr,
+                                 uint64_t lo, uint64_t hi, bool hi_open) noexcept {
+        if (c.root_skip > 0) {
+            uint64_t mask = high_mask(c.root_skip);
+            if ((lo & mask) > c.prefix) return AGG::identity();
+            if (!hi_open && (hi & mask) < c.prefix) return AGG::identity();
+            if ((lo & mask) < c.prefix) lo = c.prefix;
+            if (!hi_open && (hi & mask) > c.prefix) hi_open = true;
+        }
+        int shift = 56 - 8 * c.root_skip;
+        for (; !(ptr & LEAF_BIT); shift -= 8) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const uint64_t* ch = bm + BITMAP_256_U64 + 1;
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            unsigned bl = static_cast<uint8_t>(lo >> shift);
+            unsigned bh = hi_open ? 256 : static_cast<uint8_t>(hi >> shift);
+            int nc = bmp.popcount();
+
+            // One child on both paths (or the only child): follow it
+            if (nc == 1 || bl == bh) {
+                unsigned b = nc == 1 ? bmp.first_set_bit() : bl;
+                if (b < bl || b > bh) return AGG::identity();
+                int slot = nc == 1 ? 0 : bmp.find_slot<slot_mode::FAST_EXIT>(uint8_t(b));
+                if (slot < 0) return AGG::identity();
+                if (b == bl && b == bh) { ptr = ch[slot]; continue; }
+                if (b == bl) return side_aggregate<false>(ch[slot], lo, shift - 8);
+                if (b == bh) return side_aggregate<true>(ch[slot], hi, shift - 8);
+                return whole_aggregate(ch[slot]);
+            }
+
+            // The paths part here: fold the slots strictly between, then
+            // each boundary child's side
+            bool lo_hit = bmp.has_bit(uint8_t(bl));
+            bool hi_hit = bh < 256 && bmp.has_bit(uint8_t(bh));
+            int lo_slot = bmp.find_slot<slot_mode::UNFILTERED>(uint8_t(bl));
+            int hi_slot = bh < 256 ? bmp.find_slot<slot_mode::UNFILTERED>(uint8_t(bh)) : nc;
+            agg_t a = BO::fold_aggs(BO::aggs_at(bm, nc), lo_slot + lo_hit, hi_slot);
+            if (lo_hit)
+                a = AGG::combine(a, side_aggregate<false>(ch[lo_slot], lo, shift - 8));
+            if (hi_hit)
+                a = AGG::combine(a, side_aggregate<true>(ch[hi_slot], hi, shift - 8));
+            return a;
+        }
+        const uint64_t* leaf = untag_leaf(ptr);
+        return BO::leaf_fn(leaf)->aggregate(leaf, lo, hi, hi_open);
+    }
+
+    // Descend to the leaf holding the i-th entry under ptr (i < total),
+    // pushing the path. Sets c.leaf; returns i's index inside it.
+    static unsigned cursor_descend_to(cursor_t& c, uint64_t ptr, uint64_t i,
+                                      uint64_t total) noexcept {
+        while (!(ptr & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+            const bitmap_256_t& bmp = bitmap_at(bm);
+            int nc = bmp.popcount();
+            if (nc == 1) {
+                cursor_push(c, bm, bmp.first_set_bit());
+                ptr = bm[BITMAP_256_U64 + 1];
+                continue;
+            }
+            if (i < total / 2) {
+                for (int s = 0;; ++s) {
+                    uint64_t child = bm[BITMAP_256_U64 + 1 + s];
+                    uint64_t n = BO::exact_subtree_count(child);
+                    if (i < n) {
+                        cursor_push(c, bm, bmp.select(s));
+                        ptr = child;
+                        total = n;
+                        break;
+                    }
+                    i -= n;
+                }
+            } else {
+                // Count back from the last child: j entries follow the target
+                uint64_t j = total - 1 - i;
+                for (int s = nc - 1;; --s) {
+                    uint64_t child = bm[BITMAP_256_U64 + 1 + s];
+                    uint64_t n = BO::exact_subtree_count(child);
+                    if (j < n) {
+                        cursor_push(c, bm, bmp.select(s));
+                        ptr = child;
+                        total = n;
+                        i = n - 1 - j;
+                        break;
+                    }
+                    j -= n;
+                }
+            }
+        }
+        c.leaf = untag_leaf(ptr);
+        return static_cast<unsigned>(i);
+    }
+
+    static void cursor_descend_select(cursor_t& c, uint64_t ptr, uint64_t i,
+                                      uint64_t total) noexcept {
+        unsigned li = cursor_descend_to(c, ptr, i, total);
+        c.entry = BO::leaf_fn(c.leaf)->select(c.leaf, li);
+    }
+
+    // Uniform random entry under ptr (total > 0). The descent picks each
+    // child with probability count / total, so only the leaf pick is
+    // left; that one redraws instead of scanning (see leaf_fn_t::sample).
+    template<typename RNG>
+    static void cursor_sample(cursor_t& c, uint64_t ptr, uint64_t total, RNG& rng) {
+        std::uniform_int_distribution<uint64_t> pick(0, total - 1);
+        cursor_descend_to(c, ptr, pick(rng), total);
+        std::uniform_int_distribution<uint64_t> word;
+        const auto* fn = BO::leaf_fn(c.leaf);
+        do c.entry = fn->sample(c.leaf, word(rng));
+        while (!c.entry.found);
+    }
+
+    // Move c by n entries. False (c unusable) if that leaves the trie.
+    static bool cursor_advance(cursor_t& c, int64_t n) noexcept {
+        const auto* fn = BO::leaf_fn(c.leaf);
+        int64_t r = fn->rank(c.leaf, c.entry.key);
+        int64_t e = get_header(c.leaf)->entries();
+        if (r + n >= 0 && r + n < e) {
+            c.entry = fn->select(c.leaf, static_cast<unsigned>(r + n));
+            return true;
+        }
+        if (n > 0) {
+            // skip entries past this leaf, then take the next one
+            uint64_t skip = static_cast<uint64_t>(r + n - e);
+            while (c.depth > 0) {
+                --c.depth;
+                const uint64_t* bm = c.path[c.depth];
+                const bitmap_256_t& bmp = bitmap_at(bm);
+                for (auto adj = bmp.next_set_after(c.bytes[c.depth]); adj.found;
+                     adj = bmp.next_set_after(adj.idx)) {
+                    uint64_t child = bm[BITMAP_256_U64 + 1 + adj.slot];
+                    uint64_t cnt = BO::exact_subtree_count(child);
+                    if (skip < cnt) {
+                        cursor_push(c, bm, adj.idx);
+                        cursor_descend_select(c, child, skip, cnt);
+                        return true;
+                    }
+                    skip -= cnt;
+                }
+            }
+        } else {
+            // entries before this leaf, counted back from its first
+            uint64_t skip = static_cast<uint64_t>(-(r + n) - 1);
+            while (c.depth > 0) {
+                --c.depth;
+                const uint64_t* bm = c.path[c.depth];
+                const bitmap_256_t& bmp = bitmap_at(bm);
+                for (auto adj = bmp.prev_set_before(c.bytes[c.depth]); adj.found;
+                     adj = bmp.prev_set_before(adj.idx)) {
+                    uint64_t child = bm[BITMAP_256_U64 + 1 + adj.slot];
+                    uint64_t cnt = BO::exact_subtree_count(child);
+                    if (skip < cnt) {
+                        cursor_push(c, bm, adj.idx);
+                        cursor_descend_select(c, child, cnt - 1 - skip, cnt);
+                        return true;
+                    }
+                    skip -= cnt;
+                }
+            }
+        }
+        return false;
+    }
 
     // ==================================================================
     // Destroy leaf: compile-time NK dispatch via BITS
@@ -113,6 +667,182 @@ struct kntrie_iter_ops {
         });
     }
 
+    // ==================================================================
+    // Clone subtree: one block copy per node, child pointers rewritten.
+    // dst is written before descending, so if a value copy throws the
+    // partial tree (unfilled slots hold the sentinel) is well-formed for
+    // remove_subtree.
+    // ==================================================================
+
+    template<int BITS> requires (BITS >= 8)
+    static void clone_subtree(uint64_t tagged, uint64_t& dst, BLD& bld) {
+        if (tagged == BO::SENTINEL_TAGGED) { dst = tagged; return; }
+
+        if (tagged & LEAF_BIT) {
+            const uint64_t* node = untag_leaf(tagged);
+            dst = tag_leaf(clone_leaf_skip<BITS>(node, get_header(node)->skip(), bld));
+            return;
+        }
+
+        const uint64_t* node = bm_to_node_const(tagged);
+        uint8_t sc = get_header(node)->skip();
+        uint64_t* nn = BO::clone_bitmask(node, bld);
+        dst = tag_bitmask(nn);
+        clone_chain_skip<BITS>(node, nn, sc, 0, bld);
+    }
+
+    // Leaf skip: consume prefix bytes, then copy at the leaf's NK
+    template<int BITS> requires (BITS >= 8)
+    static uint64_t* clone_leaf_skip(const uint64_t* node, uint8_t skip,
+                                       BLD& bld) {
+        if (skip == 0) {
+            using NK = nk_for_bits_t<BITS>;
+            if constexpr (sizeof(NK) == 1)
+                return BO::bitmap_clone(node, bld);
+            else
+                return compact_ops<NK, VALUE, ALLOC>::clone(node, bld);
+        }
+        if constexpr (BITS > 8)
+            return clone_leaf_skip<BITS - 8>(node, skip - 1, bld);
+        __builtin_unreachable();
+    }
+
+    // Chain embed: consume skip bytes, then clone each final child
+    template<int BITS> requires (BITS >= 8)
+    static void clone_chain_skip(const uint64_t* node, uint64_t* nn,
+                                   uint8_t sc, uint8_t pos, BLD& bld) {
+        if (pos < sc) {
+            if constexpr (BITS > 8)
+                clone_chain_skip<BITS - 8>(node, nn, sc, pos + 1, bld);
+            return;
+        }
+        if constexpr (BITS > 8) {
+            const uint64_t* sch = BO::chain_children(node, sc);
+            uint64_t* dch = BO::chain_children_mut(nn, sc);
+            unsigned nc = get_header(node)->entries();
+            for (unsigned i = 0; i < nc; ++i)
+                clone_subtree<BITS - 8>(sch[i], dch[i], bld);
+        }
+    }
+
+    // ==================================================================
+    // Range erase: drop root-level iks in [key_lo, key_hi] from the
+    // subtree at tagged, whose keys all lie in [base, base | low bits].
+    // Children fully inside the range go whole to drop (remove_subtree,
+    // or a release when snapshots share them); only the leaves on the
+    // two boundary paths are rebuilt, and each bitmask on those paths
+    // settles once. Returns the new tagged ptr,
+    // 0 if the subtree emptied.
+    // ==================================================================
+
+    // All iks below the byte at BITS
+    template<int BITS>
+    static constexpr uint64_t low_bits() noexcept {
+        return ~uint64_t(0) >> (56 - OPS::template byte_shift<BITS>());
+    }
+
+    template<int BITS, typename DROP> requires (BITS >= 8)
+    static uint64_t erase_range(uint64_t tagged, uint64_t base,
+                                  uint64_t key_lo, uint64_t key_hi,
+                                  size_t& erased, BLD& bld, DROP& drop) {
+        if (tagged == BO::SENTINEL_TAGGED) [[unlikely]] return tagged;
+        if (key_hi < base || key_lo > (base | low_bits<BITS>())) return tagged;
+        if (key_lo <= base && (base | low_bits<BITS>()) <= key_hi) {
+            erased += BO::exact_subtree_count(tagged);
+            drop.template operator()<BITS>(tagged);
+            return 0;
+        }
+
+        if (tagged & LEAF_BIT)
+            return OPS::template erase_leaf_if<BITS>(untag_leaf_mut(tagged), base,
+                [&](uint64_t ik) { return key_lo <= ik && ik <= key_hi; },
+                erased, bld);
+
+        uint64_t* node = bm_to_node(tagged);
+        uint8_t sc = get_header(node)->skip();
+        if (sc > 0) [[unlikely]] {
+            // Narrow to the keys that follow the chain
+            for (uint8_t pos = 0; pos < sc; ++pos)
+                base |= uint64_t(BO::skip_byte(node, pos))
+                        << (OPS::template byte_shift<BITS>() - 8 * pos);
+            uint64_t top = base | ((uint64_t(1) <<
+                (OPS::template byte_shift<BITS>() - 8 * (sc - 1))) - 1);
+            if (key_hi < base || key_lo > top) return tagged;
+            if (key_lo <= base && top <= key_hi) {
+                erased += BO::exact_subtree_count(tagged);
+                drop.template operator()<BITS>(tagged);
+                return 0;
+            }
+        }
+        return erase_range_chain<BITS>(node, sc, 0, base, key_lo, key_hi,
+                                       erased, bld, drop);
+    }
+
+    template<int BITS, typename DROP> requires (BITS >= 8)
+    static uint64_t erase_range_chain(uint64_t* node, uint8_t sc, uint8_t pos,
+                                        uint64_t base, uint64_t key_lo,
+                                        uint64_t key_hi, size_t& erased,
+                                        BLD& bld, DROP& drop) {
+        if (pos >= sc)
+            return erase_range_final<BITS>(node, sc, base, key_lo, key_hi,
+                                           erased, bld, drop);
+        if constexpr (BITS > 8)
+            return erase_range_chain<BITS - 8>(node, sc, pos + 1, base,
+                                               key_lo, key_hi, erased, bld, drop);
+        __builtin_unreachable();
+    }
+
+    // Only the children under the bytes of key_lo / key_hi can be partly
+    // covered; every child strictly between them goes whole.
+    template<int BITS, typename DROP> requires (BITS >= 8)
+    static uint64_t erase_range_final(uint64_t* node, uint8_t sc,
+                                        uint64_t base, uint64_t key_lo,
+                                        uint64_t key_hi, size_t& erased,
+                                        BLD& bld, DROP& drop) {
+        if constexpr (BITS > 8) {
+            constexpr int SHIFT = OPS::template byte_shift<BITS>();
+            unsigned b_lo = key_lo > base
+                ? OPS::template extract_byte<BITS>(key_lo) : 0;
+            unsigned b_hi = key_hi < (base | low_bits<BITS>())
+                ? OPS::template extract_byte<BITS>(key_hi) : 255;
+
+            size_t before = erased;
+            bool removed = false;
+            for (unsigned b = b_lo; b <= b_hi; ++b) {
+                uint8_t ti = static_cast<uint8_t>(b);
+                auto* hdr = get_header(node);
+                typename BO::child_lookup cl = sc > 0
+                    ? BO::chain_lookup(node, sc, ti) : BO::lookup(node, ti);
+                if (!cl.found) continue;
+                size_t was = erased;
+                uint64_t c = erase_range<BITS - 8>(cl.child,
+                    base | (uint64_t(ti) << SHIFT), key_lo, key_hi, erased, bld, drop);
+                if (c == 0) {
+                    node = sc > 0
+                        ? BO::chain_remove_child(node, hdr, sc, cl.slot, ti, bld)
+                        : BO::remove_child(node, hdr, cl.slot, ti, bld);
+                    if (!node) return 0;  // last child gone
+                    removed = true;
+                } else {
+                    if (c != cl.child) {
+                        if (sc > 0) BO::chain_set_child(node, sc, cl.slot, c);
+                        else        BO::set_child(node, cl.slot, c);
+                    }
+                    if constexpr (HAS_AGG<AGG>)
+                        if (erased != was) BO::refresh_agg(node, sc, cl.slot);
+                }
+            }
+            if (erased == before) return tag_bitmask(node);
+
+            auto* hdr = get_header(node);
+            uint64_t& d = BO::chain_descendants_mut(node, sc, hdr->entries());
+            d -= erased - before;
+            if (!removed && d > COALESCE_MAX) return tag_bitmask(node);
+            return OPS::template settle_bitmask<BITS>(node, sc, d, bld).tagged_ptr;
+        }
+        __builtin_unreachable();
+    }
+
     // ==================================================================
     // Stats collection: no NK narrowing
     // ==================================================================
@@ -124,7 +854,7 @@ struct kntrie_iter_ops {
         if (tagged & LEAF_BIT) {
             const uint64_t* node = untag_leaf(tagged);
             auto* hdr = get_header(node);
-            s.total_bytes += static_cast<size_t>(hdr->alloc_u64()) * 8;
+            s.total_bytes += block_u64(hdr->alloc_u64()) * 8;
             s.total_entries += hdr->entries();
             uint8_t skip = hdr->skip();
             if (skip)
@@ -139,7 +869,7 @@ struct kntrie_iter_ops {
 
         const uint64_t* node = bm_to_node_const(tagged);
         auto* hdr = get_header(node);
-        s.total_bytes += static_cast<size_t>(hdr->alloc_u64()) * 8;
+        s.total_bytes += block_u64(hdr->alloc_u64()) * 8;
         s.bitmask_nodes++;
         s.bm_children += hdr->entries();
         uint8_t sc = hdr->skip();
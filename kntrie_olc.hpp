@@ -0,0 +1,733 @@
+#ifndef KNTRIE_OLC_HPP
+#define KNTRIE_OLC_HPP
+
+#include "kntrie_iter_ops.hpp"
+#include "kntrie_epoch.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gteitelbaum {
+
+// ==========================================================================
+// olc_word — version/lock word of a bitmask node (node_header_t::reserved_v)
+//
+//   bit 0     LOCKED    a writer holds the node
+//   bit 1     OBSOLETE  the node was unlinked; a writer reaching it restarts
+//   bits 2-7  version, bumped by every unlock
+//
+// A writer reads versions on the way down and upgrade()s only the nodes
+// it changes; an upgrade fails if the node moved on since it was read.
+// ==========================================================================
+
+struct olc_word {
+    static constexpr uint8_t LOCKED   = 1;
+    static constexpr uint8_t OBSOLETE = 2;
+    static constexpr uint8_t VERSION  = 4;
+
+    static std::atomic_ref<uint8_t> ref(uint8_t& w) noexcept {
+        return std::atomic_ref<uint8_t>(w);
+    }
+
+    // Version to descend under; waits out a writer holding the node
+    static uint8_t read(uint8_t& w) noexcept {
+        uint8_t v = ref(w).load(std::memory_order_acquire);
+        for (unsigned spins = 1; v & LOCKED; ++spins) {
+            if (spins % 64 == 0) std::this_thread::yield();
+            v = ref(w).load(std::memory_order_acquire);
+        }
+        return v;
+    }
+
+    static bool upgrade(uint8_t& w, uint8_t v) noexcept {
+        if (v & (LOCKED | OBSOLETE)) return false;
+        return ref(w).compare_exchange_strong(v, static_cast<uint8_t>(v | LOCKED),
+            std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    static void unlock(uint8_t& w, bool obsolete = false) noexcept {
+        uint8_t v = ref(w).load(std::memory_order_relaxed);
+        uint8_t nv = static_cast<uint8_t>((v & ~LOCKED) + VERSION);
+        if (obsolete) nv |= OBSOLETE;
+        ref(w).store(nv, std::memory_order_release);
+    }
+};
+
+// Child slots of published nodes are the only words written while
+// readers may be looking at them
+inline uint64_t olc_load(const uint64_t& slot) noexcept {
+    return std::atomic_ref<uint64_t>(const_cast<uint64_t&>(slot))
+        .load(std::memory_order_acquire);
+}
+
+inline void olc_publish(uint64_t& slot, uint64_t tagged) noexcept {
+    std::atomic_ref<uint64_t>(slot).store(tagged, std::memory_order_seq_cst);
+}
+
+// ==========================================================================
+// olc_path_t — the bitmask nodes a writer passed through, root first.
+//
+// steps[0] is the root slot under the container's own lock word. Each
+// step records the node's version when read, and the slot taken out of
+// it with the child seen there (slot is null where the writer stopped).
+// ==========================================================================
+
+struct olc_step_t {
+    uint8_t*  lock;      // lock word of the node holding slot
+    uint64_t* slot;      // child slot descended through, or nullptr
+    uint64_t  child;     // *slot when read
+    uint64_t* node;      // bitmask node; nullptr for the root step
+    int       index;     // slot's index in the final bitmap
+    unsigned  entries;   // node's child count
+    uint8_t   version;
+    uint8_t   byte;      // slot's key byte
+    uint8_t   sc;        // node's chain skip
+};
+
+template<int KEY_BITS>
+struct olc_path_t {
+    // root, up to KEY_BITS / 8 - 1 bitmask levels
+    static constexpr unsigned MAX_STEPS = KEY_BITS / 8 + 1;
+
+    olc_step_t steps[MAX_STEPS];
+    unsigned   depth = 0;
+    uint64_t*  retired[MAX_STEPS + 1];
+    unsigned   n_retired = 0;
+
+    olc_step_t& push(uint64_t* node, uint8_t version) noexcept {
+        auto* h = get_header(node);
+        olc_step_t& st = steps[depth++];
+        st = {&h->reserved_v, nullptr, 0, node, 0, h->entries(), version, 0, h->skip()};
+        return st;
+    }
+
+    static void descend(olc_step_t& st, uint64_t* children, int index, uint8_t byte) noexcept {
+        st.slot  = children + index;
+        st.child = olc_load(*st.slot);
+        st.index = index;
+        st.byte  = byte;
+    }
+
+    // Lock steps [from, depth) at the versions read; false (nothing
+    // held) if any moved on or its slot no longer holds the child seen
+    bool lock_from(unsigned from) noexcept {
+        for (unsigned i = from; i < depth; ++i) {
+            if (!olc_word::upgrade(*steps[i].lock, steps[i].version)) {
+                for (unsigned j = from; j < i; ++j) olc_word::unlock(*steps[j].lock);
+                return false;
+            }
+        }
+        for (unsigned i = from; i < depth; ++i) {
+            if (steps[i].slot && olc_load(*steps[i].slot) != steps[i].child) {
+                unlock_from(from, depth);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Unlock steps [from, depth); those from dead on are marked obsolete
+    void unlock_from(unsigned from, unsigned dead) noexcept {
+        for (unsigned i = from; i < depth; ++i)
+            olc_word::unlock(*steps[i].lock, i >= dead);
+    }
+
+    void retire(const uint64_t* node) noexcept {
+        retired[n_retired++] = const_cast<uint64_t*>(node);
+    }
+};
+
+// ==========================================================================
+// olc_arena_alloc — the allocator behind one arena's builder.
+//
+// Every block taken from ALLOC (a mega, or a node too large for the
+// slab) is preceded by a word holding the arena's index, so a large node
+// names the arena that allocated it. Slab blocks are traced to their
+// arena through its megas instead (kntrie_olc::owner_of).
+// ==========================================================================
+
+template<typename ALLOC>
+struct olc_arena_alloc {
+    using value_type = uint64_t;
+    template<typename U> struct rebind {
+        using other = typename std::allocator_traits<ALLOC>::template rebind_alloc<U>;
+    };
+
+    ALLOC    alloc_v;
+    unsigned arena_v = 0;
+
+    olc_arena_alloc() = default;
+    explicit olc_arena_alloc(unsigned arena) : arena_v(arena) {}
+
+    uint64_t* allocate(size_t n) {
+        uint64_t* p = alloc_v.allocate(n + 1);
+        p[0] = arena_v;
+        return p + 1;
+    }
+    void deallocate(uint64_t* p, size_t n) noexcept { alloc_v.deallocate(p - 1, n + 1); }
+
+    static unsigned owner(const uint64_t* p) noexcept { return static_cast<unsigned>(p[-1]); }
+
+    // Any arena's allocator can release any block
+    bool operator==(const olc_arena_alloc&) const noexcept { return true; }
+};
+
+// ==========================================================================
+// kntrie_olc_ops<VALUE, ALLOC, KEY_BITS> — optimistic lock coupling.
+//
+// Published nodes are immutable except for their child slots, which a
+// writer swings atomically while holding the slot's node. Readers take
+// no locks and validate nothing: every slot they load holds a complete
+// node, and nodes unlinked under them stay allocated until the epoch
+// moves past them.
+//
+// A writer changing one leaf locks only the bitmask above it, builds a
+// private copy with the ordinary insert_node / erase_node, and swings
+// the parent slot. Adding or removing a bitmask child copies that node
+// too, which locks the grandparent as well. Writers under different
+// parents never touch the same lock word.
+//
+// The returned status is RESTART when a lock or slot moved on; the
+// caller retries from the root. Unlinked blocks land in path.retired.
+// ==========================================================================
+
+template<typename VALUE, typename ALLOC, int KEY_BITS>
+struct kntrie_olc_ops {
+    using BO       = bitmask_ops<VALUE, ALLOC>;
+    using VT       = value_traits<VALUE, ALLOC>;
+    using VST      = typename VT::slot_type;
+    using BLD      = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
+    using OPS      = kntrie_ops<VALUE, ALLOC, KEY_BITS>;
+    using ITER_OPS = kntrie_iter_ops<VALUE, ALLOC, KEY_BITS>;
+    using path_t   = olc_path_t<KEY_BITS>;
+
+    // Values are copied between leaf versions bitwise; a value behind a
+    // pointer would be freed while readers still hold it
+    static_assert(VT::IS_TRIVIAL, "kntrie_olc needs values stored inline");
+
+    enum class status_t : uint8_t { RESTART, INSERTED, FOUND, ERASED, NOT_FOUND };
+
+    // Every write copies its leaf, so leaves split well before COMPACT_MAX
+    static constexpr size_t LEAF_MAX = 256;
+
+    // ==================================================================
+    // find — find_node with acquire loads of the child slots
+    // ==================================================================
+
+    template<int BITS> requires (BITS > 8)
+    static const VALUE* find(uint64_t ptr, uint64_t ik) noexcept {
+        if (ptr & LEAF_BIT) [[unlikely]] {
+            const uint64_t* node = untag_leaf(ptr);
+            return BO::leaf_fn(node)->find(node, ik);
+        }
+
+        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
+        uint8_t ti = OPS::template extract_byte<BITS>(ik);
+        int slot = reinterpret_cast<const bitmap_256_t*>(bm)->
+                       find_slot<slot_mode::BRANCHLESS>(ti);
+        return find<BITS - 8>(olc_load(bm[BITMAP_256_U64 + slot]), ik);
+    }
+
+    template<int BITS> requires (BITS == 8)
+    static const VALUE* find(uint64_t ptr, uint64_t ik) noexcept {
+        const uint64_t* node = untag_leaf(ptr);
+        return BO::bitmap_find(node, *get_header(node),
+                                OPS::template extract_byte<8>(ik), LEAF_HEADER_U64);
+    }
+
+    // ==================================================================
+    // Insert
+    // ==================================================================
+
+    template<int BITS, bool ASSIGN> requires (BITS >= 8)
+    static status_t insert(path_t& p, uint64_t ptr, uint64_t ik, VST sv, BLD& bld) {
+        if (ptr & LEAF_BIT) return insert_leaf<BITS, ASSIGN>(p, ptr, ik, sv, bld);
+
+        uint64_t* node = bm_to_node(ptr);
+        uint8_t v = olc_word::read(get_header(node)->reserved_v);
+        if (v & olc_word::OBSOLETE) return status_t::RESTART;
+        olc_step_t& st = p.push(node, v);
+        uint8_t sc = st.sc;
+
+        if (!OPS::template chain_matches<BITS>(node, sc, ik))
+            return insert_bitmask<BITS, ASSIGN>(p, node, ik, sv, bld);
+
+        status_t r = status_t::RESTART;
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            uint8_t ti = OPS::template extract_byte<FB>(ik);
+            int slot = BO::chain_bitmap(node, sc).template find_slot<slot_mode::FAST_EXIT>(ti);
+            if (slot < 0) {
+                r = insert_bitmask<BITS, ASSIGN>(p, node, ik, sv, bld);
+                return;
+            }
+            path_t::descend(st, BO::chain_children_mut(node, sc), slot, ti);
+            r = insert<FB - 8, ASSIGN>(p, st.child, ik, sv, bld);
+        });
+        return r;
+    }
+
+    // Leaf (or sentinel) in the last step's slot: copy, insert, swing
+    template<int BITS, bool ASSIGN>
+    static status_t insert_leaf(path_t& p, uint64_t ptr, uint64_t ik, VST sv, BLD& bld) {
+        const uint64_t* leaf = nullptr;
+        if (ptr != BO::SENTINEL_TAGGED) {
+            leaf = untag_leaf(ptr);
+            if constexpr (!ASSIGN)
+                if (BO::leaf_fn(leaf)->find(leaf, ik)) return status_t::FOUND;
+        }
+
+        unsigned top = p.depth - 1;
+        if (!p.lock_from(top)) return status_t::RESTART;
+
+        uint64_t work = ptr;
+        insert_result_t r;
+        try {
+            if (leaf) work = copy_leaf<BITS>(leaf, get_header(leaf)->skip(), bld);
+            r = OPS::template insert_node<BITS, true, ASSIGN>(work, ik, sv, bld);
+        } catch (...) {
+            if (work != ptr) ITER_OPS::template remove_subtree<BITS>(work, bld);
+            p.unlock_from(top, p.depth);
+            throw;
+        }
+
+        olc_publish(*p.steps[top].slot, r.tagged_ptr);
+        p.unlock_from(top, p.depth);
+        if (leaf) p.retire(leaf);
+        return r.inserted ? status_t::INSERTED : status_t::FOUND;
+    }
+
+    // The key needs a new child of the last step's node (its byte is
+    // absent or its chain diverges). insert_node on a copy of the node
+    // only adds a child or splits the chain, never entering a child.
+    template<int BITS, bool ASSIGN>
+    static status_t insert_bitmask(path_t& p, uint64_t* node, uint64_t ik,
+                                   VST sv, BLD& bld) {
+        unsigned top = p.depth - 2;
+        if (!p.lock_from(top)) return status_t::RESTART;
+
+        uint64_t* nn = nullptr;
+        insert_result_t r;
+        try {
+            nn = copy_node(node, bld);
+            r = OPS::template insert_node<BITS, true, ASSIGN>(tag_bitmask(nn), ik, sv, bld);
+        } catch (...) {
+            if (nn) bld.dealloc_node(nn, get_header(nn)->alloc_u64());
+            p.unlock_from(top, p.depth);
+            throw;
+        }
+
+        olc_publish(*p.steps[top].slot, r.tagged_ptr);
+        p.unlock_from(top, top + 1);
+        p.retire(node);
+        return status_t::INSERTED;
+    }
+
+    // ==================================================================
+    // Erase — no coalescing: bitmasks only shrink, and vanish when
+    // their last child does. Descendant counts are not kept.
+    // ==================================================================
+
+    template<int BITS> requires (BITS >= 8)
+    static status_t erase(path_t& p, uint64_t ptr, uint64_t ik, BLD& bld) {
+        if (ptr & LEAF_BIT) return erase_leaf<BITS>(p, ptr, ik, bld);
+
+        uint64_t* node = bm_to_node(ptr);
+        uint8_t v = olc_word::read(get_header(node)->reserved_v);
+        if (v & olc_word::OBSOLETE) return status_t::RESTART;
+        olc_step_t& st = p.push(node, v);
+        uint8_t sc = st.sc;
+
+        if (!OPS::template chain_matches<BITS>(node, sc, ik)) return status_t::NOT_FOUND;
+
+        status_t r = status_t::NOT_FOUND;
+        OPS::template at_final<BITS>(sc, [&]<int FB>() {
+            uint8_t ti = OPS::template extract_byte<FB>(ik);
+            int slot = BO::chain_bitmap(node, sc).template find_slot<slot_mode::FAST_EXIT>(ti);
+            if (slot < 0) return;
+            path_t::descend(st, BO::chain_children_mut(node, sc), slot, ti);
+            r = erase<FB - 8>(p, st.child, ik, bld);
+        });
+        return r;
+    }
+
+    template<int BITS>
+    static status_t erase_leaf(path_t& p, uint64_t ptr, uint64_t ik, BLD& bld) {
+        if (ptr == BO::SENTINEL_TAGGED) return status_t::NOT_FOUND;
+        const uint64_t* leaf = untag_leaf(ptr);
+        if (!BO::leaf_fn(leaf)->find(leaf, ik)) return status_t::NOT_FOUND;
+
+        if (get_header(leaf)->entries() > 1) {
+            unsigned top = p.depth - 1;
+            if (!p.lock_from(top)) return status_t::RESTART;
+
+            uint64_t work = 0;
+            erase_result_t r;
+            try {
+                work = tag_leaf(ITER_OPS::template clone_leaf_skip<BITS>(
+                    leaf, get_header(leaf)->skip(), bld));
+                r = OPS::template erase_node<BITS>(work, ik, bld);
+            } catch (...) {
+                if (work) ITER_OPS::template remove_subtree<BITS>(work, bld);
+                p.unlock_from(top, p.depth);
+                throw;
+            }
+
+            olc_publish(*p.steps[top].slot, r.tagged_ptr);
+            p.unlock_from(top, p.depth);
+            p.retire(leaf);
+            return status_t::ERASED;
+        }
+
+        // Last key: the leaf goes, with every single-child bitmask above
+        // it up to the anchor, the deepest node keeping other children.
+        unsigned k = p.depth - 1;
+        while (k > 0 && p.steps[k].entries == 1) --k;
+        unsigned top = k > 0 ? k - 1 : 0;
+        if (!p.lock_from(top)) return status_t::RESTART;
+
+        uint64_t repl = BO::SENTINEL_TAGGED;
+        if (k > 0) {
+            const olc_step_t& a = p.steps[k];
+            try {
+                uint64_t* nn = copy_node(a.node, bld);
+                nn = BO::chain_remove_child(nn, get_header(nn), a.sc, a.index, a.byte, bld);
+                repl = tag_bitmask(nn);
+            } catch (...) {
+                p.unlock_from(top, p.depth);
+                throw;
+            }
+        }
+
+        unsigned dead = k > 0 ? k : 1;
+        olc_publish(*p.steps[top].slot, repl);
+        p.unlock_from(top, dead);
+        for (unsigned i = dead; i < p.depth; ++i) p.retire(p.steps[i].node);
+        p.retire(leaf);
+        return status_t::ERASED;
+    }
+
+private:
+    // Private copy of the leaf at BITS (skip included); a full one comes
+    // back split into leaves of at most LEAF_MAX
+    template<int BITS>
+    static uint64_t copy_leaf(const uint64_t* leaf, uint8_t skip, BLD& bld) {
+        if (skip == 0) {
+            if (get_header(leaf)->entries() >= LEAF_MAX)
+                return OPS::template split_leaf_tagged<BITS>(leaf, LEAF_MAX, bld);
+            return tag_leaf(ITER_OPS::template clone_leaf_skip<BITS>(leaf, 0, bld));
+        }
+        if constexpr (BITS > 8)
+            return copy_leaf<BITS - 8>(leaf, skip - 1, bld);
+        __builtin_unreachable();
+    }
+
+    // Shallow private copy of a bitmask; children stay shared. Other
+    // writers may CAS the lock word while it is copied, so that byte is
+    // skipped rather than read plainly and the copy starts unlocked.
+    static uint64_t* copy_node(const uint64_t* node, BLD& bld) {
+        constexpr size_t LOCK = offsetof(node_header_t, reserved_v);
+        size_t au64 = get_header(node)->alloc_u64();
+        uint64_t* nn = bld.alloc_node(au64, false);  // au64 is already rounded
+        size_t bytes = au64 * 8;
+        const auto* src = reinterpret_cast<const uint8_t*>(node);
+        auto* dst = reinterpret_cast<uint8_t*>(nn);
+        std::memcpy(dst, src, LOCK);
+        dst[LOCK] = 0;
+        std::memcpy(dst + LOCK + 1, src + LOCK + 1, bytes - LOCK - 1);
+        BO::fix_embeds(nn, get_header(nn)->skip());
+        return nn;
+    }
+};
+
+// ==========================================================================
+// kntrie_olc — many writers and lock-free readers on one trie.
+//
+// Writers to different leaves run in parallel: each locks the bitmask
+// above the leaf it replaces (two levels when a bitmask gains or loses
+// a child) and nothing else. Lookups take no lock at all.
+//
+// Allocation goes through ARENAS builders, each behind its own mutex; a
+// writer takes whichever is free. Unlinked blocks wait in the arena's
+// retired list until no operation that might hold them is in flight,
+// then go back to the arena that allocated them: directly if that is
+// the reclaiming arena, else through the owner's remote list, which
+// the owner drains on its next write.
+//
+// Values must be stored inline (trivially copyable, at most 64 bytes)
+// and are read by copy. No root prefix is kept and bitmasks are not
+// coalesced on erase, so the trie can grow a little deeper than the
+// single-threaded kntrie holding the same keys.
+// ==========================================================================
+
+template<typename KEY, typename VALUE, typename ALLOC = std::allocator<uint64_t>>
+class kntrie_olc {
+    using AALLOC = olc_arena_alloc<ALLOC>;
+    using KO     = key_ops<KEY>;
+    using VT     = value_traits<VALUE, AALLOC>;
+    using BO     = bitmask_ops<VALUE, AALLOC>;
+    using BLD    = builder<VALUE, VT::IS_TRIVIAL, AALLOC>;
+
+    static constexpr int KEY_BITS = KO::KEY_BITS;
+
+    using OLC      = kntrie_olc_ops<VALUE, AALLOC, KEY_BITS>;
+    using ITER_OPS = kntrie_iter_ops<VALUE, AALLOC, KEY_BITS>;
+    using path_t   = typename OLC::path_t;
+    using status_t = typename OLC::status_t;
+
+    static constexpr unsigned ARENAS        = 16;
+    static constexpr size_t   RECLAIM_BATCH = 64;
+
+    struct alignas(64) arena_t {
+        std::mutex mutex_v;
+        BLD        bld_v;
+        std::vector<std::pair<uint64_t*, uint64_t>> retired_v;  // block, epoch tag
+        uint64_t*  megas_seen_v = nullptr;  // newest mega in megas_by_addr_v
+        std::atomic<uint64_t*> remote_v{nullptr};  // freed elsewhere, linked via [1]
+        std::atomic<std::ptrdiff_t> size_v{0};
+    };
+
+public:
+    using key_type    = KEY;
+    using mapped_type = VALUE;
+    using size_type   = std::size_t;
+
+    kntrie_olc() {
+        for (unsigned i = 0; i < ARENAS; ++i) arenas_v[i].bld_v = BLD(AALLOC(i));
+    }
+    kntrie_olc(const kntrie_olc&) = delete;
+    kntrie_olc& operator=(const kntrie_olc&) = delete;
+
+    // Everything dies with the arenas, so blocks go to a builder of their
+    // own: it returns large nodes to the allocator and keeps slab blocks
+    // out of every arena's freelists until the megas are released
+    ~kntrie_olc() {
+        BLD bld;
+        ITER_OPS::template remove_subtree<KEY_BITS>(root_v, bld);
+        for (auto& a : arenas_v) {
+            for (auto& [node, tag] : a.retired_v) dealloc_block(node, bld);
+            drain_remote(a, bld);
+        }
+    }
+
+    // ==================================================================
+    // Size — per-arena counts, summed without a lock
+    // ==================================================================
+
+    [[nodiscard]] size_type size() const noexcept {
+        std::ptrdiff_t n = 0;
+        for (const auto& a : arenas_v) n += a.size_v.load(std::memory_order_relaxed);
+        return static_cast<size_type>(n);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    // Each arena counts the blocks it allocated until they come back to
+    // it, retired and remote ones included
+    size_t memory_usage() const {
+        size_t n = sizeof(*this);
+        for (auto& a : arenas_v) {
+            std::lock_guard<std::mutex> lock(a.mutex_v);
+            n += a.bld_v.live_bytes();
+        }
+        return n;
+    }
+
+    // ==================================================================
+    // Modifiers
+    // ==================================================================
+
+    std::pair<bool, bool> insert(const KEY& key, const VALUE& value) {
+        bool inserted = insert_impl<false>(key, value);
+        return {true, inserted};
+    }
+
+    std::pair<bool, bool> insert_or_assign(const KEY& key, const VALUE& value) {
+        bool inserted = insert_impl<true>(key, value);
+        return {true, inserted};
+    }
+
+    size_type erase(const KEY& key) {
+        uint64_t ik = key_to_u64(key);
+        return write([&](BLD& bld, path_t& p) {
+            return OLC::template erase<KEY_BITS>(p, p.steps[0].child, ik, bld);
+        }) == status_t::ERASED ? 1 : 0;
+    }
+
+    // ==================================================================
+    // Lookup — lock-free; values are copied or visited inside the epoch
+    // ==================================================================
+
+    bool contains(const KEY& key) const noexcept {
+        return read(key, [](const VALUE* v) { return v != nullptr; });
+    }
+    size_type count(const KEY& key) const noexcept { return contains(key) ? 1 : 0; }
+
+    std::optional<VALUE> get(const KEY& key) const {
+        return read(key, [](const VALUE* v) -> std::optional<VALUE> {
+            if (!v) return std::nullopt;
+            return *v;
+        });
+    }
+
+    // fn(const VALUE&) if key is present; returns whether it was
+    template<typename F>
+    bool visit(const KEY& key, F&& fn) const {
+        return read(key, [&](const VALUE* v) {
+            if (v) fn(*v);
+            return v != nullptr;
+        });
+    }
+
+private:
+    static uint64_t key_to_u64(const KEY& key) noexcept {
+        return static_cast<uint64_t>(KO::to_internal(key)) << (64 - KO::IK_BITS);
+    }
+
+    template<typename F>
+    decltype(auto) read(const KEY& key, F&& fn) const {
+        uint64_t ik = key_to_u64(key);
+        size_t slot = domain_v.enter();
+        struct leave_t {
+            epoch_domain_t& d; size_t s;
+            ~leave_t() { d.leave(s); }
+        } leave{domain_v, slot};
+        return fn(OLC::template find<KEY_BITS>(olc_load(root_v), ik));
+    }
+
+    template<bool ASSIGN>
+    bool insert_impl(const KEY& key, const VALUE& value) {
+        uint64_t ik = key_to_u64(key);
+        return write([&](BLD& bld, path_t& p) {
+            return OLC::template insert<KEY_BITS, ASSIGN>(p, p.steps[0].child, ik, value, bld);
+        }) == status_t::INSERTED;
+    }
+
+    // Run op from the root until it stops restarting, inside the epoch
+    // and holding an arena; then retire what it unlinked
+    template<typename F>
+    status_t write(F&& op) {
+        arena_t& a = acquire_arena();
+        std::lock_guard<std::mutex> lock(a.mutex_v, std::adopt_lock);
+        drain_remote(a, a.bld_v);
+
+        status_t r;
+        path_t p;
+        size_t slot = domain_v.enter();
+        try {
+            do {
+                p.depth = 0;
+                olc_step_t& root = p.steps[p.depth++];
+                root = {&root_lock_v, &root_v, 0, nullptr, 0, 2,
+                        olc_word::read(root_lock_v), 0, 0};
+                root.child = olc_load(root_v);
+                r = op(a.bld_v, p);
+            } while (r == status_t::RESTART);
+            // Before leaving: nothing published here can be reclaimed
+            // by another arena until then
+            add_megas(a);
+        } catch (...) {
+            domain_v.leave(slot);
+            throw;
+        }
+        domain_v.leave(slot);
+
+        if (r == status_t::INSERTED) a.size_v.fetch_add(1, std::memory_order_relaxed);
+        if (r == status_t::ERASED)   a.size_v.fetch_sub(1, std::memory_order_relaxed);
+
+        // Readers that could hold these entered no later than now
+        uint64_t tag = domain_v.epoch_v.load(std::memory_order_seq_cst) + 1;
+        for (unsigned i = 0; i < p.n_retired; ++i)
+            a.retired_v.emplace_back(p.retired[i], tag);
+        if (a.retired_v.size() >= RECLAIM_BATCH) reclaim(a);
+        return r;
+    }
+
+    arena_t& acquire_arena() {
+        static std::atomic<unsigned> next{0};
+        thread_local unsigned home = next.fetch_add(1, std::memory_order_relaxed) % ARENAS;
+        for (unsigned i = 0; i < ARENAS; ++i) {
+            arena_t& a = arenas_v[(home + i) % ARENAS];
+            if (a.mutex_v.try_lock()) return a;
+        }
+        arenas_v[home].mutex_v.lock();
+        return arenas_v[home];
+    }
+
+    // Free every retired block no operation can still reach, each into
+    // the arena that allocated it
+    void reclaim(arena_t& a) noexcept {
+        if (a.retired_v.front().second > domain_v.epoch_v.load(std::memory_order_relaxed))
+            domain_v.advance();
+        uint64_t safe = domain_v.min_active();
+        std::shared_lock<std::shared_mutex> megas_lock(megas_mutex_v);
+        size_t keep = 0;
+        for (auto& e : a.retired_v) {
+            if (e.second > safe) { a.retired_v[keep++] = e; continue; }
+            arena_t& owner = arenas_v[owner_of(e.first)];
+            if (&owner == &a) dealloc_block(e.first, a.bld_v);
+            else push_remote(owner, e.first);
+        }
+        a.retired_v.resize(keep);
+    }
+
+    // Record megas a's builder took since the last call. Runs after the
+    // write is published, so running out of memory here is fatal.
+    void add_megas(arena_t& a) noexcept {
+        uint64_t* head = a.bld_v.megas_v;
+        if (head == a.megas_seen_v) return;
+        unsigned idx = static_cast<unsigned>(&a - arenas_v.data());
+        std::unique_lock<std::shared_mutex> megas_lock(megas_mutex_v);
+        for (uint64_t* m = head; m != a.megas_seen_v; m = reinterpret_cast<uint64_t*>(m[0]))
+            megas_by_addr_v.emplace(m, std::pair<const uint64_t*, unsigned>(m + m[1], idx));
+        a.megas_seen_v = head;
+    }
+
+    // Slab blocks lie in a mega; larger ones carry their arena's index.
+    // Caller holds megas_mutex_v.
+    unsigned owner_of(const uint64_t* node) const noexcept {
+        if (get_header(node)->alloc_u64() > FREE_MAX) return AALLOC::owner(node);
+        auto it = std::prev(megas_by_addr_v.upper_bound(node));
+        return it->second.second;
+    }
+
+    // Treiber push; the block is unreachable, so its word [1] is free
+    static void push_remote(arena_t& owner, uint64_t* node) noexcept {
+        uint64_t* head = owner.remote_v.load(std::memory_order_relaxed);
+        do {
+            node[1] = reinterpret_cast<uint64_t>(head);
+        } while (!owner.remote_v.compare_exchange_weak(head, node,
+                     std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static void drain_remote(arena_t& a, BLD& bld) noexcept {
+        uint64_t* node = a.remote_v.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            uint64_t* next = reinterpret_cast<uint64_t*>(node[1]);
+            dealloc_block(node, bld);
+            node = next;
+        }
+    }
+
+    static void dealloc_block(uint64_t* node, BLD& bld) noexcept {
+        bld.dealloc_node(node, get_header(node)->alloc_u64());
+    }
+
+    uint64_t root_v       = BO::SENTINEL_TAGGED;
+    uint8_t  root_lock_v  = 0;
+    mutable epoch_domain_t domain_v;
+    mutable std::array<arena_t, ARENAS> arenas_v;
+    std::shared_mutex megas_mutex_v;
+    std::map<const uint64_t*, std::pair<const uint64_t*, unsigned>> megas_by_addr_v;  // begin -> end, arena
+};
+
+} // namespace gteitelbaum
+
+#endif // KNTRIE_OLC_HPP
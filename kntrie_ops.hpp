@@ -10,7 +10,7 @@
 namespace gteitelbaum {
 
 // ======================================================================
-// kntrie_ops<VALUE, ALLOC, KEY_BITS> — stateless trie operations.
+// kntrie_ops<VALUE, ALLOC, KEY_BITS, AGG> — stateless trie operations.
 //
 // All functions take uint64_t ik — root-level, left-aligned in u64.
 // ik is NEVER shifted during descent. Each level extracts its byte via
@@ -19,17 +19,19 @@ namespace gteitelbaum {
 // KEY_BITS: total key bits (16/32/64). Lets leaf_ops_t compute depth.
 // BITS: compile-time remaining key bits at this tree level.
 // NK narrowing eliminated — NK only at leaf storage boundary.
+// AGG: subtree aggregate kept per bitmask child (no_aggregate_t: none).
 // ======================================================================
 
-template<typename VALUE, typename ALLOC, int KEY_BITS>
+template<typename VALUE, typename ALLOC, int KEY_BITS, typename AGG = no_aggregate_t>
 struct kntrie_ops {
-    using BO  = bitmask_ops<VALUE, ALLOC>;
+    using BO  = bitmask_ops<VALUE, ALLOC, AGG>;
     using VT  = value_traits<VALUE, ALLOC>;
     using VST = typename VT::slot_type;
     using BLD = builder<VALUE, VT::IS_TRIVIAL, ALLOC>;
 
     using leaf_fn_t     = typename BO::leaf_fn_t;
     using leaf_result_t = typename BO::leaf_result_t;
+    using agg_t         = typename AGG::type;
 
     // ==================================================================
     // byte_shift<BITS>: right-shift to extract current byte from root ik.
@@ -115,6 +117,29 @@ struct kntrie_ops {
             }
         }
 
+        // --- leaf_slot_at<SKIP>: find for writing (never bool) ---
+        template<int SKIP>
+        static VALUE* leaf_slot_at(uint64_t* node, uint64_t ik) noexcept {
+            if constexpr (VT::IS_BOOL) {
+                return nullptr;
+            } else {
+                if constexpr (SKIP > 0) {
+                    constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
+                    if ((ik_to_pfx_space(ik) ^ leaf_prefix(node)) & MASK)
+                        [[unlikely]] return nullptr;
+                }
+                constexpr int REMAINING = BITS - 8 * SKIP;
+                auto suf = to_suffix<REMAINING>(ik);
+                if constexpr (REMAINING <= 8)
+                    return const_cast<VALUE*>(BO::bitmap_find(
+                        node, *get_header(node), suf, LEAF_HEADER_U64));
+                else {
+                    using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                    return RCO::value_slot(node, *get_header(node), suf);
+                }
+            }
+        }
+
         // --- leaf_first_at<SKIP> ---
         template<int SKIP>
         static leaf_result_t leaf_first_at(const uint64_t* node) noexcept {
@@ -122,12 +147,12 @@ struct kntrie_ops {
             if constexpr (REMAINING <= 8) {
                 auto r = BO::bitmap_iter_first(node, LEAF_HEADER_U64);
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.suffix};
             } else {
                 using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
                 auto r = RCO::iter_first(node, get_header(node));
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.pos};
             }
         }
 
@@ -139,12 +164,12 @@ struct kntrie_ops {
                 auto r = BO::bitmap_iter_last(node, *get_header(node),
                                                LEAF_HEADER_U64);
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.suffix};
             } else {
                 using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
                 auto r = RCO::iter_last(node, get_header(node));
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.pos};
             }
         }
 
@@ -171,13 +196,13 @@ struct kntrie_ops {
                 auto r = BO::bitmap_iter_next(node, suf, LEAF_HEADER_U64);
                 if (!r.found) [[unlikely]] return {0, nullptr, false};
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.suffix};
             } else {
                 using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
                 auto r = RCO::iter_next(node, get_header(node), suf);
                 if (!r.found) [[unlikely]] return {0, nullptr, false};
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.pos};
             }
         }
 
@@ -204,13 +229,141 @@ struct kntrie_ops {
                 auto r = BO::bitmap_iter_prev(node, suf, LEAF_HEADER_U64);
                 if (!r.found) [[unlikely]] return {0, nullptr, false};
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.suffix};
             } else {
                 using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
                 auto r = RCO::iter_prev(node, get_header(node), suf);
                 if (!r.found) [[unlikely]] return {0, nullptr, false};
                 return {make_root_key<REMAINING>(node, r.suffix),
-                        r.value, true};
+                        r.value, true, r.pos};
+            }
+        }
+
+        // --- leaf_step_next_at<SKIP> / leaf_step_prev_at<SKIP> ---
+        // Positional: pos comes from a prior leaf_result_t on this node.
+        template<int SKIP>
+        static leaf_result_t leaf_step_next_at(const uint64_t* node,
+                                                uint16_t pos) noexcept {
+            constexpr int REMAINING = BITS - 8 * SKIP;
+            if constexpr (REMAINING <= 8) {
+                auto r = BO::bitmap_iter_next(node, static_cast<uint8_t>(pos),
+                                               LEAF_HEADER_U64);
+                if (!r.found) [[unlikely]] return {0, nullptr, false};
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.suffix};
+            } else {
+                using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                auto r = RCO::iter_step_next(node, get_header(node), pos);
+                if (!r.found) [[unlikely]] return {0, nullptr, false};
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.pos};
+            }
+        }
+
+        template<int SKIP>
+        static leaf_result_t leaf_step_prev_at(const uint64_t* node,
+                                                uint16_t pos) noexcept {
+            constexpr int REMAINING = BITS - 8 * SKIP;
+            if constexpr (REMAINING <= 8) {
+                auto r = BO::bitmap_iter_prev(node, static_cast<uint8_t>(pos),
+                                               LEAF_HEADER_U64);
+                if (!r.found) [[unlikely]] return {0, nullptr, false};
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.suffix};
+            } else {
+                using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                auto r = RCO::iter_step_prev(node, get_header(node), pos);
+                if (!r.found) [[unlikely]] return {0, nullptr, false};
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.pos};
+            }
+        }
+
+        // --- leaf_rank_at<SKIP>: entries with key < ik ---
+        template<int SKIP>
+        static unsigned leaf_rank_at(const uint64_t* node, uint64_t ik) noexcept {
+            constexpr int REMAINING = BITS - 8 * SKIP;
+            if constexpr (SKIP > 0) {
+                constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
+                uint64_t sik = ik_to_pfx_space(ik) & MASK;
+                uint64_t pfx = leaf_prefix(node) & MASK;
+                if (sik != pfx) [[unlikely]]
+                    return sik < pfx ? 0 : get_header(node)->entries();
+            }
+            auto suf = to_suffix<REMAINING>(ik);
+            if constexpr (REMAINING <= 8)
+                return BO::bitmap_rank(node, suf, LEAF_HEADER_U64);
+            else {
+                using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                return RCO::iter_rank(node, get_header(node), suf);
+            }
+        }
+
+        // --- leaf_select_at<SKIP>: the i-th entry, i < entries ---
+        template<int SKIP>
+        static leaf_result_t leaf_select_at(const uint64_t* node,
+                                             unsigned i) noexcept {
+            constexpr int REMAINING = BITS - 8 * SKIP;
+            if constexpr (REMAINING <= 8) {
+                auto r = BO::bitmap_iter_at(node, i, LEAF_HEADER_U64);
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.suffix};
+            } else {
+                using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                auto r = RCO::iter_select(node, get_header(node), i);
+                return {make_root_key<REMAINING>(node, r.suffix),
+                        r.value, true, r.pos};
+            }
+        }
+
+        // --- leaf_sample_at<SKIP>: uniform entry from random word r ---
+        template<int SKIP>
+        static leaf_result_t leaf_sample_at(const uint64_t* node,
+                                             uint64_t r) noexcept {
+            constexpr int REMAINING = BITS - 8 * SKIP;
+            if constexpr (REMAINING <= 8) {
+                unsigned i = static_cast<unsigned>(
+                    scale_random(r, get_header(node)->entries()));
+                return leaf_select_at<SKIP>(node, i);
+            } else {
+                using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                auto r2 = RCO::iter_sample(node, get_header(node), r);
+                if (!r2.found) return {0, nullptr, false};
+                return {make_root_key<REMAINING>(node, r2.suffix),
+                        r2.value, true, r2.pos};
+            }
+        }
+
+        // --- leaf_aggregate_at<SKIP>: AGG fold of lo <= key < hi ---
+        // A bound outside the leaf's prefix clamps to that end.
+        template<int SKIP>
+        static agg_t leaf_aggregate_at(const uint64_t* node, uint64_t lo,
+                                       uint64_t hi, bool hi_open) noexcept {
+            if constexpr (!HAS_AGG<AGG>) {
+                return AGG::identity();
+            } else {
+                constexpr int REMAINING = BITS - 8 * SKIP;
+                auto slo = to_suffix<REMAINING>(lo);
+                auto shi = to_suffix<REMAINING>(hi);
+                if constexpr (SKIP > 0) {
+                    constexpr uint64_t MASK = ~uint64_t(0) << (64 - 8 * SKIP);
+                    uint64_t pfx = leaf_prefix(node) & MASK;
+                    uint64_t plo = ik_to_pfx_space(lo) & MASK;
+                    if (plo > pfx) return AGG::identity();
+                    if (plo < pfx) slo = 0;
+                    if (!hi_open) {
+                        uint64_t phi = ik_to_pfx_space(hi) & MASK;
+                        if (phi < pfx) return AGG::identity();
+                        hi_open = phi > pfx;
+                    }
+                }
+                if constexpr (REMAINING <= 8)
+                    return BO::bitmap_aggregate(node, slo, shi, hi_open, LEAF_HEADER_U64);
+                else {
+                    using RCO = compact_ops<nk_for_bits_t<REMAINING>, VALUE, ALLOC>;
+                    return RCO::template iter_aggregate<AGG>(node, get_header(node),
+                                                             slo, shi, hi_open);
+                }
             }
         }
 
@@ -221,10 +374,17 @@ struct kntrie_ops {
                 typename BO::leaf_fn_t{
                     static_cast<uint8_t>(Is),
                     &leaf_find_at<static_cast<int>(Is)>,
+                    &leaf_slot_at<static_cast<int>(Is)>,
                     &leaf_next_at<static_cast<int>(Is)>,
                     &leaf_prev_at<static_cast<int>(Is)>,
                     &leaf_first_at<static_cast<int>(Is)>,
                     &leaf_last_at<static_cast<int>(Is)>,
+                    &leaf_step_next_at<static_cast<int>(Is)>,
+                    &leaf_step_prev_at<static_cast<int>(Is)>,
+                    &leaf_rank_at<static_cast<int>(Is)>,
+                    &leaf_select_at<static_cast<int>(Is)>,
+                    &leaf_sample_at<static_cast<int>(Is)>,
+                    &leaf_aggregate_at<static_cast<int>(Is)>,
                 }...
             };
         }
@@ -233,6 +393,26 @@ struct kntrie_ops {
             std::make_index_sequence<MAX_LEAF_SKIP + 1>{});
     };
 
+    // fn.template operator()<BITS - 8 * sc>(): BITS of a node's final
+    // bitmap, whose children sit at FB - 8
+    template<int BITS, typename F>
+    static void at_final(uint8_t sc, F&& fn) {
+        if constexpr (BITS >= 16) {
+            if (sc == 0) fn.template operator()<BITS>();
+            else at_final<BITS - 8>(sc - 1, fn);
+        }
+    }
+
+    // Do the chain bytes of a bitmask node at BITS match ik?
+    template<int BITS>
+    static bool chain_matches(const uint64_t* node, uint8_t sc, uint64_t ik) noexcept {
+        for (uint8_t pos = 0; pos < sc; ++pos)
+            if (BO::skip_byte(node, pos) !=
+                static_cast<uint8_t>(ik >> (byte_shift<BITS>() - 8 * pos)))
+                return false;
+        return true;
+    }
+
     // ==================================================================
     // find_node — branchless bitmask descent, fn dispatch at leaf.
     // ik is root-level, NEVER shifted.
@@ -262,83 +442,73 @@ struct kntrie_ops {
                                 extract_byte<8>(ik), LEAF_HEADER_U64);
     }
 
+    // Leaf under tagged that ik descends to; shift is ik's byte shift
+    // at tagged's level. Runtime depth, like find_group: structural
+    // inserts report where they left the key with it.
+    static uint64_t* leaf_below(uint64_t tagged, uint64_t ik, int shift) noexcept {
+        while (!(tagged & LEAF_BIT)) {
+            const uint64_t* bm = reinterpret_cast<const uint64_t*>(tagged);
+            int slot = reinterpret_cast<const bitmap_256_t*>(bm)->
+                           find_slot<slot_mode::BRANCHLESS>(
+                               static_cast<uint8_t>(ik >> shift));
+            tagged = bm[BITMAP_256_U64 + slot];
+            shift -= 8;
+        }
+        return untag_leaf_mut(tagged);
+    }
+
     // ==================================================================
-    // find_leaf_next / find_leaf_prev — descent to leaf for iteration.
-    // ik is root-level. No sentinel checks.
+    // find_group — level-synchronous descent over independent lookups.
+    // Each round advances every live lookup one bitmask level and
+    // prefetches the chosen child; the child is only touched next round,
+    // so up to FIND_GROUP misses overlap. Bitmask levels (chain embeds
+    // included) are uniform, so depth is runtime.
+    // ptrs[i] starts at the subtree root (or SENTINEL_TAGGED on a root
+    // prefix miss); depth is the root skip.
     // ==================================================================
 
-    template<int BITS> requires (BITS > 8)
-    static const uint64_t* find_leaf_next(uint64_t ptr, uint64_t ik) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]]
-            return untag_leaf(ptr);
+    static constexpr unsigned FIND_GROUP = 16;
 
+    // One branchless bitmask level at runtime shift; misses yield
+    // SENTINEL_TAGGED, whose leaf fn finds nothing.
+    static uint64_t find_step(uint64_t ptr, uint64_t ik, int shift) noexcept {
         const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        const auto* bmp = reinterpret_cast<const bitmap_256_t*>(bm);
-        uint8_t ti = extract_byte<BITS>(ik);
-
-        int slot = bmp->find_slot<slot_mode::FAST_EXIT>(ti);
-        if (slot >= 0) [[likely]] {
-            const uint64_t* r = find_leaf_next<BITS - 8>(
-                bm[BITMAP_256_U64 + slot], ik);
-            if (r) [[likely]] return r;
-        }
-
-        auto adj = bmp->next_set_after(ti);
-        if (!adj.found) [[unlikely]] return nullptr;
-        return descend_min_leaf<BITS - 8>(bm[BITMAP_256_U64 + adj.slot]);
+        uint8_t ti = static_cast<uint8_t>(ik >> shift);
+        int slot = reinterpret_cast<const bitmap_256_t*>(bm)->
+                       find_slot<slot_mode::BRANCHLESS>(ti);
+        return bm[BITMAP_256_U64 + slot];
     }
 
-    template<int BITS> requires (BITS == 8)
-    static const uint64_t* find_leaf_next(uint64_t ptr, uint64_t) noexcept {
-        return untag_leaf(ptr);
+    // Address of a tagged child's first line, for prefetch
+    static const void* node_addr(uint64_t tagged) noexcept {
+        return reinterpret_cast<const void*>(tagged & ~LEAF_BIT);
     }
 
-    template<int BITS> requires (BITS > 8)
-    static const uint64_t* find_leaf_prev(uint64_t ptr, uint64_t ik) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]]
-            return untag_leaf(ptr);
-
-        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        const auto* bmp = reinterpret_cast<const bitmap_256_t*>(bm);
-        uint8_t ti = extract_byte<BITS>(ik);
-
-        int slot = bmp->find_slot<slot_mode::FAST_EXIT>(ti);
-        if (slot >= 0) [[likely]] {
-            const uint64_t* r = find_leaf_prev<BITS - 8>(
-                bm[BITMAP_256_U64 + slot], ik);
-            if (r) [[likely]] return r;
+    static void find_group(const uint64_t* iks, uint64_t* ptrs, unsigned n,
+                             int depth, const VALUE** out) noexcept {
+        uint8_t live[FIND_GROUP];
+        unsigned n_live = n;
+        for (unsigned i = 0; i < n; ++i) live[i] = static_cast<uint8_t>(i);
+
+        while (n_live) {
+            int shift = 56 - 8 * depth;
+            unsigned next_live = 0;
+            for (unsigned j = 0; j < n_live; ++j) {
+                unsigned i = live[j];
+                uint64_t ptr = ptrs[i];
+                if (ptr & LEAF_BIT) [[unlikely]] {
+                    const uint64_t* node = untag_leaf(ptr);
+                    out[i] = BO::leaf_fn(node)->find(node, iks[i]);
+                    continue;
+                }
+                uint64_t child = find_step(ptr, iks[i], shift);
+                __builtin_prefetch(node_addr(child));
+                ptrs[i] = child;
+                live[next_live++] = static_cast<uint8_t>(i);
+            }
+            n_live = next_live;
+            ++depth;
         }
-
-        auto adj = bmp->prev_set_before(ti);
-        if (!adj.found) [[unlikely]] return nullptr;
-        return descend_max_leaf<BITS - 8>(bm[BITMAP_256_U64 + adj.slot]);
-    }
-
-    template<int BITS> requires (BITS == 8)
-    static const uint64_t* find_leaf_prev(uint64_t ptr, uint64_t) noexcept {
-        return untag_leaf(ptr);
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static const uint64_t* descend_min_leaf(uint64_t ptr) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] return untag_leaf(ptr);
-        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        if constexpr (BITS > 8)
-            return descend_min_leaf<BITS - 8>(bm[BITMAP_256_U64 + 1]);
-        else
-            return untag_leaf(bm[BITMAP_256_U64 + 1]);
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static const uint64_t* descend_max_leaf(uint64_t ptr) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] return untag_leaf(ptr);
-        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        auto* hdr = get_header(bm_to_node_const(reinterpret_cast<uint64_t>(bm)));
-        int last = hdr->entries() - 1;
-        if constexpr (BITS > 8)
-            return descend_max_leaf<BITS - 8>(bm[BITMAP_256_U64 + 1 + last]);
-        else
-            return untag_leaf(bm[BITMAP_256_U64 + 1 + last]);
     }
 
     // ==================================================================
@@ -409,15 +579,17 @@ struct kntrie_ops {
     }
 
     // Build node from sorted arrays. Returns tagged pointer.
+    // Leaves hold at most leaf_max entries.
     template<int BITS>
     static uint64_t build_node_from_arrays_tagged(nk_for_bits_t<BITS>* suf,
                                                      VST* vals,
-                                                     size_t count, BLD& bld) {
+                                                     size_t count, BLD& bld,
+                                                     size_t leaf_max = COMPACT_MAX) {
         using NK = nk_for_bits_t<BITS>;
         constexpr int NK_BITS = static_cast<int>(sizeof(NK) * 8);
 
         // Leaf case
-        if (count <= COMPACT_MAX)
+        if (count <= leaf_max)
             return tag_leaf(build_leaf<BITS>(suf, vals, count, bld));
 
         // Skip compression: all entries share same top byte?
@@ -438,7 +610,7 @@ struct kntrie_ops {
             }
 
             uint64_t child_tagged = build_node_from_arrays_tagged<BITS - 8>(
-                cs.get(), vals, count, bld);
+                cs.get(), vals, count, bld, leaf_max);
 
             uint8_t byte_arr[1] = {first_top};
             if (child_tagged & LEAF_BIT) {
@@ -472,7 +644,7 @@ struct kntrie_ops {
                     cs[j] = static_cast<CNK>(shifted >> (NK_BITS - CNK_BITS));
                 }
                 child_tagged[n_children] = build_node_from_arrays_tagged<BITS - 8>(
-                    cs.get(), vals + start, cc, bld);
+                    cs.get(), vals + start, cc, bld, leaf_max);
             }
             indices[n_children] = ti;
             n_children++;
@@ -482,6 +654,483 @@ struct kntrie_ops {
             BO::make_bitmask(indices, child_tagged, n_children, bld, count));
     }
 
+    // ==================================================================
+    // build_sorted — bulk build from ascending root-level iks.
+    //
+    // ik_at(i) / val_at(i) index the caller's range; only leaves copy
+    // entries (at most COMPACT_MAX at a time). Child ranges come from a
+    // binary search on the sorted iks and skip bytes from comparing the
+    // first/last key. Adjacent duplicates keep the first. entries
+    // accumulates the stored count.
+    //
+    // If anything throws, the nodes built so far are freed. FRESH means
+    // val_at stores new values, which go with them; otherwise the values
+    // belong to the caller and are left alone.
+    // ==================================================================
+
+    template<int BITS, bool FRESH = false, typename IK_AT, typename VAL_AT>
+        requires (BITS >= 8)
+    static uint64_t build_sorted(IK_AT& ik_at, VAL_AT& val_at,
+                                   size_t lo, size_t hi,
+                                   size_t& entries, BLD& bld) {
+        size_t count = hi - lo;
+        if (BITS == 8 || count <= COMPACT_MAX) {
+            using NK = nk_for_bits_t<BITS>;
+            auto wk = std::make_unique<NK[]>(count);
+            auto wv = std::make_unique<VST[]>(count);
+            size_t n = 0;
+            uint64_t prev = 0;
+            try {
+                for (size_t i = lo; i < hi; ++i) {
+                    uint64_t ik = ik_at(i);
+                    if (n > 0 && ik == prev) [[unlikely]] continue;
+                    prev = ik;
+                    wk[n] = leaf_ops_t<BITS>::template to_suffix<BITS>(ik);
+                    wv[n] = val_at(i);
+                    ++n;
+                }
+                uint64_t leaf = tag_leaf(build_leaf<BITS>(wk.get(), wv.get(), n, bld));
+                entries += n;
+                return leaf;
+            } catch (...) {
+                if constexpr (FRESH)
+                    for (size_t j = 0; j < n; ++j) bld.destroy_value(wv[j]);
+                throw;
+            }
+        }
+
+        if constexpr (BITS > 8) {
+            // Sorted: same top byte at both ends means all share it
+            uint8_t first_top = extract_byte<BITS>(ik_at(lo));
+            if (first_top == extract_byte<BITS>(ik_at(hi - 1))) [[unlikely]] {
+                uint64_t child = build_sorted<BITS - 8, FRESH>(
+                    ik_at, val_at, lo, hi, entries, bld);
+                if (child & LEAF_BIT)
+                    return tag_leaf(prepend_skip<BITS>(untag_leaf_mut(child), 1,
+                                        uint64_t(first_top) << 56, bld));
+                try {
+                    return BO::wrap_in_chain(bm_to_node(child), &first_top, 1, bld);
+                } catch (...) {
+                    drop_built<BITS - 8, FRESH>(child, bld);
+                    throw;
+                }
+            }
+
+            uint8_t indices[256];
+            uint64_t children[256];
+            unsigned n_children = 0;
+            size_t before = entries;
+            try {
+                size_t i = lo;
+                while (i < hi) {
+                    uint8_t ti = extract_byte<BITS>(ik_at(i));
+                    // End of the ti run
+                    size_t a = i + 1, b = hi;
+                    while (a < b) {
+                        size_t mid = a + (b - a) / 2;
+                        if (extract_byte<BITS>(ik_at(mid)) == ti) a = mid + 1;
+                        else b = mid;
+                    }
+                    children[n_children] = build_sorted<BITS - 8, FRESH>(
+                        ik_at, val_at, i, a, entries, bld);
+                    indices[n_children++] = ti;
+                    i = a;
+                }
+                return tag_bitmask(BO::make_bitmask(indices, children, n_children,
+                                                     bld, entries - before));
+            } catch (...) {
+                for (unsigned c = 0; c < n_children; ++c)
+                    drop_built<BITS - 8, FRESH>(children[c], bld);
+                throw;
+            }
+        }
+        __builtin_unreachable();
+    }
+
+    // Free a subtree build_sorted made, on unwind: with its values if
+    // they were FRESH, else nodes only
+    template<int BITS, bool FRESH> requires (BITS >= 8)
+    static void drop_built(uint64_t tagged, BLD& bld) noexcept {
+        if constexpr (!FRESH) {
+            dealloc_bitmask_subtree<BITS>(tagged, bld);
+        } else if (tagged & LEAF_BIT) {
+            uint64_t* node = untag_leaf_mut(tagged);
+            dealloc_leaf_skip<BITS>(node, get_header(node)->skip(), bld);
+        } else {
+            uint64_t* node = bm_to_node(tagged);
+            uint8_t sc = get_header(node)->skip();
+            at_final<BITS>(sc, [&]<int FB>() {
+                BO::chain_for_each_child(node, sc, [&](unsigned, uint64_t child) {
+                    drop_built<FB - 8, true>(child, bld);
+                });
+            });
+            BO::dealloc_bitmask(node, bld);
+        }
+    }
+
+    // ==================================================================
+    // insert_batch — merge ascending root-level iks [lo, hi) into the
+    // subtree at ptr (all share the bytes above BITS). Existing keys are
+    // kept; duplicates in the run keep the first. Each leaf reached is
+    // rebuilt once from its entries merged with its run, through
+    // build_sorted, so it splits at most once. Bitmask nodes add missing
+    // children and bump descendants once. inserted accumulates new keys.
+    // ==================================================================
+
+    template<int BITS, typename IK_AT, typename VAL_AT> requires (BITS >= 8)
+    static uint64_t insert_batch(uint64_t ptr, IK_AT& ik_at, VAL_AT& val_at,
+                                   size_t lo, size_t hi,
+                                   size_t& inserted, BLD& bld) {
+        if (ptr == BO::SENTINEL_TAGGED) [[unlikely]]
+            return build_sorted<BITS, true>(ik_at, val_at, lo, hi, inserted, bld);
+
+        if (ptr & LEAF_BIT)
+            return merge_leaf<BITS>(untag_leaf_mut(ptr), ik_at, val_at,
+                                    lo, hi, inserted, bld);
+
+        uint64_t* node = bm_to_node(ptr);
+        uint8_t sc = get_header(node)->skip();
+        if (sc > 0) [[unlikely]] {
+            // Keys that follow the chain are contiguous in a sorted run:
+            // [c_lo, c_hi). They go down the chain together; each part
+            // outside it splits the chain with its first key and recurses.
+            constexpr int DEPTH = (KEY_BITS - BITS) / 8;
+            uint64_t key_lo = 0;
+            if constexpr (DEPTH > 0)
+                key_lo = ik_at(lo) & (~uint64_t(0) << (64 - 8 * DEPTH));
+            for (uint8_t pos = 0; pos < sc; ++pos)
+                key_lo |= uint64_t(BO::skip_byte(node, pos))
+                          << (byte_shift<BITS>() - 8 * pos);
+            uint64_t key_hi = key_lo |
+                ((uint64_t(1) << (byte_shift<BITS>() - 8 * (sc - 1))) - 1);
+            size_t c_hi = first_above(ik_at, lo, hi, key_hi);
+            size_t c_lo = key_lo > 0 ? first_above(ik_at, lo, c_hi, key_lo - 1) : lo;
+            if (c_lo != lo || c_hi != hi) {
+                if (c_lo < c_hi)
+                    ptr = insert_batch_chain<BITS>(node, sc, 0, ik_at, val_at,
+                                                   c_lo, c_hi, inserted, bld);
+                if (lo < c_lo)
+                    ptr = insert_batch_split<BITS>(ptr, ik_at, val_at,
+                                                   lo, c_lo, inserted, bld);
+                if (c_hi < hi)
+                    ptr = insert_batch_split<BITS>(ptr, ik_at, val_at,
+                                                   c_hi, hi, inserted, bld);
+                return ptr;
+            }
+        }
+        return insert_batch_chain<BITS>(node, sc, 0, ik_at, val_at,
+                                        lo, hi, inserted, bld);
+    }
+
+    // Insert ik_at(lo) alone, which splits the chain it misses, then the
+    // rest of the run as a batch
+    template<int BITS, typename IK_AT, typename VAL_AT> requires (BITS >= 8)
+    static uint64_t insert_batch_split(uint64_t ptr, IK_AT& ik_at, VAL_AT& val_at,
+                                         size_t lo, size_t hi,
+                                         size_t& inserted, BLD& bld) {
+        VST sv = val_at(lo);
+        insert_result_t r;
+        try {
+            r = insert_node<BITS, true, false>(ptr, ik_at(lo), sv, bld);
+        } catch (...) {
+            bld.destroy_value(sv);
+            throw;
+        }
+        if (r.inserted) ++inserted;
+        else bld.destroy_value(sv);
+        if (lo + 1 == hi) return r.tagged_ptr;
+        return insert_batch<BITS>(r.tagged_ptr, ik_at, val_at,
+                                  lo + 1, hi, inserted, bld);
+    }
+
+    // Walk the chain's skip bytes to reach the final bitmask's BITS
+    template<int BITS, typename IK_AT, typename VAL_AT> requires (BITS >= 8)
+    static uint64_t insert_batch_chain(uint64_t* node, uint8_t sc, uint8_t pos,
+                                         IK_AT& ik_at, VAL_AT& val_at,
+                                         size_t lo, size_t hi,
+                                         size_t& inserted, BLD& bld) {
+        if (pos >= sc)
+            return insert_batch_final<BITS>(node, sc, ik_at, val_at,
+                                            lo, hi, inserted, bld);
+        if constexpr (BITS > 8)
+            return insert_batch_chain<BITS - 8>(node, sc, pos + 1, ik_at, val_at,
+                                                lo, hi, inserted, bld);
+        __builtin_unreachable();
+    }
+
+    template<int BITS, typename IK_AT, typename VAL_AT> requires (BITS >= 8)
+    static uint64_t insert_batch_final(uint64_t* node, uint8_t sc,
+                                         IK_AT& ik_at, VAL_AT& val_at,
+                                         size_t lo, size_t hi,
+                                         size_t& inserted, BLD& bld) {
+        if constexpr (BITS > 8) {
+            size_t before = inserted;
+            size_t i = lo;
+            while (i < hi) {
+                uint8_t ti = extract_byte<BITS>(ik_at(i));
+                size_t a = i + 1, b = hi;
+                while (a < b) {
+                    size_t mid = a + (b - a) / 2;
+                    if (extract_byte<BITS>(ik_at(mid)) == ti) a = mid + 1;
+                    else b = mid;
+                }
+
+                auto* hdr = get_header(node);
+                typename BO::child_lookup cl = sc > 0
+                    ? BO::chain_lookup(node, sc, ti) : BO::lookup(node, ti);
+                if (cl.found) {
+                    size_t was = inserted;
+                    uint64_t c = insert_batch<BITS - 8>(cl.child, ik_at, val_at,
+                                                        i, a, inserted, bld);
+                    if (c != cl.child) {
+                        if (sc > 0) BO::chain_set_child(node, sc, cl.slot, c);
+                        else        BO::set_child(node, cl.slot, c);
+                    }
+                    if constexpr (HAS_AGG<AGG>)
+                        if (inserted != was) BO::refresh_agg(node, sc, cl.slot);
+                } else {
+                    uint64_t c = build_sorted<BITS - 8, true>(ik_at, val_at, i, a,
+                                                              inserted, bld);
+                    node = sc > 0 ? BO::chain_add_child(node, hdr, sc, ti, c, bld)
+                                  : BO::add_child(node, hdr, ti, c, bld);
+                }
+                i = a;
+            }
+            auto* hdr = get_header(node);
+            BO::chain_descendants_mut(node, sc, hdr->entries()) += inserted - before;
+            return tag_bitmask(node);
+        }
+        __builtin_unreachable();
+    }
+
+    // Rebuild a leaf from its entries merged with the run
+    template<int BITS, typename IK_AT, typename VAL_AT> requires (BITS >= 8)
+    static uint64_t merge_leaf(uint64_t* node, IK_AT& ik_at, VAL_AT& val_at,
+                                 size_t lo, size_t hi,
+                                 size_t& inserted, BLD& bld) {
+        auto* hdr = get_header(node);
+        size_t old_n = hdr->entries();
+        size_t cap = old_n + (hi - lo);
+        auto mk = std::make_unique<uint64_t[]>(cap);
+        auto mv = std::make_unique<VST[]>(cap);
+
+        // Leaf keys hold the bytes from this depth down; the run supplies
+        // the bytes above.
+        constexpr int DEPTH = (KEY_BITS - BITS) / 8;
+        uint64_t above = 0;
+        if constexpr (DEPTH > 0)
+            above = ik_at(lo) & (~uint64_t(0) << (64 - 8 * DEPTH));
+
+        // Values from the run are new and freed if the rebuild throws;
+        // the leaf's own stay with it
+        std::unique_ptr<bool[]> fresh;
+        if constexpr (!VT::IS_TRIVIAL) fresh = std::make_unique<bool[]>(cap);
+
+        size_t n = 0, i = lo;
+        auto take_run = [&](size_t end_i) {
+            for (; i < end_i; ++i) {
+                uint64_t ik = ik_at(i);
+                if (n > 0 && mk[n - 1] == ik) [[unlikely]] continue;
+                mk[n] = ik;
+                mv[n] = val_at(i);
+                if constexpr (!VT::IS_TRIVIAL) fresh[n] = true;
+                ++n;
+            }
+        };
+
+        uint64_t res;
+        try {
+            const auto* fn = BO::leaf_fn(node);
+            for (auto r = fn->first(node); r.found; r = fn->step_next(node, r.pos)) {
+                uint64_t ek = above | r.key;
+                size_t j = i;
+                while (j < hi && ik_at(j) < ek) ++j;
+                take_run(j);
+                while (i < hi && ik_at(i) == ek) ++i;  // existing key wins
+                mk[n] = ek;
+                mv[n] = *r.value;
+                if constexpr (!VT::IS_TRIVIAL) fresh[n] = false;
+                ++n;
+            }
+            take_run(hi);
+
+            auto mk_at = [&](size_t j) { return mk[j]; };
+            auto mv_at = [&](size_t j) { return mv[j]; };
+            size_t entries = 0;
+            res = build_sorted<BITS>(mk_at, mv_at, 0, n, entries, bld);
+        } catch (...) {
+            if constexpr (!VT::IS_TRIVIAL)
+                for (size_t j = 0; j < n; ++j)
+                    if (fresh[j]) bld.destroy_value(mv[j]);
+            throw;
+        }
+        inserted += n - old_n;
+        bld.dealloc_node(node, hdr->alloc_u64());
+        return res;
+    }
+
+    // ==================================================================
+    // erase_batch — remove ascending root-level iks [lo, hi) from the
+    // subtree at ptr (all share the bytes above BITS). Each leaf is
+    // rebuilt once from its survivors at their final size; each bitmask
+    // settles (collapse / coalesce) once after all its children are done.
+    // Returns the new tagged ptr, 0 if the subtree emptied.
+    // ==================================================================
+
+    // First index in [lo, hi) whose ik is > key (ik_at ascending)
+    template<typename IK_AT>
+    static size_t first_above(IK_AT& ik_at, size_t lo, size_t hi, uint64_t key) {
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (ik_at(mid) <= key) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    template<int BITS, typename IK_AT> requires (BITS >= 8)
+    static uint64_t erase_batch(uint64_t ptr, IK_AT& ik_at,
+                                  size_t lo, size_t hi,
+                                  size_t& erased, BLD& bld) {
+        if (ptr == BO::SENTINEL_TAGGED) [[unlikely]] return ptr;
+
+        if (ptr & LEAF_BIT)
+            return erase_leaf_batch<BITS>(untag_leaf_mut(ptr), ik_at,
+                                          lo, hi, erased, bld);
+
+        uint64_t* node = bm_to_node(ptr);
+        uint8_t sc = get_header(node)->skip();
+        if (sc > 0) [[unlikely]] {
+            // Only keys that follow the chain can be present, and in a
+            // sorted run they are contiguous: [key_lo, key_hi].
+            constexpr int DEPTH = (KEY_BITS - BITS) / 8;
+            uint64_t key_lo = 0;
+            if constexpr (DEPTH > 0)
+                key_lo = ik_at(lo) & (~uint64_t(0) << (64 - 8 * DEPTH));
+            for (uint8_t pos = 0; pos < sc; ++pos)
+                key_lo |= uint64_t(BO::skip_byte(node, pos))
+                          << (byte_shift<BITS>() - 8 * pos);
+            uint64_t key_hi = key_lo |
+                ((uint64_t(1) << (byte_shift<BITS>() - 8 * (sc - 1))) - 1);
+            hi = first_above(ik_at, lo, hi, key_hi);
+            if (key_lo > 0) lo = first_above(ik_at, lo, hi, key_lo - 1);
+            if (lo == hi) return ptr;
+        }
+        return erase_batch_chain<BITS>(node, sc, 0, ik_at, lo, hi, erased, bld);
+    }
+
+    template<int BITS, typename IK_AT> requires (BITS >= 8)
+    static uint64_t erase_batch_chain(uint64_t* node, uint8_t sc, uint8_t pos,
+                                        IK_AT& ik_at, size_t lo, size_t hi,
+                                        size_t& erased, BLD& bld) {
+        if (pos >= sc)
+            return erase_batch_final<BITS>(node, sc, ik_at, lo, hi, erased, bld);
+        if constexpr (BITS > 8)
+            return erase_batch_chain<BITS - 8>(node, sc, pos + 1, ik_at,
+                                               lo, hi, erased, bld);
+        __builtin_unreachable();
+    }
+
+    template<int BITS, typename IK_AT> requires (BITS >= 8)
+    static uint64_t erase_batch_final(uint64_t* node, uint8_t sc,
+                                        IK_AT& ik_at, size_t lo, size_t hi,
+                                        size_t& erased, BLD& bld) {
+        if constexpr (BITS > 8) {
+            size_t before = erased;
+            bool removed = false;
+            size_t i = lo;
+            while (i < hi) {
+                uint8_t ti = extract_byte<BITS>(ik_at(i));
+                size_t a = i + 1, b = hi;
+                while (a < b) {
+                    size_t mid = a + (b - a) / 2;
+                    if (extract_byte<BITS>(ik_at(mid)) == ti) a = mid + 1;
+                    else b = mid;
+                }
+
+                auto* hdr = get_header(node);
+                typename BO::child_lookup cl = sc > 0
+                    ? BO::chain_lookup(node, sc, ti) : BO::lookup(node, ti);
+                if (cl.found) {
+                    size_t was = erased;
+                    uint64_t c = erase_batch<BITS - 8>(cl.child, ik_at,
+                                                       i, a, erased, bld);
+                    if (c == 0) {
+                        node = sc > 0
+                            ? BO::chain_remove_child(node, hdr, sc, cl.slot, ti, bld)
+                            : BO::remove_child(node, hdr, cl.slot, ti, bld);
+                        if (!node) return 0;  // last child gone
+                        removed = true;
+                    } else {
+                        if (c != cl.child) {
+                            if (sc > 0) BO::chain_set_child(node, sc, cl.slot, c);
+                            else        BO::set_child(node, cl.slot, c);
+                        }
+                        if constexpr (HAS_AGG<AGG>)
+                            if (erased != was) BO::refresh_agg(node, sc, cl.slot);
+                    }
+                }
+                i = a;
+            }
+            if (erased == before) return tag_bitmask(node);
+
+            auto* hdr = get_header(node);
+            uint64_t& d = BO::chain_descendants_mut(node, sc, hdr->entries());
+            d -= erased - before;
+            if (!removed && d > COALESCE_MAX) return tag_bitmask(node);
+            return settle_bitmask<BITS>(node, sc, d, bld).tagged_ptr;
+        }
+        __builtin_unreachable();
+    }
+
+    // Rebuild a leaf from the entries that survive the run
+    template<int BITS, typename IK_AT> requires (BITS >= 8)
+    static uint64_t erase_leaf_batch(uint64_t* node, IK_AT& ik_at,
+                                       size_t lo, size_t hi,
+                                       size_t& erased, BLD& bld) {
+        constexpr int DEPTH = (KEY_BITS - BITS) / 8;
+        uint64_t above = 0;
+        if constexpr (DEPTH > 0)
+            above = ik_at(lo) & (~uint64_t(0) << (64 - 8 * DEPTH));
+
+        size_t i = lo;
+        return erase_leaf_if<BITS>(node, above, [&](uint64_t ek) {
+            while (i < hi && ik_at(i) < ek) ++i;
+            return i < hi && ik_at(i) == ek;
+        }, erased, bld);
+    }
+
+    // Rebuild a leaf without the entries whose root-level ik satisfies
+    // drop(ik); drop sees the iks in ascending order. above holds the
+    // bytes above the leaf's depth. Returns 0 if nothing survives.
+    template<int BITS, typename DROP> requires (BITS >= 8)
+    static uint64_t erase_leaf_if(uint64_t* node, uint64_t above,
+                                    DROP&& drop, size_t& erased, BLD& bld) {
+        auto* hdr = get_header(node);
+        size_t old_n = hdr->entries();
+        auto mk = std::make_unique<uint64_t[]>(old_n);
+        auto mv = std::make_unique<VST[]>(old_n);
+
+        size_t n = 0;
+        const auto* fn = BO::leaf_fn(node);
+        for (auto r = fn->first(node); r.found; r = fn->step_next(node, r.pos)) {
+            uint64_t ek = above | r.key;
+            mk[n] = ek;
+            mv[n] = *r.value;
+            if (drop(ek)) bld.destroy_value(mv[n]);
+            else ++n;
+        }
+        if (n == old_n) return tag_leaf(node);
+        erased += old_n - n;
+
+        bld.dealloc_node(node, hdr->alloc_u64());
+        if (n == 0) return 0;
+        auto mk_at = [&](size_t j) { return mk[j]; };
+        auto mv_at = [&](size_t j) { return mv[j]; };
+        size_t entries = 0;
+        return build_sorted<BITS>(mk_at, mv_at, 0, n, entries, bld);
+    }
+
     // ==================================================================
     // prepend_skip / remove_skip — no realloc, sets fn pointer + prefix.
     // prefix is LEFT-ALIGNED in node[2] (skip bytes at top of u64).
@@ -507,6 +1156,18 @@ struct kntrie_ops {
         return node;
     }
 
+    // Prepend for a leaf replacing a node `up` levels above BITS
+    // (a collapsed skip chain): fn must come from the leaf's new home level.
+    template<int BITS>
+    static uint64_t* prepend_skip_above(uint64_t* node, uint8_t new_len,
+                                          uint64_t new_pfx, uint8_t up, BLD& bld) {
+        if (up == 0) [[likely]]
+            return prepend_skip<BITS>(node, new_len, new_pfx, bld);
+        if constexpr (BITS + 8 <= KEY_BITS)
+            return prepend_skip_above<BITS + 8>(node, new_len, new_pfx, up - 1, bld);
+        __builtin_unreachable();
+    }
+
     template<int BITS>
     static uint64_t* remove_skip(uint64_t* node, BLD&) {
         set_leaf_prefix(node, 0);
@@ -665,11 +1326,39 @@ struct kntrie_ops {
         });
         if (!ins) { wk[wi] = suffix; wv[wi] = value; }
 
-        uint64_t child_tagged = build_node_from_arrays_tagged<BITS>(
-            wk.get(), wv.get(), total, bld);
+        uint64_t child_tagged = inherit_skip(node, hdr,
+            build_node_from_arrays_tagged<BITS>(wk.get(), wv.get(), total, bld), bld);
+
+        bld.dealloc_node(const_cast<uint64_t*>(node), hdr->alloc_u64());
+        return child_tagged;
+    }
 
-        // Propagate old skip/prefix to new child.
-        // Save old fn pointer — it has the correct tree-level BITS baked in.
+    // split_leaf_tagged — node's entries rebuilt as leaves of at most
+    // leaf_max entries under bitmasks. node is left as it was; its value
+    // slots are copied, so VALUE must be stored inline.
+    template<int BITS>
+    static uint64_t split_leaf_tagged(const uint64_t* node, size_t leaf_max,
+                                        BLD& bld) {
+        static_assert(VT::IS_INLINE);
+        using NK = nk_for_bits_t<BITS>;
+        const auto* hdr = get_header(node);
+        size_t count = hdr->entries();
+        auto wk = std::make_unique<NK[]>(count);
+        auto wv = std::make_unique<VST[]>(count);
+
+        size_t wi = 0;
+        leaf_for_each<BITS>(node, hdr, [&](NK s, VST v) {
+            wk[wi] = s; wv[wi] = v; wi++;
+        });
+        return inherit_skip(node, hdr,
+            build_node_from_arrays_tagged<BITS>(wk.get(), wv.get(), count, bld, leaf_max),
+            bld);
+    }
+
+    // Propagate a replaced leaf's skip/prefix to the node built from it.
+    // Save old fn pointer — it has the correct tree-level BITS baked in.
+    static uint64_t inherit_skip(const uint64_t* node, const node_header_t* hdr,
+                                   uint64_t child_tagged, BLD& bld) {
         uint8_t ps = hdr->skip();
         if (ps > 0) {
             const leaf_fn_t* old_fn = BO::leaf_fn(node);
@@ -694,7 +1383,6 @@ struct kntrie_ops {
             }
         }
 
-        bld.dealloc_node(const_cast<uint64_t*>(node), hdr->alloc_u64());
         return child_tagged;
     }
 
@@ -702,13 +1390,14 @@ struct kntrie_ops {
     // Insert — uint64_t ik (root-level), no shifting, no narrowing
     // ==================================================================
 
-    template<int BITS, bool INSERT, bool ASSIGN> requires (BITS >= 8)
+    template<int BITS, bool INSERT, bool ASSIGN, typename HIT = no_hit_t> requires (BITS >= 8)
     static insert_result_t insert_node(uint64_t ptr, uint64_t ik, VST value,
-                                         BLD& bld) {
+                                         BLD& bld, HIT hit = {}) {
         // SENTINEL
         if (ptr == BO::SENTINEL_TAGGED) [[unlikely]] {
             if constexpr (!INSERT) return {ptr, false, false};
-            return {tag_leaf(make_single_leaf<BITS>(ik, value, bld)), true, false};
+            uint64_t* leaf = make_single_leaf<BITS>(ik, value, bld);
+            return {tag_leaf(leaf), true, false, leaf};
         }
 
         // LEAF
@@ -720,10 +1409,10 @@ struct kntrie_ops {
             if (skip) [[unlikely]] {
                 uint64_t pfx_u64 = leaf_prefix(node);
                 return insert_leaf_skip<BITS, INSERT, ASSIGN>(
-                    node, hdr, ik, value, pfx_u64, skip, 0, bld);
+                    node, hdr, ik, value, pfx_u64, skip, 0, bld, hit);
             }
 
-            return leaf_insert<BITS, INSERT, ASSIGN>(node, hdr, ik, value, bld);
+            return leaf_insert<BITS, INSERT, ASSIGN>(node, hdr, ik, value, bld, hit);
         }
 
         // BITMASK
@@ -733,94 +1422,99 @@ struct kntrie_ops {
 
         if (sc > 0) [[unlikely]]
             return insert_chain_skip<BITS, INSERT, ASSIGN>(
-                node, hdr, sc, ik, value, 0, bld);
+                node, hdr, sc, ik, value, 0, bld, hit);
 
         return insert_final_bitmask<BITS, INSERT, ASSIGN>(
-            node, hdr, 0, ik, value, bld);
+            node, hdr, 0, ik, value, bld, hit);
     }
 
     // --- Leaf skip prefix: byte-at-a-time via constexpr depth ---
-    template<int BITS, bool INSERT, bool ASSIGN> requires (BITS >= 8)
+    template<int BITS, bool INSERT, bool ASSIGN, typename HIT = no_hit_t> requires (BITS >= 8)
     static insert_result_t insert_leaf_skip(
             uint64_t* node, node_header_t* hdr,
             uint64_t ik, VST value,
             uint64_t pfx_u64, uint8_t skip, uint8_t pos,
-            BLD& bld) {
+            BLD& bld, HIT hit = {}) {
         if (pos >= skip) [[unlikely]]
-            return leaf_insert<BITS, INSERT, ASSIGN>(node, hdr, ik, value, bld);
+            return leaf_insert<BITS, INSERT, ASSIGN>(node, hdr, ik, value, bld, hit);
 
         uint8_t expected = extract_byte<BITS>(ik);
         if (expected != pfx_byte(pfx_u64, pos)) [[unlikely]] {
             if constexpr (!INSERT) return {tag_leaf(node), false, false};
             if constexpr (BITS > 8) {
-                return {split_on_prefix<BITS>(node, hdr, ik, value,
-                                                pfx_u64, skip, pos, bld), true, false};
+                uint64_t t = split_on_prefix<BITS>(node, hdr, ik, value,
+                                                   pfx_u64, skip, pos, bld);
+                return {t, true, false,
+                        leaf_below(t, ik, byte_shift<BITS>() + 8 * pos)};
             }
             __builtin_unreachable();
         }
 
         if constexpr (BITS > 8) {
             return insert_leaf_skip<BITS - 8, INSERT, ASSIGN>(
-                node, hdr, ik, value, pfx_u64, skip, pos + 1, bld);
+                node, hdr, ik, value, pfx_u64, skip, pos + 1, bld, hit);
         }
         __builtin_unreachable();
     }
 
     // --- Leaf insert: compile-time NK dispatch ---
-    template<int BITS, bool INSERT, bool ASSIGN>
+    template<int BITS, bool INSERT, bool ASSIGN, typename HIT = no_hit_t>
     static insert_result_t leaf_insert(uint64_t* node, node_header_t* hdr,
-                                         uint64_t ik, VST value, BLD& bld) {
+                                         uint64_t ik, VST value, BLD& bld,
+                                         HIT hit = {}) {
         using NK = nk_for_bits_t<BITS>;
         NK suffix = leaf_ops_t<BITS>::template to_suffix<BITS>(ik);
 
         insert_result_t result;
         if constexpr (sizeof(NK) == 1) {
             result = BO::template bitmap_insert<INSERT, ASSIGN>(
-                node, static_cast<uint8_t>(suffix), value, bld);
+                node, static_cast<uint8_t>(suffix), value, bld, hit);
         } else {
             using CO = compact_ops<NK, VALUE, ALLOC>;
             result = CO::template insert<INSERT, ASSIGN>(
-                node, hdr, suffix, value, bld);
+                node, hdr, suffix, value, bld, hit);
         }
         if (result.needs_split) [[unlikely]] {
             if constexpr (!INSERT) return {tag_leaf(node), false, false};
-            return {convert_to_bitmask_tagged<BITS>(node, hdr, ik, value, bld),
-                    true, false};
+            uint8_t ps = hdr->skip();  // node is freed by the convert
+            uint64_t t = convert_to_bitmask_tagged<BITS>(node, hdr, ik, value, bld);
+            return {t, true, false, leaf_below(t, ik, byte_shift<BITS>() + 8 * ps)};
         }
+        result.leaf = untag_leaf_mut(result.tagged_ptr);
         return result;
     }
 
     // --- Skip chain: byte-at-a-time via constexpr depth ---
-    template<int BITS, bool INSERT, bool ASSIGN> requires (BITS >= 8)
+    template<int BITS, bool INSERT, bool ASSIGN, typename HIT = no_hit_t> requires (BITS >= 8)
     static insert_result_t insert_chain_skip(
             uint64_t* node, node_header_t* hdr,
             uint8_t sc, uint64_t ik, VST value, uint8_t pos,
-            BLD& bld) {
+            BLD& bld, HIT hit = {}) {
         if (pos >= sc) [[unlikely]]
             return insert_final_bitmask<BITS, INSERT, ASSIGN>(
-                node, hdr, sc, ik, value, bld);
+                node, hdr, sc, ik, value, bld, hit);
 
         uint8_t actual_byte = BO::skip_byte(node, pos);
         uint8_t expected = extract_byte<BITS>(ik);
 
         if (expected != actual_byte) [[unlikely]] {
             if constexpr (!INSERT) return {tag_bitmask(node), false, false};
-            return {split_skip_at<BITS>(node, hdr, sc, pos, ik, value, bld),
-                    true, false};
+            uint64_t t = split_skip_at<BITS>(node, hdr, sc, pos, ik, value, bld);
+            return {t, true, false, leaf_below(t, ik, byte_shift<BITS>() + 8 * pos)};
         }
 
         if constexpr (BITS > 8) {
             return insert_chain_skip<BITS - 8, INSERT, ASSIGN>(
-                node, hdr, sc, ik, value, pos + 1, bld);
+                node, hdr, sc, ik, value, pos + 1, bld, hit);
         }
         __builtin_unreachable();
     }
 
     // --- Final bitmask: lookup + recurse ---
-    template<int BITS, bool INSERT, bool ASSIGN> requires (BITS >= 8)
+    template<int BITS, bool INSERT, bool ASSIGN, typename HIT = no_hit_t> requires (BITS >= 8)
     static insert_result_t insert_final_bitmask(
             uint64_t* node, node_header_t* hdr,
-            uint8_t sc, uint64_t ik, VST value, BLD& bld) {
+            uint8_t sc, uint64_t ik, VST value, BLD& bld, HIT hit = {}) {
         uint8_t ti = extract_byte<BITS>(ik);
 
         typename BO::child_lookup cl;
@@ -845,13 +1539,13 @@ struct kntrie_ops {
             else
                 nn = BO::add_child(node, hdr, ti, tag_leaf(leaf), bld);
             inc_descendants(nn, get_header(nn));
-            return {tag_bitmask(nn), true, false};
+            return {tag_bitmask(nn), true, false, leaf};
         }
 
         // Found — recurse into child
         if constexpr (BITS > 8) {
             auto cr = insert_node<BITS - 8, INSERT, ASSIGN>(
-                cl.child, ik, value, bld);
+                cl.child, ik, value, bld, hit);
 
             if (cr.tagged_ptr != cl.child) {
                 if (sc > 0) [[unlikely]]
@@ -859,9 +1553,17 @@ struct kntrie_ops {
                 else
                     BO::set_child(node, cl.slot, cr.tagged_ptr);
             }
+            if constexpr (HAS_AGG<AGG>) {
+                // A new entry folds in; an overwritten one may have been
+                // the child's min/max, so that child is refolded
+                if (cr.inserted)
+                    BO::combine_agg(node, sc, cl.slot, AGG::lift(*VT::as_ptr(value)));
+                else if (ASSIGN || HAS_HIT<HIT>)
+                    BO::refresh_agg(node, sc, cl.slot);
+            }
             if (cr.inserted)
                 inc_descendants(node, hdr);
-            return {tag_bitmask(node), cr.inserted, false};
+            return {tag_bitmask(node), cr.inserted, false, cr.leaf};
         }
         __builtin_unreachable();
     }
@@ -987,8 +1689,10 @@ struct kntrie_ops {
                     BO::set_child(node, cl.slot, cr.tagged_ptr);
             }
             uint64_t exact = dec_descendants(node, hdr);
-            if (exact <= COMPACT_MAX) [[unlikely]]
+            if (exact <= COALESCE_MAX) [[unlikely]]
                 return do_coalesce<BITS>(node, hdr, bld);
+            if constexpr (HAS_AGG<AGG>)
+                BO::refresh_agg(node, sc, cl.slot);
             return {tag_bitmask(node), true, exact};
         }
 
@@ -1000,9 +1704,17 @@ struct kntrie_ops {
             nn = BO::remove_child(node, hdr, cl.slot, ti, bld);
         if (!nn) [[unlikely]] return {0, true, 0};
 
-        hdr = get_header(nn);
+        return settle_bitmask<BITS>(nn, sc, dec_descendants(nn, get_header(nn)), bld);
+    }
+
+    // After children were removed from a (chain) bitmask at final BITS:
+    // collapse a sole child into the parent slot, coalesce a small
+    // subtree into one leaf, or keep the node.
+    template<int BITS> requires (BITS >= 8)
+    static erase_result_t settle_bitmask(uint64_t* nn, uint8_t sc,
+                                           uint64_t exact, BLD& bld) {
+        auto* hdr = get_header(nn);
         unsigned nc = hdr->entries();
-        uint64_t exact = dec_descendants(nn, hdr);
 
         // Collapse when final bitmask drops to 1 child
         if (nc == 1) [[unlikely]] {
@@ -1015,8 +1727,8 @@ struct kntrie_ops {
 
             if (ci.sole_child & LEAF_BIT) {
                 uint64_t* leaf = untag_leaf_mut(ci.sole_child);
-                leaf = prepend_skip<BITS>(leaf, ci.total_skip,
-                           pack_prefix(ci.bytes, ci.total_skip), bld);
+                leaf = prepend_skip_above<BITS>(leaf, ci.total_skip,
+                           pack_prefix(ci.bytes, ci.total_skip), sc, bld);
                 bld.dealloc_node(nn, nn_au64);
                 return {tag_leaf(leaf), true, exact};
             }
@@ -1026,7 +1738,7 @@ struct kntrie_ops {
                     true, exact};
         }
 
-        if (exact <= COMPACT_MAX) [[unlikely]]
+        if (exact <= COALESCE_MAX) [[unlikely]]
             return do_coalesce<BITS>(nn, get_header(nn), bld);
         return {tag_bitmask(nn), true, exact};
     }
@@ -1185,7 +1897,7 @@ struct kntrie_ops {
         if (sc > 0) [[unlikely]] {
             uint8_t sb[6];
             BO::skip_bytes(node, sc, sb);
-            leaf = prepend_skip<BITS>(leaf, sc, pack_prefix(sb, sc), bld);
+            leaf = prepend_skip_above<BITS>(leaf, sc, pack_prefix(sb, sc), sc, bld);
         }
 
         dealloc_coalesced_node<BITS>(node, sc, bld);
@@ -1274,186 +1986,6 @@ struct kntrie_ops {
             dealloc_leaf_skip<BITS - 8>(node, skip - 1, bld);
         }
     }
-
-    // ==================================================================
-    // Iteration — tree-level next/prev + descend first/last.
-    // ik is root-level. No sentinel checks.
-    // ==================================================================
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t descend_first(uint64_t ptr) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] {
-            const uint64_t* node = untag_leaf(ptr);
-            return BO::leaf_fn(node)->first(node);
-        }
-
-        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        if constexpr (BITS > 8)
-            return descend_first<BITS - 8>(bm[BITMAP_256_U64 + 1]);
-        __builtin_unreachable();
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t descend_last(uint64_t ptr) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] {
-            const uint64_t* node = untag_leaf(ptr);
-            return BO::leaf_fn(node)->last(node);
-        }
-
-        const uint64_t* bm = reinterpret_cast<const uint64_t*>(ptr);
-        auto* hdr = get_header(bm_to_node_const(reinterpret_cast<uint64_t>(bm)));
-        int last = hdr->entries() - 1;
-        if constexpr (BITS > 8)
-            return descend_last<BITS - 8>(bm[BITMAP_256_U64 + 1 + last]);
-        __builtin_unreachable();
-    }
-
-    // --- iter_next_tree: find smallest key > ik (root-level) ---
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_next_tree(uint64_t ptr, uint64_t ik) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] {
-            const uint64_t* node = untag_leaf(ptr);
-            return BO::leaf_fn(node)->next(node, ik);
-        }
-
-        const uint64_t* node = bm_to_node_const(ptr);
-        uint8_t sc = get_header(node)->skip();
-        if (sc > 0) [[unlikely]]
-            return iter_next_chain_skip<BITS>(node, sc, 0, ik);
-        return iter_next_bm_final<BITS>(node, sc, ik);
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_next_chain_skip(
-            const uint64_t* node, uint8_t sc, uint8_t pos,
-            uint64_t ik) noexcept {
-        if (pos >= sc) [[unlikely]]
-            return iter_next_bm_final<BITS>(node, sc, ik);
-
-        uint8_t actual = BO::skip_byte(node, pos);
-        uint8_t expected = extract_byte<BITS>(ik);
-
-        if (expected != actual) [[unlikely]] {
-            if (expected < actual) {
-                if constexpr (BITS > 8)
-                    return iter_next_bm_final_first<BITS>(node, sc);
-                __builtin_unreachable();
-            }
-            return {0, nullptr, false};
-        }
-
-        if constexpr (BITS > 8) {
-            return iter_next_chain_skip<BITS - 8>(node, sc, pos + 1, ik);
-        }
-        __builtin_unreachable();
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_next_bm_final_first(
-            const uint64_t* node, uint8_t sc) noexcept {
-        const uint64_t* rch = BO::chain_children(node, sc);
-        if constexpr (BITS > 8)
-            return descend_first<BITS - 8>(rch[0]);
-        __builtin_unreachable();
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_next_bm_final(
-            const uint64_t* node, uint8_t sc,
-            uint64_t ik) noexcept {
-        const bitmap_256_t& fbm = BO::chain_bitmap(node, sc);
-        const uint64_t* children = BO::chain_children(node, sc);
-        uint8_t byte = extract_byte<BITS>(ik);
-
-        int slot = fbm.find_slot<slot_mode::FAST_EXIT>(byte);
-        if (slot >= 0) [[likely]] {
-            if constexpr (BITS > 8) {
-                auto r = iter_next_tree<BITS - 8>(children[slot], ik);
-                if (r.found) [[likely]] return r;
-            }
-        }
-
-        auto adj = fbm.next_set_after(byte);
-        if (adj.found) [[unlikely]] {
-            if constexpr (BITS > 8)
-                return descend_first<BITS - 8>(children[adj.slot]);
-        }
-        return {0, nullptr, false};
-    }
-
-    // --- iter_prev_tree: find largest key < ik (root-level) ---
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_prev_tree(uint64_t ptr, uint64_t ik) noexcept {
-        if (ptr & LEAF_BIT) [[unlikely]] {
-            const uint64_t* node = untag_leaf(ptr);
-            return BO::leaf_fn(node)->prev(node, ik);
-        }
-
-        const uint64_t* node = bm_to_node_const(ptr);
-        uint8_t sc = get_header(node)->skip();
-        if (sc > 0) [[unlikely]]
-            return iter_prev_chain_skip<BITS>(node, sc, 0, ik);
-        return iter_prev_bm_final<BITS>(node, sc, ik);
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_prev_chain_skip(
-            const uint64_t* node, uint8_t sc, uint8_t pos,
-            uint64_t ik) noexcept {
-        if (pos >= sc) [[unlikely]]
-            return iter_prev_bm_final<BITS>(node, sc, ik);
-
-        uint8_t actual = BO::skip_byte(node, pos);
-        uint8_t expected = extract_byte<BITS>(ik);
-
-        if (expected != actual) [[unlikely]] {
-            if (expected > actual) {
-                if constexpr (BITS > 8)
-                    return iter_prev_bm_final_last<BITS>(node, sc);
-                __builtin_unreachable();
-            }
-            return {0, nullptr, false};
-        }
-
-        if constexpr (BITS > 8) {
-            return iter_prev_chain_skip<BITS - 8>(node, sc, pos + 1, ik);
-        }
-        __builtin_unreachable();
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_prev_bm_final_last(
-            const uint64_t* node, uint8_t sc) noexcept {
-        const uint64_t* rch = BO::chain_children(node, sc);
-        int last = get_header(node)->entries() - 1;
-        if constexpr (BITS > 8)
-            return descend_last<BITS - 8>(rch[last]);
-        __builtin_unreachable();
-    }
-
-    template<int BITS> requires (BITS >= 8)
-    static leaf_result_t iter_prev_bm_final(
-            const uint64_t* node, uint8_t sc,
-            uint64_t ik) noexcept {
-        const bitmap_256_t& fbm = BO::chain_bitmap(node, sc);
-        const uint64_t* children = BO::chain_children(node, sc);
-        uint8_t byte = extract_byte<BITS>(ik);
-
-        int slot = fbm.find_slot<slot_mode::FAST_EXIT>(byte);
-        if (slot >= 0) [[likely]] {
-            if constexpr (BITS > 8) {
-                auto r = iter_prev_tree<BITS - 8>(children[slot], ik);
-                if (r.found) [[likely]] return r;
-            }
-        }
-
-        auto adj = fbm.prev_set_before(byte);
-        if (adj.found) [[unlikely]] {
-            if constexpr (BITS > 8)
-                return descend_last<BITS - 8>(children[adj.slot]);
-        }
-        return {0, nullptr, false};
-    }
 };
 
 } // namespace gteitelbaum
@@ -0,0 +1,334 @@
+#ifndef KNTRIE_SHARDED_HPP
+#define KNTRIE_SHARDED_HPP
+
+#include "kntrie.hpp"
+#include <array>
+#include <bit>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+namespace gteitelbaum {
+
+// ==========================================================================
+// kntrie_sharded — SHARDS independent tries, split on the top key bits.
+//
+// The shard of a key is the top log2(SHARDS) bits of the byte the root
+// dispatches on, so shard i holds one contiguous key range and every
+// key in shard i sorts below every key in shard i + 1. Each shard has
+// its own trie (and builder) behind its own reader-writer lock; writers
+// to different shards never contend.
+//
+// Point operations lock one shard. Sorted batches lock each shard once
+// for its run. Whole-container reads (size, memory_usage, for_each) go
+// shard by shard, so under concurrent writes they are not one point in
+// time; read_all() locks every shard for a consistent ordered view.
+//
+// The view holds those read locks until it is destroyed, and a write
+// waits for them. A thread must drop its view before it writes to the
+// container, or the write deadlocks on the thread's own lock.
+// ==========================================================================
+
+template<typename KEY, typename VALUE, unsigned SHARDS = 16,
+         typename ALLOC = std::allocator<uint64_t>>
+class kntrie_sharded {
+    static_assert(SHARDS >= 1 && SHARDS <= 256 && std::has_single_bit(SHARDS),
+                  "SHARDS must be a power of two in [1, 256]");
+
+    using trie_t = kntrie<KEY, VALUE, ALLOC>;
+    using UK     = std::make_unsigned_t<KEY>;
+
+    static constexpr int KEY_BITS   = sizeof(KEY) * 8;
+    static constexpr int SHARD_BITS = std::countr_zero(SHARDS);
+    static constexpr UK  SIGN_BIT   = std::is_signed_v<KEY>
+        ? (UK(1) << (KEY_BITS - 1)) : UK(0);
+
+    struct alignas(64) shard_t {
+        mutable std::shared_mutex mutex_v;
+        trie_t                    trie_v;
+    };
+
+public:
+    using key_type    = KEY;
+    using mapped_type = VALUE;
+    using size_type   = std::size_t;
+
+    static constexpr unsigned shard_count = SHARDS;
+
+    // Same order as kntrie: signed keys are biased so negatives come first
+    static unsigned shard_of(const KEY& key) noexcept {
+        if constexpr (SHARD_BITS == 0) return 0;
+        else return static_cast<unsigned>(
+            (static_cast<UK>(key) ^ SIGN_BIT) >> (KEY_BITS - SHARD_BITS));
+    }
+
+    kntrie_sharded() = default;
+    kntrie_sharded(const kntrie_sharded&) = delete;
+    kntrie_sharded& operator=(const kntrie_sharded&) = delete;
+
+    // ==================================================================
+    // Size — summed shard by shard
+    // ==================================================================
+
+    [[nodiscard]] size_type size() const {
+        size_type n = 0;
+        for (const auto& s : shards_v) {
+            std::shared_lock lock(s.mutex_v);
+            n += s.trie_v.size();
+        }
+        return n;
+    }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    size_t memory_usage() const {
+        size_t n = 0;
+        for (const auto& s : shards_v) {
+            std::shared_lock lock(s.mutex_v);
+            n += s.trie_v.memory_usage();
+        }
+        return n;
+    }
+
+    // ==================================================================
+    // Modifiers — one shard each
+    // ==================================================================
+
+    std::pair<bool, bool> insert(const KEY& key, const VALUE& value) {
+        return write(key, [&](trie_t& t) { return t.insert(key, value); });
+    }
+    std::pair<bool, bool> insert(const KEY& key, VALUE&& value) {
+        return write(key, [&](trie_t& t) { return t.insert(key, std::move(value)); });
+    }
+    template<typename M = VALUE>
+    std::pair<bool, bool> insert_or_assign(const KEY& key, M&& value) {
+        return write(key, [&](trie_t& t) {
+            return t.insert_or_assign(key, std::forward<M>(value));
+        });
+    }
+    template<typename M = VALUE>
+    std::pair<bool, bool> assign(const KEY& key, M&& value) {
+        return write(key, [&](trie_t& t) { return t.assign(key, std::forward<M>(value)); });
+    }
+
+    // make_fn / update_fn run under the shard's write lock
+    template<typename MakeFn, typename UpdateFn>
+    std::pair<bool, bool> upsert(const KEY& key, MakeFn&& make_fn, UpdateFn&& update_fn) {
+        return write(key, [&](trie_t& t) {
+            return t.upsert(key, std::forward<MakeFn>(make_fn),
+                            std::forward<UpdateFn>(update_fn));
+        });
+    }
+
+    size_type erase(const KEY& key) {
+        return write(key, [&](trie_t& t) { return t.erase(key); });
+    }
+
+    void clear() {
+        for (auto& s : shards_v) {
+            std::unique_lock lock(s.mutex_v);
+            s.trie_v.clear();
+        }
+    }
+
+    // Keys ascending: each shard's run is one sorted batch under one lock
+    size_type insert_sorted_batch(const KEY* keys, const VALUE* values, size_t n) {
+        size_type inserted = 0;
+        for_each_run(keys, n, [&](unsigned sh, size_t lo, size_t hi) {
+            std::unique_lock lock(shards_v[sh].mutex_v);
+            inserted += shards_v[sh].trie_v.insert_sorted_batch(
+                keys + lo, values + lo, hi - lo);
+        });
+        return inserted;
+    }
+
+    size_type erase_sorted_batch(const KEY* keys, size_t n) {
+        size_type erased = 0;
+        for_each_run(keys, n, [&](unsigned sh, size_t lo, size_t hi) {
+            std::unique_lock lock(shards_v[sh].mutex_v);
+            erased += shards_v[sh].trie_v.erase_sorted_batch(keys + lo, hi - lo);
+        });
+        return erased;
+    }
+
+    // ==================================================================
+    // Lookup — values are copied or visited under the shard's read lock
+    // ==================================================================
+
+    bool contains(const KEY& key) const {
+        return read(key, [&](const trie_t& t) { return t.contains(key); });
+    }
+    size_type count(const KEY& key) const { return contains(key) ? 1 : 0; }
+
+    std::optional<VALUE> get(const KEY& key) const {
+        return read(key, [&](const trie_t& t) -> std::optional<VALUE> {
+            const VALUE* v = t.find_value(key);
+            if (!v) return std::nullopt;
+            return *v;
+        });
+    }
+
+    // fn(const VALUE&) if key is present; returns whether it was
+    template<typename F>
+    bool visit(const KEY& key, F&& fn) const {
+        return read(key, [&](const trie_t& t) {
+            const VALUE* v = t.find_value(key);
+            if (v) fn(*v);
+            return v != nullptr;
+        });
+    }
+
+    // fn(KEY, const VALUE&) in key order, one shard locked at a time
+    template<typename F>
+    void for_each(F&& fn) const {
+        for (const auto& s : shards_v) {
+            std::shared_lock lock(s.mutex_v);
+            for (auto it = s.trie_v.begin(); it != s.trie_v.end(); ++it)
+                fn(it.key(), it.value());
+        }
+    }
+
+    // ==================================================================
+    // read_all — every shard read-locked; ordered iteration across them
+    // ==================================================================
+
+    class locked_view;
+    locked_view read_all() const { return locked_view(*this); }
+
+    // Direct access for single-threaded phases; no locking
+    trie_t&       shard(unsigned i) noexcept       { return shards_v[i].trie_v; }
+    const trie_t& shard(unsigned i) const noexcept { return shards_v[i].trie_v; }
+
+private:
+    template<typename F>
+    decltype(auto) write(const KEY& key, F&& fn) {
+        shard_t& s = shards_v[shard_of(key)];
+        std::unique_lock lock(s.mutex_v);
+        return fn(s.trie_v);
+    }
+
+    template<typename F>
+    decltype(auto) read(const KEY& key, F&& fn) const {
+        const shard_t& s = shards_v[shard_of(key)];
+        std::shared_lock lock(s.mutex_v);
+        return fn(s.trie_v);
+    }
+
+    // fn(shard, lo, hi) for each maximal run of keys[lo, hi) in one shard
+    template<typename F>
+    static void for_each_run(const KEY* keys, size_t n, F&& fn) {
+        for (size_t lo = 0; lo < n;) {
+            unsigned sh = shard_of(keys[lo]);
+            size_t hi = lo + 1;
+            while (hi < n && shard_of(keys[hi]) == sh) ++hi;
+            fn(sh, lo, hi);
+            lo = hi;
+        }
+    }
+
+    std::array<shard_t, SHARDS> shards_v;
+};
+
+// ==========================================================================
+// locked_view — holds every shard's read lock (taken in shard order)
+// until destroyed. Its iterator walks the shards in turn, which is key
+// order since shards own ascending ranges. Writers block meanwhile.
+// ==========================================================================
+
+template<typename KEY, typename VALUE, unsigned SHARDS, typename ALLOC>
+class kntrie_sharded<KEY, VALUE, SHARDS, ALLOC>::locked_view {
+    friend class kntrie_sharded;
+
+    explicit locked_view(const kntrie_sharded& owner) : owner_v(&owner) {
+        for (unsigned i = 0; i < SHARDS; ++i)
+            locks_v[i] = std::shared_lock(owner.shards_v[i].mutex_v);
+    }
+
+    using inner_t = typename trie_t::const_iterator;
+
+public:
+    class const_iterator {
+        friend class locked_view;
+
+        const kntrie_sharded* owner_v = nullptr;
+        unsigned              shard_v = SHARDS;
+        inner_t               inner_v{};
+
+        const_iterator(const kntrie_sharded* o, unsigned sh, inner_t it)
+            : owner_v(o), shard_v(sh), inner_v(it) { settle(); }
+
+        // Move past exhausted shards
+        void settle() noexcept {
+            while (shard_v < SHARDS && inner_v == owner_v->shard(shard_v).end())
+                if (++shard_v < SHARDS) inner_v = owner_v->shard(shard_v).begin();
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename trie_t::const_iterator::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = typename trie_t::const_iterator::reference;
+        using pointer           = typename trie_t::const_iterator::pointer;
+
+        const_iterator() = default;
+
+        KEY key() const noexcept { return inner_v.key(); }
+        const VALUE& value() const noexcept { return inner_v.value(); }
+        reference operator*() const noexcept { return *inner_v; }
+        pointer operator->() const noexcept { return inner_v.operator->(); }
+
+        const_iterator& operator++() {
+            ++inner_v;
+            settle();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& o) const noexcept {
+            if (shard_v != o.shard_v) return false;
+            return shard_v == SHARDS || inner_v == o.inner_v;
+        }
+    };
+    using iterator = const_iterator;
+
+    size_type size() const noexcept {
+        size_type n = 0;
+        for (const auto& s : owner_v->shards_v) n += s.trie_v.size();
+        return n;
+    }
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    const VALUE* find_value(const KEY& key) const noexcept {
+        return owner_v->shard(shard_of(key)).find_value(key);
+    }
+
+    const_iterator begin() const { return {owner_v, 0, owner_v->shard(0).begin()}; }
+    const_iterator end() const noexcept { return const_iterator{}; }
+
+    const_iterator lower_bound(const KEY& k) const {
+        unsigned sh = shard_of(k);
+        return {owner_v, sh, owner_v->shard(sh).lower_bound(k)};
+    }
+    const_iterator upper_bound(const KEY& k) const {
+        unsigned sh = shard_of(k);
+        return {owner_v, sh, owner_v->shard(sh).upper_bound(k)};
+    }
+    const_iterator find(const KEY& k) const {
+        unsigned sh = shard_of(k);
+        auto it = owner_v->shard(sh).find(k);
+        if (it == owner_v->shard(sh).end()) return end();
+        return {owner_v, sh, it};
+    }
+
+private:
+    const kntrie_sharded*                        owner_v;
+    std::array<std::shared_lock<std::shared_mutex>, SHARDS> locks_v;
+};
+
+} // namespace gteitelbaum
+
+#endif // KNTRIE_SHARDED_HPP
@@ -9,6 +9,8 @@
 #include <type_traits>
 #include <utility>
 #include <algorithm>
+#include <iterator>
+#include <limits>
 #include <cassert>
 
 namespace gteitelbaum {
@@ -18,7 +20,12 @@ namespace gteitelbaum {
 // ==========================================================================
 
 inline constexpr size_t BITMAP_256_U64 = 4;   // 32 bytes
-inline constexpr size_t COMPACT_MAX   = 4096;
+inline constexpr size_t COMPACT_MAX   = 4096;  // leaf splits past this
+// A bitmask subtree coalesces back into one leaf at this many entries.
+// The gap below COMPACT_MAX keeps a subtree hovering near the split
+// point from rebuilding 4096 entries on every insert/erase pair.
+inline constexpr size_t COALESCE_MAX  = COMPACT_MAX / 2;
+static_assert(COALESCE_MAX < COMPACT_MAX);
 inline constexpr size_t BOT_LEAF_MAX  = 4096;
 inline constexpr size_t HEADER_U64    = 1;   // bitmask node header is 1 u64 (8 bytes)
 inline constexpr size_t LEAF_HEADER_U64 = 3; // leaf header: [0]=hdr, [1]=fn_ptr, [2]=prefix
@@ -145,6 +152,11 @@ inline void pfx_to_bytes(uint64_t pfx, uint8_t* out, uint8_t len) noexcept {
         out[i] = static_cast<uint8_t>(pfx >> (56 - 8 * i));
 }
 
+// --- Uniform word r scaled to [0, n) (high half of r * n) ---
+inline uint64_t scale_random(uint64_t r, uint64_t n) noexcept {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(r) * n) >> 64);
+}
+
 // --- NK type for a given remaining bit count ---
 template<int BITS>
 using nk_for_bits_t = std::conditional_t<(BITS > 32), uint64_t,
@@ -349,8 +361,11 @@ struct value_traits {
     // Two categories:
     //   A: trivially_copyable && sizeof <= 64  → inline, memcpy-safe, no dtor
     //   C: else                                → pointer, has dtor+dealloc
+    // Slots are only 8-byte aligned, so over-aligned types stay in C.
     static constexpr bool IS_TRIVIAL =
-        std::is_trivially_copyable_v<VALUE> && sizeof(VALUE) <= 8;
+        std::is_trivially_copyable_v<VALUE> &&
+        std::is_default_constructible_v<VALUE> &&
+        sizeof(VALUE) <= 64 && alignof(VALUE) <= 8;
     static constexpr bool IS_INLINE = IS_TRIVIAL;
     static constexpr bool HAS_DESTRUCTOR = !IS_TRIVIAL;
     static constexpr bool IS_BOOL = std::is_same_v<VALUE, bool>;
@@ -379,6 +394,13 @@ struct value_traits {
         else                           return s;
     }
 
+    // --- as_ref: slot_type → VALUE& (not for bool, whose slots are bits) ---
+
+    static VALUE& as_ref(slot_type& s) noexcept {
+        if constexpr (IS_TRIVIAL) return s;
+        else                      return *s;
+    }
+
     // --- destroy: release resources held by slot ---
     //   A: noop.  C: call destructor + deallocate.
 
@@ -392,7 +414,7 @@ struct value_traits {
     }
 
     // --- init_slot: write into UNINITIALIZED destination ---
-    // Both A and C are pointer-sized or trivial — always memcpy.
+    // A is trivially copyable and C is a pointer — always memcpy.
 
     static void init_slot(slot_type* dst, const slot_type& val) {
         std::memcpy(dst, &val, sizeof(slot_type));
@@ -456,72 +478,172 @@ struct value_traits {
 template<typename VALUE, bool IS_TRIVIAL, typename ALLOC>
 struct builder;
 
+inline constexpr size_t MEGA_MIN_U64 = 512;     // first mega: 4 KB
+inline constexpr size_t MEGA_MAX_U64 = 65536;   // megas double up to 512 KB
+inline constexpr size_t MEGA_HDR_U64 = 2;       // [0]=next mega, [1]=mega u64s
+
+// Bin index for a size class (n <= FREE_MAX)
+inline constexpr size_t bin_of(size_t n) noexcept {
+    size_t i = 0;
+    while (BIN_SIZES[i] < n) ++i;
+    return i;
+}
+
+// u64s a node of n u64s really takes: its whole bin when slab-sized
+inline constexpr size_t block_u64(size_t n) noexcept {
+    return n <= FREE_MAX ? BIN_SIZES[bin_of(n)] : n;
+}
+
 template<typename VALUE, typename ALLOC>
 struct builder<VALUE, true, ALLOC> {
     ALLOC alloc_v;
+    uint64_t* bins_v[NUM_BINS] = {};  // freelist heads, next ptr in block[0]
+    uint64_t* megas_v    = nullptr;   // all megas, linked through mega[0]
+    uint64_t* bump_v     = nullptr;   // next free u64 in current mega
+    size_t    bump_left_v = 0;        // u64s left in current mega
+    size_t    mega_next_v = MEGA_MIN_U64;
+    size_t    live_bytes_v = 0;          // bytes in live nodes + values
 
     builder() : alloc_v() {}
     explicit builder(const ALLOC& a) : alloc_v(a) {}
+    ~builder() { drain(); }
 
     builder(const builder&) = delete;
     builder& operator=(const builder&) = delete;
 
-    builder(builder&& o) noexcept : alloc_v(std::move(o.alloc_v)) {}
+    builder(builder&& o) noexcept : alloc_v(std::move(o.alloc_v)) {
+        steal(o);
+    }
 
     builder& operator=(builder&& o) noexcept {
-        if (this != &o)
+        if (this != &o) {
+            drain();
             alloc_v = std::move(o.alloc_v);
+            steal(o);
+        }
         return *this;
     }
 
     void swap(builder& o) noexcept {
         using std::swap;
         swap(alloc_v, o.alloc_v);
+        for (size_t i = 0; i < NUM_BINS; ++i) swap(bins_v[i], o.bins_v[i]);
+        swap(megas_v, o.megas_v);
+        swap(bump_v, o.bump_v);
+        swap(bump_left_v, o.bump_left_v);
+        swap(mega_next_v, o.mega_next_v);
+        swap(live_bytes_v, o.live_bytes_v);
     }
 
     const ALLOC& get_allocator() const noexcept { return alloc_v; }
 
+    size_t live_bytes() const noexcept { return live_bytes_v; }
+    void add_live_bytes(size_t n) noexcept { live_bytes_v += n; }
+    void sub_live_bytes(size_t n) noexcept { live_bytes_v -= n; }
+
     // --- Allocate a node ---
     // pad=true: round up for in-place growth (bitmask nodes)
     // pad=false: exact allocation (compact leaves, VALUE*)
+    // Sizes up to FREE_MAX come from the slab; larger go to alloc_v.
+    // Only the header word is zeroed; the caller writes everything else.
     uint64_t* alloc_node(size_t& u64_count, bool pad = true) {
         size_t actual = pad ? round_up_u64(u64_count) : u64_count;
-        uint64_t* p = alloc_v.allocate(actual);
-        std::memset(p, 0, actual * 8);
+        uint64_t* p = actual <= FREE_MAX ? alloc_small(bin_of(actual))
+                                         : alloc_v.allocate(actual);
+        p[0] = 0;
+        live_bytes_v += block_u64(actual) * 8;
         u64_count = actual;
         return p;
     }
 
+    // --- Allocate a fully zeroed node (bitmaps built by set_bit) ---
+    uint64_t* alloc_node_zeroed(size_t& u64_count, bool pad = true) {
+        uint64_t* p = alloc_node(u64_count, pad);
+        std::memset(p, 0, u64_count * 8);
+        return p;
+    }
+
     // --- Return a node ---
     void dealloc_node(uint64_t* p, size_t u64_count) noexcept {
-        if (p == watch_a_v) freed_a_v = true;
-        if (p == watch_b_v) freed_b_v = true;
-        alloc_v.deallocate(p, u64_count);
+        live_bytes_v -= block_u64(u64_count) * 8;
+        if (u64_count <= FREE_MAX) {
+            uint64_t*& head = bins_v[bin_of(u64_count)];
+            p[0] = reinterpret_cast<uint64_t>(head);
+            head = p;
+        } else {
+            alloc_v.deallocate(p, u64_count);
+        }
     }
 
-    // --- Watch: detect if begin/end leaf freed during mutation ---
-    const uint64_t* watch_a_v = nullptr;
-    const uint64_t* watch_b_v = nullptr;
-    bool freed_a_v = false;
-    bool freed_b_v = false;
+    // --- drain: release every mega; all slab blocks must be dead ---
+    void drain() noexcept {
+        while (megas_v) {
+            uint64_t* next = reinterpret_cast<uint64_t*>(megas_v[0]);
+            alloc_v.deallocate(megas_v, megas_v[1]);
+            megas_v = next;
+        }
+        std::fill(std::begin(bins_v), std::end(bins_v), nullptr);
+        bump_v = nullptr;
+        bump_left_v = 0;
+        mega_next_v = MEGA_MIN_U64;
+        live_bytes_v = 0;
+    }
 
-    void set_watches(const uint64_t* a, const uint64_t* b) noexcept {
-        watch_a_v = a; watch_b_v = b;
-        freed_a_v = false; freed_b_v = false;
+private:
+    uint64_t* alloc_small(size_t b) {
+        uint64_t*& head = bins_v[b];
+        if (head) [[likely]] {
+            uint64_t* p = head;
+            head = reinterpret_cast<uint64_t*>(p[0]);
+            return p;
+        }
+        size_t sz = BIN_SIZES[b];
+        if (bump_left_v < sz) [[unlikely]] new_mega();
+        uint64_t* p = bump_v;
+        bump_v += sz;
+        bump_left_v -= sz;
+        return p;
     }
-    void clear_watches() noexcept {
-        watch_a_v = nullptr; watch_b_v = nullptr;
+
+    // Tail of the old mega is carved into the largest bins that fit
+    void new_mega() {
+        for (size_t b = NUM_BINS; b-- > 0 && bump_left_v >= BIN_SIZES[0];) {
+            while (bump_left_v >= BIN_SIZES[b]) {
+                bump_v[0] = reinterpret_cast<uint64_t>(bins_v[b]);
+                bins_v[b] = bump_v;
+                bump_v += BIN_SIZES[b];
+                bump_left_v -= BIN_SIZES[b];
+            }
+        }
+        size_t sz = mega_next_v;
+        uint64_t* m = alloc_v.allocate(sz);
+        m[0] = reinterpret_cast<uint64_t>(megas_v);
+        m[1] = sz;
+        megas_v = m;
+        bump_v = m + MEGA_HDR_U64;
+        bump_left_v = sz - MEGA_HDR_U64;
+        if (mega_next_v < MEGA_MAX_U64) mega_next_v *= 2;
     }
-    bool freed_a() const noexcept { return freed_a_v; }
-    bool freed_b() const noexcept { return freed_b_v; }
 
-    // --- drain: no-op, tree destructor frees nodes individually ---
-    void drain() noexcept {}
+    void steal(builder& o) noexcept {
+        for (size_t i = 0; i < NUM_BINS; ++i)
+            bins_v[i] = std::exchange(o.bins_v[i], nullptr);
+        megas_v = std::exchange(o.megas_v, nullptr);
+        bump_v = std::exchange(o.bump_v, nullptr);
+        bump_left_v = std::exchange(o.bump_left_v, 0);
+        mega_next_v = std::exchange(o.mega_next_v, MEGA_MIN_U64);
+        live_bytes_v = std::exchange(o.live_bytes_v, 0);
+    }
 
+public:
     using VT = value_traits<VALUE, ALLOC>;
     using slot_type = typename VT::slot_type;
 
-    slot_type store_value(const VALUE& val) { return val; }
+    // Construct the slot from args (a VALUE, or VALUE constructor args)
+    template<typename... ARGS>
+    slot_type store_value(ARGS&&... args) {
+        return VALUE(std::forward<ARGS>(args)...);
+    }
     void destroy_value(slot_type&) noexcept {}
 };
 
@@ -534,8 +656,12 @@ struct builder<VALUE, false, ALLOC> {
     using slot_type = typename VT::slot_type;  // VALUE*
 
     static constexpr size_t VAL_U64 = (sizeof(VALUE) + 7) / 8;
+    // Slab blocks are only 8-byte aligned; larger or over-aligned
+    // values go to the allocator
+    static constexpr bool IN_SLAB = VAL_U64 <= FREE_MAX && alignof(VALUE) <= 8;
 
     BASE base_v;
+    slot_type unbuilt_v = nullptr;  // placed block whose constructor threw
 
     builder() = default;
     explicit builder(const ALLOC& a) : base_v(a) {}
@@ -560,37 +686,59 @@ struct builder<VALUE, false, ALLOC> {
     }
 
     const ALLOC& get_allocator() const noexcept { return base_v.get_allocator(); }
+    size_t live_bytes() const noexcept { return base_v.live_bytes(); }
 
     uint64_t* alloc_node(size_t& u64_count, bool pad = true) { return base_v.alloc_node(u64_count, pad); }
+    uint64_t* alloc_node_zeroed(size_t& u64_count, bool pad = true) { return base_v.alloc_node_zeroed(u64_count, pad); }
     void dealloc_node(uint64_t* p, size_t u64_count) noexcept { base_v.dealloc_node(p, u64_count); }
 
-    void set_watches(const uint64_t* a, const uint64_t* b) noexcept { base_v.set_watches(a, b); }
-    void clear_watches() noexcept { base_v.clear_watches(); }
-    bool freed_a() const noexcept { return base_v.freed_a_v; }
-    bool freed_b() const noexcept { return base_v.freed_b_v; }
+    // --- Two-phase store: raw storage first, VALUE built once committed ---
+    // The insert path reserves a block, places the pointer, and constructs
+    // only if the slot was taken, so rejected duplicates never build one.
 
-    slot_type store_value(const VALUE& val) {
-        if constexpr (VAL_U64 <= FREE_MAX) {
+    slot_type reserve_value() {
+        if constexpr (IN_SLAB) {
             size_t sz = VAL_U64;
-            uint64_t* p = base_v.alloc_node(sz, false);
-            std::construct_at(reinterpret_cast<VALUE*>(p), val);
-            return reinterpret_cast<VALUE*>(p);
+            return reinterpret_cast<VALUE*>(base_v.alloc_node(sz, false));
         } else {
             VA va(base_v.get_allocator());
             VALUE* p = std::allocator_traits<VA>::allocate(va, 1);
-            std::construct_at(p, val);
+            base_v.add_live_bytes(sizeof(VALUE));
             return p;
         }
     }
 
-    void destroy_value(slot_type& s) noexcept {
-        std::destroy_at(s);
-        if constexpr (VAL_U64 <= FREE_MAX) {
+    template<typename... ARGS>
+    void construct_value(slot_type s, ARGS&&... args) {
+        std::construct_at(s, std::forward<ARGS>(args)...);
+    }
+
+    // Return a reserved block whose VALUE was never constructed
+    void release_value(slot_type s) noexcept {
+        if constexpr (IN_SLAB) {
             base_v.dealloc_node(reinterpret_cast<uint64_t*>(s), VAL_U64);
         } else {
             VA va(base_v.get_allocator());
             std::allocator_traits<VA>::deallocate(va, s, 1);
+            base_v.sub_live_bytes(sizeof(VALUE));
+        }
+    }
+
+    template<typename... ARGS>
+    slot_type store_value(ARGS&&... args) {
+        slot_type s = reserve_value();
+        try {
+            construct_value(s, std::forward<ARGS>(args)...);
+        } catch (...) {
+            release_value(s);
+            throw;
         }
+        return s;
+    }
+
+    void destroy_value(slot_type& s) noexcept {
+        if (s != unbuilt_v) std::destroy_at(s);
+        release_value(s);
     }
 
     void drain() noexcept {
@@ -598,6 +746,83 @@ struct builder<VALUE, false, ALLOC> {
     }
 };
 
+// ==========================================================================
+// Insert hit policy
+//
+// Insert paths take a HIT functor, called as hit(VALUE&) on the existing
+// value when the key is already present (upsert). no_hit_t compiles out.
+// ==========================================================================
+
+struct no_hit_t {};
+
+template<typename HIT>
+inline constexpr bool HAS_HIT = !std::is_same_v<HIT, no_hit_t>;
+
+// ==========================================================================
+// Subtree aggregates (opt-in)
+//
+// AGG is a commutative monoid over VALUE:
+//   using type = ...;                       trivially copyable, <= 16 bytes
+//   static type identity() noexcept;
+//   static type lift(const VALUE&) noexcept;
+//   static type combine(type, type) noexcept;
+// With an AGG each bitmask keeps, after its descendants count, the fold
+// of every child subtree, so a key range folds in O(depth) plus its two
+// boundary leaves. no_aggregate_t stores nothing and compiles out.
+// ==========================================================================
+
+struct no_aggregate_t {
+    using type = no_aggregate_t;
+    static type identity() noexcept { return {}; }
+    template<typename V>
+    static type lift(const V&) noexcept { return {}; }
+    static type combine(type, type) noexcept { return {}; }
+};
+
+template<typename VALUE>
+struct sum_aggregate_t {
+    using type = VALUE;
+    static type identity() noexcept { return VALUE{}; }
+    static type lift(const VALUE& v) noexcept { return v; }
+    static type combine(type a, type b) noexcept { return a + b; }
+};
+
+template<typename VALUE>
+struct min_aggregate_t {
+    using type = VALUE;
+    static type identity() noexcept { return std::numeric_limits<VALUE>::max(); }
+    static type lift(const VALUE& v) noexcept { return v; }
+    static type combine(type a, type b) noexcept { return b < a ? b : a; }
+};
+
+template<typename VALUE>
+struct max_aggregate_t {
+    using type = VALUE;
+    static type identity() noexcept { return std::numeric_limits<VALUE>::lowest(); }
+    static type lift(const VALUE& v) noexcept { return v; }
+    static type combine(type a, type b) noexcept { return a < b ? b : a; }
+};
+
+template<typename AGG>
+inline constexpr bool HAS_AGG = !std::is_same_v<AGG, no_aggregate_t>;
+
+// u64s per child aggregate in a bitmask node
+template<typename AGG>
+inline constexpr size_t agg_u64 =
+    HAS_AGG<AGG> ? (sizeof(typename AGG::type) + 7) / 8 : 0;
+
+template<typename AGG>
+inline typename AGG::type agg_load(const uint64_t* p) noexcept {
+    typename AGG::type a;
+    std::memcpy(&a, p, sizeof(a));
+    return a;
+}
+
+template<typename AGG>
+inline void agg_store(uint64_t* p, const typename AGG::type& a) noexcept {
+    std::memcpy(p, &a, sizeof(a));
+}
+
 // ==========================================================================
 // Result types
 // ==========================================================================
@@ -606,6 +831,7 @@ struct insert_result_t {
     uint64_t tagged_ptr;    // tagged pointer (LEAF_BIT for leaf, raw for bitmask)
     bool inserted;
     bool needs_split;
+    uint64_t* leaf = nullptr;  // leaf now holding ik (unset when !INSERT misses)
 };
 
 struct erase_result_t {
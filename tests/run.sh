@@ -0,0 +1,18 @@
+#!/bin/sh
+# Build and run every tests/test_*.cpp with ASan/UBSan.
+#   tests/run.sh            (CXX overrides the compiler)
+#   SAN=thread tests/run.sh (ThreadSanitizer instead)
+set -e
+cd "$(dirname "$0")"
+CXX=${CXX:-g++}
+OUT=${OUT:-/tmp/kntrie_tests}
+SAN=${SAN:-address,undefined}
+mkdir -p "$OUT"
+for src in test_*.cpp; do
+    bin="$OUT/${src%.cpp}"
+    $CXX -std=c++20 -O1 -g -I.. -fsanitize=$SAN \
+         -fno-sanitize-recover=all -pthread "$src" -o "$bin"
+    echo "== ${src%.cpp}"
+    "$bin"
+done
+echo "all tests passed"
@@ -0,0 +1,240 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// find, operator[] and try_emplace against std::map, over the draw()
+// key mixes of test_util.hpp.
+
+template<typename K, typename V, typename MK>
+static void subscript_matches_map(MK make) {
+    std::mt19937_64 rng(7);
+    for (int mode = 0; mode < 3; ++mode) {
+        kntrie<K, V> t;
+        std::map<K, V> m;
+        for (int i = 0; i < 20000; ++i) {
+            K k = draw<K>(rng, mode);
+            V& v = t[k];
+            CHECK(v == m[k]);
+            v = make(i);
+            m[k] = v;
+            CHECK(*t.find_value(k) == m[k]);
+        }
+        CHECK(t.size() == m.size());
+        auto it = t.begin();
+        for (auto& [k, v] : m) {
+            CHECK(it.key() == k && it.value() == v);
+            ++it;
+        }
+    }
+}
+
+// Writes through at() must show up in iteration as well as find.
+template<typename K>
+static void at_writes_seen_everywhere() {
+    std::mt19937_64 rng(5);
+    for (int mode = 0; mode < 3; ++mode) {
+        kntrie<K, uint32_t> t;
+        std::map<K, uint32_t> m;
+        for (int i = 0; i < 3000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, 0u);
+            m.emplace(k, 0u);
+        }
+        std::vector<K> ks;
+        for (auto& kv : m) ks.push_back(kv.first);
+        for (int i = 0; i < 20000; ++i) {
+            K k = ks[rng() % ks.size()];
+            t.at(k) = m[k] = uint32_t(i);
+        }
+        auto it = t.begin();
+        for (auto& [k, v] : m) {
+            CHECK(it.key() == k && it.value() == v && *t.find_value(k) == v);
+            ++it;
+        }
+    }
+}
+
+// bool values are packed bits: no references to hand out
+template<typename T>
+concept writable_refs = requires(T& t) { t[0] = true; t.at(0) = true; };
+static_assert(writable_refs<kntrie<uint64_t, int>>);
+static_assert(!writable_refs<kntrie<uint64_t, bool>>);
+
+template<typename K>
+static void try_emplace_iterator() {
+    std::mt19937_64 rng(11);
+    for (int mode = 0; mode < 3; ++mode) {
+        kntrie<K, uint64_t> t;
+        std::map<K, uint64_t> m;
+        for (int i = 0; i < 20000; ++i) {
+            K k = draw<K>(rng, mode);
+            auto [it, ins] = t.try_emplace(k, uint64_t(i));
+            auto [mit, mins] = m.try_emplace(k, uint64_t(i));
+            CHECK(ins == mins);
+            CHECK(it != t.end() && it.key() == k && it.value() == mit->second);
+            auto nx = std::next(mit);
+            ++it;
+            CHECK(nx == m.end() ? it == t.end() : it.key() == nx->first);
+        }
+    }
+}
+
+// find hits land on the key, misses are end(); keys whose low bytes
+// are zero take the leaf's first entry
+template<typename K>
+static void find_matches_map() {
+    std::mt19937_64 rng(13);
+    for (int mode = 0; mode < 3; ++mode) {
+        kntrie<K, int> t;
+        std::map<K, int> m;
+        for (int i = 0; i < 5000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, i);
+            m.emplace(k, i);
+        }
+        for (int i = 0; i < 40000; ++i) {
+            K k = i % 2 ? draw<K>(rng, mode) : static_cast<K>(rng() & ~uint64_t(0xFF));
+            auto it = t.find(k);
+            auto mit = m.find(k);
+            if (mit == m.end()) {
+                CHECK(it == t.end());
+                continue;
+            }
+            CHECK(it != t.end() && it.key() == k && it.value() == mit->second);
+            ++mit;
+            ++it;
+            CHECK(mit == m.end() ? it == t.end() : it.key() == mit->first);
+        }
+    }
+}
+
+// find_batch gives find_value's answer for every key, hit or miss, in
+// batches that end before, on and after a lookup group boundary
+template<typename K>
+static void find_batch_matches_map() {
+    constexpr size_t G = kntrie_ops<int, std::allocator<uint64_t>, 64>::FIND_GROUP;
+    std::mt19937_64 rng(31);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, int> t;
+        std::map<K, int> m;
+        std::vector<K> have;
+        for (int fill : {0, 1, 6000}) {
+            for (int i = 0; i < fill; ++i) {
+                K k = draw<K>(rng, mode);
+                t.insert(k, i);
+                if (m.emplace(k, i).second) have.push_back(k);
+            }
+            for (size_t n : {size_t(0), size_t(1), G - 1, G, G + 1, size_t(20000)}) {
+                std::vector<K> ks(n);
+                for (auto& k : ks)
+                    k = rng() % 2 && !have.empty() ? have[rng() % have.size()]
+                      : draw<K>(rng, rng() % 2 ? mode : 0);
+                std::vector<const int*> out(n + 1, nullptr);
+                const int guard = 0;
+                out[n] = &guard;
+                t.find_batch(ks.data(), n, out.data());
+                for (size_t i = 0; i < n; ++i) {
+                    auto mit = m.find(ks[i]);
+                    CHECK(mit == m.end() ? out[i] == nullptr
+                                         : out[i] && *out[i] == mit->second);
+                }
+                CHECK(out[n] == &guard);
+            }
+        }
+    }
+}
+
+// find_co and lower_bound_co through interleave_run match std::map at
+// every depth, including 0 (run as 1), more than n, and more than
+// MAX_INTERLEAVE (clamped). With n above depth, finished slots are
+// refilled; at most min(depth, n) lookups are ever in flight.
+template<typename K>
+static void coroutines_match_map() {
+    std::mt19937_64 rng(37);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, int> t;
+        std::map<K, int> m;
+        for (int i = 0; i < 6000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, i);
+            m.emplace(k, i);
+        }
+        for (size_t n : {size_t(0), size_t(5), size_t(3000)}) {
+            std::vector<K> ks(n);
+            for (auto& k : ks) k = draw<K>(rng, rng() % 4 ? mode : 0);
+            for (size_t depth : {0, 1, 8, 64, 100}) {
+                size_t cap = std::min(std::max<size_t>(depth, 1), MAX_INTERLEAVE);
+                const int unset = 0;
+                std::vector<const int*> out(n, &unset);
+                size_t made = 0, peak = 0;
+                interleave_run(n, [&](size_t i) {
+                    size_t written = 0;
+                    for (size_t j = 0; j < made; ++j) written += out[j] != &unset;
+                    CHECK(i == made);
+                    peak = std::max(peak, ++made - written);
+                    return t.find_co(ks[i], out[i]);
+                }, depth);
+                CHECK(made == n && peak == std::min(cap, n));
+                for (size_t i = 0; i < n; ++i) {
+                    auto mit = m.find(ks[i]);
+                    CHECK(mit == m.end() ? out[i] == nullptr
+                                         : out[i] && *out[i] == mit->second);
+                }
+
+                std::vector<typename kntrie<K, int>::const_iterator> its(n);
+                interleave_run(n, [&](size_t i) {
+                    return t.lower_bound_co(ks[i], its[i]);
+                }, depth);
+                for (size_t i = 0; i < n; ++i) {
+                    auto mit = m.lower_bound(ks[i]);
+                    CHECK(mit == m.end() ? its[i] == t.end()
+                                         : its[i] != t.end() && its[i].key() == mit->first);
+                }
+            }
+        }
+    }
+}
+
+// A miss under a bitmask whose children are bitmap leaves lands on the
+// sentinel and is looked up as a bitmap leaf; it must find nothing
+static void misses_above_bitmap_leaves() {
+    kntrie<uint32_t, int> t;
+    for (uint32_t k = 0; k < 65536; ++k)
+        if ((k >> 8) % 2 == 0) t.insert(k, 1);
+    CHECK(t.size() == 32768);
+    for (uint32_t k = 0; k < 65536; ++k)
+        CHECK(t.contains(k) == ((k >> 8) % 2 == 0));
+}
+
+int main() {
+    find_matches_map<uint64_t>();
+    find_matches_map<uint32_t>();
+    find_matches_map<int16_t>();
+    misses_above_bitmap_leaves();
+    find_batch_matches_map<uint64_t>();
+    find_batch_matches_map<uint32_t>();
+    find_batch_matches_map<int16_t>();
+    coroutines_match_map<uint64_t>();
+    coroutines_match_map<uint32_t>();
+    coroutines_match_map<int16_t>();
+    subscript_matches_map<uint64_t, uint64_t>([](int i) { return uint64_t(i); });
+    subscript_matches_map<uint32_t, uint16_t>([](int i) { return uint16_t(i); });
+    subscript_matches_map<int16_t, uint8_t>([](int i) { return uint8_t(i); });
+    subscript_matches_map<uint64_t, std::string>(
+        [](int i) { return std::string(20, 'v') + std::to_string(i); });
+    at_writes_seen_everywhere<uint64_t>();
+    at_writes_seen_everywhere<uint32_t>();
+    at_writes_seen_everywhere<uint16_t>();
+    try_emplace_iterator<uint64_t>();
+    try_emplace_iterator<uint32_t>();
+    try_emplace_iterator<int16_t>();
+    std::puts("ok");
+}
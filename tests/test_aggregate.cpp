@@ -0,0 +1,119 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// range_aggregate against a fold over std::map, for sum, min and max,
+// through every kind of write that has to keep the bitmask aggs right.
+
+template<typename AGG, typename M, typename K>
+static typename AGG::type fold(const M& m, K lo, K hi) {
+    auto a = AGG::identity();
+    if (lo > hi) return a;
+    for (auto it = m.lower_bound(lo); it != m.end() && it->first <= hi; ++it)
+        a = AGG::combine(a, AGG::lift(it->second));
+    return a;
+}
+
+template<typename AGG, typename T, typename M>
+static void check_ranges(const T& t, const M& m, std::mt19937_64& rng, int mode) {
+    using K = typename M::key_type;
+    const K kmin = std::numeric_limits<K>::min(), kmax = std::numeric_limits<K>::max();
+    CHECK(t.range_aggregate(kmin, kmax) == fold<AGG>(m, kmin, kmax));
+
+    std::vector<K> qs = {kmin, kmax};
+    if (!m.empty()) {
+        K lo = m.begin()->first, hi = m.rbegin()->first;
+        qs.insert(qs.end(), {lo, hi, static_cast<K>(lo - 1), static_cast<K>(hi + 1)});
+    }
+    for (int i = 0; i < 200; ++i) {
+        qs.push_back(draw<K>(rng, mode));
+        qs.push_back(draw<K>(rng, 0));  // outside a mode-3 root prefix
+    }
+    for (int r = 0; r < 400; ++r) {
+        K lo = qs[rng() % qs.size()], hi = qs[rng() % qs.size()];
+        if (r % 7 == 0) hi = lo;
+        CHECK(t.range_aggregate(lo, hi) == fold<AGG>(m, lo, hi));
+    }
+}
+
+template<typename K, typename V, typename AGG>
+static void aggregate_matches_map() {
+    using trie_t = kntrie<K, V, std::allocator<uint64_t>, AGG>;
+    std::mt19937_64 rng(53);
+    auto val = [&] { return static_cast<V>(static_cast<int64_t>(rng() % 2001) - 1000); };
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        trie_t t;
+        std::map<K, V> m;
+        check_ranges<AGG>(t, m, rng, mode);
+
+        // Point inserts and assigns
+        for (int i = 0; i < 20000; ++i) {
+            K k = draw<K>(rng, mode);
+            V v = val();
+            if (i % 4) {
+                t.insert(k, v);
+                m.emplace(k, v);
+            } else {
+                t.insert_or_assign(k, v);
+                m[k] = v;
+            }
+        }
+        check_ranges<AGG>(t, m, rng, mode);
+        auto s = t.snapshot();
+        auto before = m;
+
+        // Sorted batches in and out
+        std::vector<K> ks;
+        std::vector<V> vs;
+        for (int i = 0; i < 5000; ++i) ks.push_back(draw<K>(rng, mode));
+        std::sort(ks.begin(), ks.end());
+        for (K k : ks) {
+            vs.push_back(val());
+            m.emplace(k, vs.back());
+        }
+        t.insert_sorted_batch(ks.data(), vs.data(), ks.size());
+        check_ranges<AGG>(t, m, rng, mode);
+        for (auto& k : ks) k = draw<K>(rng, mode);
+        std::sort(ks.begin(), ks.end());
+        for (K k : ks) m.erase(k);
+        t.erase_sorted_batch(ks.data(), ks.size());
+        check_ranges<AGG>(t, m, rng, mode);
+
+        // Point erases and a range erase
+        for (int i = 0; i < 3000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.erase(k);
+            m.erase(k);
+        }
+        if (m.size() > 10) {
+            K lo = std::next(m.begin(), m.size() / 4)->first;
+            K hi = std::next(m.begin(), m.size() / 2)->first;
+            t.erase(t.lower_bound(lo), t.lower_bound(hi));
+            m.erase(m.lower_bound(lo), m.lower_bound(hi));
+        }
+        check_ranges<AGG>(t, m, rng, mode);
+        check_ranges<AGG>(s, before, rng, mode);
+
+        // Bulk build
+        trie_t b;
+        b.assign_sorted(before.begin(), before.end());
+        check_ranges<AGG>(b, before, rng, mode);
+    }
+}
+
+int main() {
+    aggregate_matches_map<uint64_t, int64_t, sum_aggregate_t<int64_t>>();
+    aggregate_matches_map<uint32_t, int32_t, min_aggregate_t<int32_t>>();
+    aggregate_matches_map<int16_t, int64_t, max_aggregate_t<int64_t>>();
+    aggregate_matches_map<int64_t, int16_t, max_aggregate_t<int16_t>>();
+    std::puts("ok");
+}
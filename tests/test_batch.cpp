@@ -0,0 +1,195 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// Sorted batch insert and erase against std::map.
+
+template<typename T, typename M>
+static void check_same(const T& t, const M& m) {
+    CHECK(t.size() == m.size());
+    auto it = t.begin();
+    for (auto& [k, v] : m) {
+        CHECK(it != t.end() && it.key() == k && it.value() == v);
+        ++it;
+    }
+    CHECK(it == t.end());
+}
+
+// n draws, sorted, duplicates kept
+template<typename K>
+static std::vector<K> sorted_keys(std::mt19937_64& rng, int mode, size_t n) {
+    std::vector<K> ks(n);
+    for (auto& k : ks) k = draw<K>(rng, mode);
+    std::sort(ks.begin(), ks.end());
+    return ks;
+}
+
+// Batches into an empty trie, then into one holding earlier batches:
+// existing keys keep their values, duplicates keep the first
+template<typename K, typename V, typename MK>
+static void insert_batch_matches_map(MK make) {
+    std::mt19937_64 rng(17);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, V> t;
+        std::map<K, V> m;
+        CHECK(t.insert_sorted_batch(nullptr, nullptr, 0) == 0);
+        // The last batch is sparse: under mode 3 it leaves the root prefix
+        for (size_t n : {1, 7, 300, 5000, 20000, 3000}) {
+            auto ks = sorted_keys<K>(rng, n == 3000 ? 0 : mode, n);
+            std::vector<V> vs;
+            for (size_t i = 0; i < n; ++i) vs.push_back(make(rng()));
+            size_t want = 0;
+            for (size_t i = 0; i < n; ++i) want += m.emplace(ks[i], vs[i]).second;
+            CHECK(t.insert_sorted_batch(ks.data(), vs.data(), n) == want);
+            check_same(t, m);
+        }
+    }
+}
+
+// A batch under a snapshot leaves the snapshot as it was
+static void insert_batch_under_snapshot() {
+    std::mt19937_64 rng(19);
+    kntrie<uint64_t, std::string> t;
+    std::map<uint64_t, std::string> m;
+    for (int i = 0; i < 8000; ++i) {
+        uint64_t k = draw<uint64_t>(rng, 2);
+        t.insert(k, "a");
+        m.emplace(k, "a");
+    }
+    auto s = t.snapshot();
+    auto before = m;
+    auto ks = sorted_keys<uint64_t>(rng, 2, 6000);
+    std::vector<std::string> vs(ks.size(), "b");
+    size_t want = 0;
+    for (auto k : ks) want += m.emplace(k, "b").second;
+    CHECK(t.insert_sorted_batch(ks.data(), vs.data(), ks.size()) == want);
+    check_same(t, m);
+    check_same(s, before);
+}
+
+// Batches reaching a bitmask chain with keys on and off it: the keys on
+// it go down the chain together, those off it split the chain
+template<typename V, typename MK>
+static void insert_batch_splits_chain(MK make) {
+    // Under top byte 01 every key shares bytes 02 03 04 05, so the
+    // split subtree starts with a chain of them
+    auto key = [](uint64_t hi, uint64_t lo) { return hi << 24 | lo; };
+    for (auto off : {std::vector<uint64_t>{0x0102030400, 0x0102030406},
+                     std::vector<uint64_t>{0x0101ffffff, 0x0103000000},
+                     std::vector<uint64_t>{0x0102030300},
+                     std::vector<uint64_t>{0x0102040000}}) {
+        for (bool on : {true, false}) {
+            kntrie<uint64_t, V> t;
+            std::map<uint64_t, V> m;
+            for (uint64_t i = 0; i < 6000; ++i) {
+                t.insert(key(0x0102030405, i * 7), make(i));
+                m.emplace(key(0x0102030405, i * 7), make(i));
+            }
+            for (uint64_t hi : {0x0002030405ull, 0x0202030405ull}) {
+                t.insert(key(hi, 1), make(1));
+                m.emplace(key(hi, 1), make(1));
+            }
+            std::vector<uint64_t> ks;
+            for (uint64_t hi : off)
+                for (uint64_t i = 0; i < 50; ++i) ks.push_back(key(hi, i * 3));
+            if (on)
+                for (uint64_t i = 0; i < 3000; ++i) ks.push_back(key(0x0102030405, i * 5));
+            std::sort(ks.begin(), ks.end());
+            std::vector<V> vs;
+            for (size_t i = 0; i < ks.size(); ++i) vs.push_back(make(i + 100000));
+            size_t want = 0;
+            for (size_t i = 0; i < ks.size(); ++i) want += m.emplace(ks[i], vs[i]).second;
+            CHECK(t.insert_sorted_batch(ks.data(), vs.data(), ks.size()) == want);
+            check_same(t, m);
+        }
+    }
+}
+
+// Erase batches mixing present keys, absent keys and duplicates, until
+// the trie is empty; then it takes inserts again
+template<typename K>
+static void erase_batch_matches_map() {
+    std::mt19937_64 rng(23);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, uint64_t> t;
+        std::map<K, uint64_t> m;
+        CHECK(t.erase_sorted_batch(nullptr, 0) == 0);
+        K one = draw<K>(rng, mode);
+        CHECK(t.erase_sorted_batch(&one, 1) == 0);
+
+        for (int i = 0; i < 30000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, uint64_t(i));
+            m.emplace(k, uint64_t(i));
+        }
+        for (size_t n : {1, 9, 400, 6000}) {
+            std::vector<K> have, ks;
+            for (auto& kv : m) have.push_back(kv.first);
+            for (size_t i = 0; i < n; ++i)
+                ks.push_back(i % 3 ? have[rng() % have.size()] : draw<K>(rng, mode));
+            std::sort(ks.begin(), ks.end());
+            size_t want = 0;
+            for (K k : ks) want += m.erase(k);
+            CHECK(t.erase_sorted_batch(ks.data(), ks.size()) == want);
+            check_same(t, m);
+        }
+        // Sparse keys miss a mode-3 trie's root prefix entirely
+        auto miss = sorted_keys<K>(rng, 0, 2000);
+        size_t want = 0;
+        for (K k : miss) want += m.erase(k);
+        CHECK(t.erase_sorted_batch(miss.data(), miss.size()) == want);
+        check_same(t, m);
+
+        std::vector<K> all;
+        for (auto& kv : m) all.push_back(kv.first);
+        CHECK(t.erase_sorted_batch(all.data(), all.size()) == all.size());
+        CHECK(t.empty() && t.begin() == t.end());
+        t.insert(one, 1);
+        CHECK(t.size() == 1 && *t.find_value(one) == 1);
+    }
+}
+
+// An erase batch under a snapshot leaves the snapshot as it was
+static void erase_batch_under_snapshot() {
+    std::mt19937_64 rng(29);
+    kntrie<uint64_t, std::string> t;
+    std::map<uint64_t, std::string> m;
+    for (int i = 0; i < 20000; ++i) {
+        uint64_t k = draw<uint64_t>(rng, 2);
+        t.insert(k, std::to_string(k));
+        m.emplace(k, std::to_string(k));
+    }
+    auto s = t.snapshot();
+    auto before = m;
+    std::vector<uint64_t> ks;
+    for (auto& kv : m)
+        if (rng() % 4) ks.push_back(kv.first);
+    for (auto k : ks) m.erase(k);
+    CHECK(t.erase_sorted_batch(ks.data(), ks.size()) == ks.size());
+    check_same(t, m);
+    check_same(s, before);
+}
+
+int main() {
+    insert_batch_matches_map<uint64_t, uint64_t>([](uint64_t r) { return r; });
+    insert_batch_matches_map<uint32_t, uint16_t>([](uint64_t r) { return uint16_t(r); });
+    insert_batch_matches_map<int16_t, int>([](uint64_t r) { return int(r); });
+    insert_batch_matches_map<int64_t, std::string>(
+        [](uint64_t r) { return std::to_string(r); });
+    insert_batch_under_snapshot();
+    insert_batch_splits_chain<uint64_t>([](uint64_t i) { return i; });
+    insert_batch_splits_chain<std::string>([](uint64_t i) { return std::to_string(i); });
+    erase_batch_matches_map<uint64_t>();
+    erase_batch_matches_map<uint32_t>();
+    erase_batch_matches_map<int16_t>();
+    erase_batch_under_snapshot();
+    std::puts("ok");
+}
@@ -0,0 +1,124 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// kntrie_concurrent: what readers see of the writer's work, and when
+// retired snapshots are freed.
+
+using conc_t = kntrie_concurrent<uint64_t, std::string>;
+
+static std::string val(uint64_t k) { return "v" + std::to_string(k); }
+
+// Every write is visible to the next read(); a guard keeps the snapshot
+// it pinned, whatever is written after
+static void writes_publish() {
+    conc_t c;
+    CHECK(c.read()->size() == 0);
+    auto before = c.read();
+    for (uint64_t k = 0; k < 3000; ++k) {
+        c.insert(k * 11, val(k));
+        CHECK(c.read()->size() == k + 1);
+    }
+    CHECK(*c.read()->find_value(2999 * 11) == val(2999));
+    c.insert_or_assign(11, std::string("x"));
+    c.erase(22);
+    auto g = c.read();
+    CHECK(*g->find_value(11) == "x" && !g->contains(22));
+    CHECK(before->size() == 0);
+
+    c.update([](auto& t) {
+        for (uint64_t k = 0; k < 100; ++k) t.erase(k * 11);
+    });
+    CHECK(c.read()->size() == 2900);
+    CHECK(g->size() == 2999 && *g->find_value(11) == "x");
+}
+
+// A write that throws publishes what it did before throwing
+static void throwing_update_publishes() {
+    conc_t c;
+    try {
+        c.update([](auto& t) {
+            t.insert(1, std::string("a"));
+            throw std::runtime_error("x");
+        });
+    } catch (const std::runtime_error&) {}
+    CHECK(c.read()->contains(1));
+}
+
+// Readers run beside the writer. The writer inserts keys in order and
+// then erases them in order, so every snapshot holds one contiguous run
+// of keys, each with its own value.
+static void readers_see_whole_writes() {
+    conc_t c;
+    constexpr uint64_t N = 4000;
+    std::atomic<bool> done{false}, failed{false};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done) {
+                auto g = c.read();
+                uint64_t n = g->size(), prev = 0, seen = 0;
+                for (auto it = g->begin(); it != g->end(); ++it, ++seen) {
+                    if (seen > 0 && it.key() != prev + 1) failed = true;
+                    if (it.value() != val(it.key())) failed = true;
+                    prev = it.key();
+                }
+                if (seen != n) failed = true;
+            }
+        });
+    }
+    for (uint64_t k = 0; k < N; ++k) c.insert(k, val(k));
+    for (uint64_t k = 0; k < N; ++k) c.erase(k);
+    done = true;
+    for (auto& r : readers) r.join();
+    CHECK(!failed);
+    CHECK(c.read()->size() == 0);
+}
+
+// Retired snapshots wait for the guards that might still be in them
+static void reclaim_waits_for_guards() {
+    conc_t c;
+    c.insert(1, val(1));
+    CHECK(c.reclaim() == 0);
+
+    std::vector<uint64_t> keys;
+    {
+        auto g = c.read();
+        for (uint64_t k = 2; k < 50; ++k) c.insert(k, val(k));
+        CHECK(c.reclaim() == 48);
+        CHECK(g->size() == 1 && *g->find_value(1) == val(1));
+    }
+    c.insert(50, val(50));
+    CHECK(c.reclaim() == 0);
+
+    // A guard taken on another thread holds back the same way
+    std::atomic<int> stage{0};
+    std::thread reader([&] {
+        auto g = c.read();
+        stage = 1;
+        while (stage != 2) std::this_thread::yield();
+        CHECK(g->size() == 50 && !g->contains(51));
+    });
+    while (stage != 1) std::this_thread::yield();
+    c.insert(51, val(51));
+    CHECK(c.reclaim() == 1);
+    stage = 2;
+    reader.join();
+    CHECK(c.reclaim() == 0);
+}
+
+int main() {
+    writes_publish();
+    throwing_update_publishes();
+    readers_see_whole_writes();
+    reclaim_waits_for_guards();
+    std::puts("ok");
+}
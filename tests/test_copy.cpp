@@ -0,0 +1,74 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// Copy construction and clone() for inline, out-of-line and bool
+// values: copies match the source at the time of the copy, keep that
+// content while the source changes, and outlive it.
+
+template<typename T, typename M>
+static void check_same(const T& t, const M& m) {
+    CHECK(t.size() == m.size());
+    auto it = t.begin();
+    for (auto& [k, v] : m) {
+        CHECK(it != t.end() && it.key() == k && it.value() == v);
+        ++it;
+    }
+    CHECK(it == t.end());
+}
+
+template<typename K, typename V, typename MK>
+static void copies_are_independent(MK make) {
+    std::mt19937_64 rng(41);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        for (int n : {0, 1, 300, 20000}) {
+            auto* t = new kntrie<K, V>;
+            std::map<K, V> m;
+            std::vector<K> have;
+            for (int i = 0; i < n; ++i) {
+                K k = draw<K>(rng, mode);
+                t->insert(k, make(i));
+                if (m.emplace(k, make(i)).second) have.push_back(k);
+            }
+
+            kntrie<K, V> copy(*t);
+            kntrie<K, V> cloned = t->clone();
+            check_same(copy, m);
+            check_same(cloned, m);
+
+            // Change the source: erase half, overwrite a quarter, add new keys
+            for (size_t i = 0; i < have.size(); i += 2) t->erase(have[i]);
+            for (size_t i = 1; i < have.size(); i += 4) t->insert_or_assign(have[i], make(-1));
+            for (int i = 0; i < 500; ++i) t->insert(draw<K>(rng, mode), make(-2));
+            check_same(copy, m);
+            check_same(cloned, m);
+
+            // Copies outlive the source and still take writes
+            delete t;
+            check_same(copy, m);
+            check_same(cloned, m);
+            K k = draw<K>(rng, mode);
+            copy.insert_or_assign(k, make(7));
+            m.insert_or_assign(k, make(7));
+            check_same(copy, m);
+        }
+    }
+}
+
+int main() {
+    copies_are_independent<uint64_t, uint64_t>([](int i) { return uint64_t(i); });
+    copies_are_independent<uint32_t, uint16_t>([](int i) { return uint16_t(i); });
+    copies_are_independent<uint64_t, std::string>(
+        [](int i) { return std::string(24, 'c') + std::to_string(i); });
+    copies_are_independent<int16_t, std::string>([](int i) { return std::to_string(i); });
+    copies_are_independent<uint64_t, bool>([](int i) { return i % 3 == 0; });
+    copies_are_independent<uint32_t, bool>([](int i) { return i % 2 != 0; });
+    std::puts("ok");
+}
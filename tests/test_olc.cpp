@@ -0,0 +1,99 @@
+#include "kntrie_olc.hpp"
+#include "test_util.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// kntrie_olc under concurrent writers. Writers own disjoint key sets,
+// so each checks its own keys against a private model while the others
+// add and remove siblings in the same bitmasks. Build with SAN=thread
+// (see run.sh) to have ThreadSanitizer watch the lock words.
+
+using trie_t = kntrie_olc<uint64_t, uint64_t>;
+
+static constexpr unsigned WRITERS = 4;
+
+// Keys of writer w. Narrow sets give one leaf per key, so most writes
+// add or drop a child of a bitmask every writer shares; wide sets fill
+// leaves past LEAF_MAX so they split while others write beside them.
+static uint64_t key_of(unsigned w, uint64_t i, bool narrow) {
+    uint64_t n = i * WRITERS + w;
+    return narrow ? n << 16 : n * 257;
+}
+
+static void writers(size_t keys, int rounds, bool narrow) {
+    trie_t t;
+    std::atomic<bool> failed{false};
+    std::atomic<std::ptrdiff_t> live{0};
+    std::vector<std::thread> th;
+    for (unsigned w = 0; w < WRITERS; ++w) {
+        th.emplace_back([&, w] {
+            std::mt19937_64 rng(w);
+            std::vector<bool> have(keys, false);
+            for (int r = 0; r < rounds; ++r) {
+                uint64_t i = rng() % keys;
+                uint64_t k = key_of(w, i, narrow);
+                if (rng() % 3) {
+                    if (t.insert(k, k + w).second == have[i]) failed = true;
+                    if (!have[i]) live++;
+                    have[i] = true;
+                } else {
+                    if ((t.erase(k) == 1) != have[i]) failed = true;
+                    if (have[i]) live--;
+                    have[i] = false;
+                }
+                auto v = t.get(k);
+                if (v.has_value() != have[i] || (v && *v != k + w)) failed = true;
+            }
+            for (uint64_t i = 0; i < keys; ++i)
+                if (t.contains(key_of(w, i, narrow)) != have[i]) failed = true;
+        });
+    }
+    for (auto& x : th) x.join();
+    CHECK(!failed);
+    CHECK(t.size() == static_cast<size_t>(live.load()));
+}
+
+// Lookups run beside the writers; keys nobody writes never appear, and
+// a key one writer keeps present is always found
+static void readers_beside_writers() {
+    trie_t t;
+    for (uint64_t i = 0; i < 64; ++i) t.insert(i << 16 | 1, i);
+    std::atomic<bool> done{false}, failed{false};
+    std::thread reader([&] {
+        while (!done) {
+            for (uint64_t i = 0; i < 64; ++i) {
+                auto v = t.get(i << 16 | 1);
+                if (!v || *v != i) failed = true;
+                if (t.contains(i << 16 | 2)) failed = true;
+            }
+        }
+    });
+    std::vector<std::thread> th;
+    for (unsigned w = 0; w < WRITERS; ++w) {
+        th.emplace_back([&, w] {
+            for (int r = 0; r < 2000; ++r) {
+                uint64_t k = static_cast<uint64_t>(r % 64 * WRITERS + w) << 12;
+                t.insert(k, r);
+                t.erase(k);
+            }
+        });
+    }
+    for (auto& x : th) x.join();
+    done = true;
+    reader.join();
+    CHECK(!failed);
+    CHECK(t.size() == 64);
+}
+
+int main() {
+    writers(64, 20000, true);
+    writers(2000, 20000, false);
+    readers_beside_writers();
+    std::puts("ok");
+}
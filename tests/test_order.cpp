@@ -0,0 +1,229 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// Order statistics, range counts and sampling against a sorted vector
+// of the keys.
+
+template<typename K>
+static size_t rank_of(const std::vector<K>& ks, K k) {
+    return std::lower_bound(ks.begin(), ks.end(), k) - ks.begin();
+}
+
+// Query keys: every present key's neighbours, fresh draws from the
+// mix, sparse draws (outside a mode-3 root prefix) and the extremes
+template<typename K>
+static std::vector<K> probes(std::mt19937_64& rng, int mode, const std::vector<K>& ks) {
+    std::vector<K> out = {std::numeric_limits<K>::min(), std::numeric_limits<K>::max()};
+    for (size_t i = 0; i < ks.size(); i += 1 + ks.size() / 500) {
+        out.push_back(ks[i]);
+        out.push_back(static_cast<K>(ks[i] - 1));
+        out.push_back(static_cast<K>(ks[i] + 1));
+    }
+    for (int i = 0; i < 300; ++i) {
+        out.push_back(draw<K>(rng, mode));
+        out.push_back(draw<K>(rng, 0));
+    }
+    return out;
+}
+
+template<typename T, typename K>
+static void check_rank_select(const T& t, const std::vector<K>& ks,
+                              const std::vector<K>& qs) {
+    for (K q : qs) CHECK(t.rank(q) == rank_of(ks, q));
+    for (size_t i = 0; i < ks.size(); i += 1 + ks.size() / 2000)
+        CHECK(t.select(i).key() == ks[i]);
+    if (!ks.empty()) CHECK(t.select(ks.size() - 1).key() == ks.back());
+    CHECK(t.select(ks.size()) == t.end());
+    CHECK(t.select(std::numeric_limits<size_t>::max()) == t.end());
+}
+
+// advance(n) from a selected entry lands on entry i + n, or end()
+// past the last; from end() a negative n counts back from the last
+template<typename T, typename K>
+static void check_advance(const T& t, const std::vector<K>& ks, std::mt19937_64& rng) {
+    long n = static_cast<long>(ks.size());
+    CHECK(t.begin().advance(n) == t.end());
+    CHECK(t.begin().advance(n + 7) == t.end());
+    CHECK(t.end().advance(3) == t.end());
+    if (n == 0) return;
+    CHECK(t.end().advance(-1).key() == ks.back());
+    CHECK(t.end().advance(-n).key() == ks.front());
+    for (int r = 0; r < 500; ++r) {
+        long i = static_cast<long>(rng() % n);
+        long d = static_cast<long>(rng() % (2 * n + 1)) - n;
+        if (r % 4 == 0) d = static_cast<long>(rng() % 5) - 2;
+        auto it = t.select(i);
+        it.advance(d);
+        if (i + d >= n) CHECK(it == t.end());
+        else if (i + d >= 0) CHECK(it != t.end() && it.key() == ks[i + d]);
+    }
+}
+
+template<typename K>
+static void rank_select_advance() {
+    std::mt19937_64 rng(31);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, int> t;
+        std::map<K, int> m;
+        std::vector<K> none;
+        check_rank_select(t, none, probes(rng, mode, none));
+        check_advance(t, none, rng);
+
+        for (int i = 0; i < 30000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, i);
+            m.emplace(k, i);
+        }
+        std::vector<K> ks;
+        for (auto& kv : m) ks.push_back(kv.first);
+        auto qs = probes(rng, mode, ks);
+        check_rank_select(t, ks, qs);
+        check_advance(t, ks, rng);
+
+        // Counts stay right through erases, and in a snapshot
+        auto s = t.snapshot();
+        std::vector<K> kept;
+        for (K k : ks) {
+            if (rng() % 3) kept.push_back(k);
+            else t.erase(k);
+        }
+        check_rank_select(t, kept, qs);
+        check_advance(t, kept, rng);
+        check_rank_select(s, ks, qs);
+    }
+}
+
+// count_range is exact; estimate_range errs only inside the two
+// boundary leaves, so by at most 2 * COMPACT_MAX. Both are 0 for
+// lo > hi and for ranges outside a prefixed root, and whole-trie
+// ranges are exact either way.
+template<typename K>
+static void range_counts() {
+    std::mt19937_64 rng(37);
+    const K kmin = std::numeric_limits<K>::min(), kmax = std::numeric_limits<K>::max();
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, int> t;
+        CHECK(t.count_range(kmin, kmax) == 0 && t.estimate_range(kmin, kmax) == 0);
+
+        std::map<K, int> m;
+        for (int i = 0; i < 30000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, i);
+            m.emplace(k, i);
+        }
+        std::vector<K> ks;
+        for (auto& kv : m) ks.push_back(kv.first);
+        CHECK(t.count_range(kmin, kmax) == ks.size());
+        CHECK(t.estimate_range(kmin, kmax) == ks.size());
+        CHECK(t.estimate_range(ks.front(), ks.back()) == ks.size());
+
+        auto qs = probes(rng, mode, ks);
+        for (int r = 0; r < 3000; ++r) {
+            K lo = qs[rng() % qs.size()], hi = qs[rng() % qs.size()];
+            if (r % 5 == 0) hi = lo;
+            size_t want = lo > hi ? 0
+                : std::upper_bound(ks.begin(), ks.end(), hi) -
+                  std::lower_bound(ks.begin(), ks.end(), lo);
+            CHECK(t.count_range(lo, hi) == want);
+            size_t est = t.estimate_range(lo, hi);
+            if (lo > hi) CHECK(est == 0);
+            CHECK(est <= want + 2 * COMPACT_MAX && want <= est + 2 * COMPACT_MAX);
+        }
+        if (mode == 3) {
+            K below = static_cast<K>(ks.front() - 1), above = static_cast<K>(ks.back() + 1);
+            K pfx_lo = static_cast<K>(ks.front() & ~K(0xFF)), top = kmax;
+            CHECK(t.count_range(kmin, below) == 0 && t.estimate_range(kmin, below) == 0);
+            CHECK(t.count_range(above, top) == 0 && t.estimate_range(above, top) == 0);
+            CHECK(t.count_range(pfx_lo, top) == ks.size());
+        }
+    }
+}
+
+// Evenly spread keys: the proportional share of each boundary leaf is
+// within one key of its true count
+static void estimate_on_even_keys() {
+    kntrie<uint32_t, int> t;
+    for (uint32_t k = 0; k < 200000; ++k) t.insert(k * 3, 0);
+    std::mt19937_64 rng(41);
+    for (int r = 0; r < 2000; ++r) {
+        uint32_t lo = rng() % 700000, hi = lo + rng() % 100000;
+        size_t want = t.count_range(lo, hi);
+        size_t est = t.estimate_range(lo, hi);
+        CHECK(est + 2 >= want && est <= want + 2);
+    }
+}
+
+// Every draw is a present entry, and draws fall evenly over the key
+// order (deciles by rank) however unevenly the keys fill the tree
+template<typename K>
+static void sampling() {
+    std::mt19937_64 rng(43);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<K, int> t;
+        CHECK(t.sample(rng) == t.end());
+        CHECK(t.sample_n(rng, 5).empty());
+
+        std::map<K, int> m;
+        for (int i = 0; i < 20000; ++i) {
+            K k = draw<K>(rng, mode);
+            t.insert(k, i);
+            m.emplace(k, i);
+        }
+        auto one = t.sample(rng);
+        CHECK(one != t.end() && m.count(one.key()) && one.value() == m[one.key()]);
+
+        constexpr size_t DRAWS = 100000;
+        size_t deciles[10] = {};
+        auto all = t.sample_n(rng, DRAWS);
+        CHECK(all.size() == DRAWS);
+        for (auto& it : all) {
+            auto mit = m.find(it.key());
+            CHECK(it != t.end() && mit != m.end() && it.value() == mit->second);
+            deciles[t.rank(it.key()) * 10 / m.size()]++;
+        }
+        for (size_t d : deciles)
+            CHECK(d > DRAWS / 10 * 95 / 100 && d < DRAWS / 10 * 105 / 100);
+    }
+}
+
+// Sampling draws with replacement: k past size() still gives k entries
+static void sample_more_than_size() {
+    std::mt19937_64 rng(47);
+    kntrie<uint64_t, int> t;
+    t.insert(5, 1);
+    auto one = t.sample_n(rng, 4);
+    CHECK(one.size() == 4);
+    for (auto& it : one) CHECK(it.key() == 5);
+
+    for (uint64_t k = 0; k < 3; ++k) t.insert(k << 40, 0);
+    size_t seen[4] = {};
+    auto v = t.sample_n(rng, 4000);
+    CHECK(v.size() == 4000);
+    for (auto& it : v) seen[t.rank(it.key())]++;
+    for (size_t s : seen) CHECK(s > 800 && s < 1200);
+    CHECK(t.sample_n(rng, 0).empty());
+}
+
+int main() {
+    rank_select_advance<uint64_t>();
+    rank_select_advance<uint32_t>();
+    rank_select_advance<int16_t>();
+    range_counts<uint64_t>();
+    range_counts<uint32_t>();
+    range_counts<int16_t>();
+    estimate_on_even_keys();
+    sampling<uint64_t>();
+    sampling<uint32_t>();
+    sampling<int16_t>();
+    sample_more_than_size();
+    std::puts("ok");
+}
@@ -0,0 +1,172 @@
+#include "kntrie_sharded.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// kntrie_sharded: concurrent writers on disjoint keys, key order across
+// shards for signed keys, and sorted batches that cross shard bounds.
+// read_all() holds every shard's lock, and ThreadSanitizer tracks at
+// most 64 held locks per thread, so views stay at 32 shards or fewer.
+
+static constexpr unsigned WRITERS = 4;
+
+// Keys of writer w; the odd multiplier spreads them over every shard
+static uint64_t key_of(unsigned w, uint64_t i) {
+    return (i * WRITERS + w) * 0x9E3779B97F4A7C15ull;
+}
+
+static void writers(size_t keys, int rounds) {
+    kntrie_sharded<uint64_t, uint64_t> t;
+    std::atomic<bool> failed{false};
+    std::atomic<std::ptrdiff_t> live{0};
+    std::vector<std::thread> th;
+    for (unsigned w = 0; w < WRITERS; ++w) {
+        th.emplace_back([&, w] {
+            std::mt19937_64 rng(w);
+            std::vector<bool> have(keys, false);
+            for (int r = 0; r < rounds; ++r) {
+                uint64_t i = rng() % keys;
+                uint64_t k = key_of(w, i);
+                if (rng() % 3) {
+                    if (t.insert(k, k + w).second == have[i]) failed = true;
+                    if (!have[i]) live++;
+                    have[i] = true;
+                } else {
+                    if ((t.erase(k) == 1) != have[i]) failed = true;
+                    if (have[i]) live--;
+                    have[i] = false;
+                }
+                auto v = t.get(k);
+                if (v.has_value() != have[i] || (v && *v != k + w)) failed = true;
+            }
+            for (uint64_t i = 0; i < keys; ++i)
+                if (t.contains(key_of(w, i)) != have[i]) failed = true;
+        });
+    }
+    for (auto& x : th) x.join();
+    CHECK(!failed);
+    CHECK(t.size() == static_cast<size_t>(live.load()));
+}
+
+template<typename T, typename M>
+static void check_view(const T& t, const M& m) {
+    auto view = t.read_all();
+    CHECK(view.size() == m.size());
+    auto it = view.begin();
+    for (auto& [k, v] : m) {
+        CHECK(it != view.end() && it.key() == k && it.value() == v);
+        ++it;
+    }
+    CHECK(it == view.end());
+}
+
+// Probes around each shard's bounds and the sign change, plus draws
+template<typename K>
+static std::vector<K> probes(std::mt19937_64& rng, unsigned shards) {
+    using UK = std::make_unsigned_t<K>;
+    std::vector<K> ps = {std::numeric_limits<K>::min(), std::numeric_limits<K>::max(),
+                         K(0), K(-1), K(1)};
+    UK step = UK(UK(~UK(0)) / shards + 1);
+    for (unsigned i = 0; i < shards; ++i) {
+        UK b = UK(std::numeric_limits<K>::min()) + UK(step * i);
+        ps.push_back(K(b));
+        ps.push_back(K(UK(b - 1)));
+    }
+    for (int i = 0; i < 3000; ++i) ps.push_back(K(rng()));
+    return ps;
+}
+
+// Signed keys: shard_of's sign bias must put negatives first, so that
+// read_all() walks the keys in std::map order and its lookups agree
+template<typename K, unsigned SHARDS>
+static void signed_order_matches_map() {
+    std::mt19937_64 rng(43);
+    kntrie_sharded<K, int, SHARDS> t;
+    std::map<K, int> m;
+    auto ps = probes<K>(rng, SHARDS);
+    for (size_t i = 0; i < ps.size(); i += 2) {
+        t.insert(ps[i], int(i));
+        m.emplace(ps[i], int(i));
+    }
+    for (int i = 0; i < 20000; ++i) {
+        K k = K(rng() % 4 ? rng() : rng() % 512 - 256);
+        t.insert(k, i);
+        m.emplace(k, i);
+    }
+    check_view(t, m);
+
+    unsigned prev = 0;
+    for (auto& [k, v] : m) {
+        CHECK(t.shard_of(k) >= prev);
+        prev = t.shard_of(k);
+    }
+
+    auto view = t.read_all();
+    for (K k : ps) {
+        auto lo = view.lower_bound(k);
+        auto mlo = m.lower_bound(k);
+        CHECK(mlo == m.end() ? lo == view.end() : lo != view.end() && lo.key() == mlo->first);
+        auto up = view.upper_bound(k);
+        auto mup = m.upper_bound(k);
+        CHECK(mup == m.end() ? up == view.end() : up != view.end() && up.key() == mup->first);
+        auto f = view.find(k);
+        auto mf = m.find(k);
+        CHECK(mf == m.end() ? f == view.end() && !view.find_value(k)
+                            : f != view.end() && f.key() == k && f.value() == mf->second &&
+                              *view.find_value(k) == mf->second);
+    }
+}
+
+// Sorted batches running through several shards, each shard's run
+// applied under one lock, against std::map
+template<typename K, unsigned SHARDS>
+static void batches_span_shards() {
+    std::mt19937_64 rng(47);
+    kntrie_sharded<K, int, SHARDS> t;
+    std::map<K, int> m;
+    for (size_t n : {1, 5, 200, 6000, 30000}) {
+        std::vector<K> ks(n);
+        for (auto& k : ks) k = K(rng());
+        std::sort(ks.begin(), ks.end());
+        std::vector<int> vs(n);
+        for (size_t i = 0; i < n; ++i) vs[i] = int(i);
+        size_t want = 0;
+        for (size_t i = 0; i < n; ++i) want += m.emplace(ks[i], vs[i]).second;
+        CHECK(t.insert_sorted_batch(ks.data(), vs.data(), n) == want);
+        check_view(t, m);
+
+        // Erase every third key present plus some absent ones
+        std::vector<K> es;
+        size_t j = 0;
+        for (auto& [k, v] : m)
+            if (j++ % 3 == 0) es.push_back(k);
+        for (int i = 0; i < 100; ++i) es.push_back(K(rng()));
+        std::sort(es.begin(), es.end());
+        size_t gone = 0;
+        for (K k : es) gone += m.erase(k);
+        CHECK(t.erase_sorted_batch(es.data(), es.size()) == gone);
+        check_view(t, m);
+    }
+    CHECK(t.size() == m.size());
+}
+
+int main() {
+    writers(64, 20000);
+    writers(4000, 20000);
+    signed_order_matches_map<int64_t, 16>();
+    signed_order_matches_map<int32_t, 1>();
+    signed_order_matches_map<int16_t, 32>();
+    batches_span_shards<uint64_t, 16>();
+    batches_span_shards<int32_t, 8>();
+    batches_span_shards<int16_t, 32>();
+    std::puts("ok");
+}
@@ -0,0 +1,193 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// Snapshots keep their contents while the source trie changes, is
+// assigned over or is destroyed.
+
+using trie_t = kntrie<uint64_t, std::string>;
+
+static trie_t make(uint64_t n, uint64_t mul, const char* tag) {
+    trie_t t;
+    for (uint64_t i = 0; i < n; ++i)
+        t.insert(i * mul, tag + std::to_string(i));
+    return t;
+}
+
+template<typename SNAP>
+static void check_snap(const SNAP& s, uint64_t n, uint64_t mul, const char* tag) {
+    CHECK(s.size() == n);
+    uint64_t i = 0;
+    for (auto it = s.begin(); it != s.end(); ++it, ++i) {
+        CHECK(it.key() == i * mul);
+        CHECK(it.value() == tag + std::to_string(i));
+    }
+    CHECK(i == n);
+}
+
+static void writes_after_snapshot() {
+    trie_t t = make(5000, 7, "a");
+    auto s = t.snapshot();
+    for (uint64_t i = 0; i < 5000; i += 2) t.erase(i * 7);
+    for (uint64_t i = 0; i < 5000; ++i) t.insert_or_assign(i * 7 + 1, "b");
+    check_snap(s, 5000, 7, "a");
+}
+
+static void move_assign_over_snapshot() {
+    trie_t t = make(5000, 7, "a");
+    auto s = t.snapshot();
+    t = make(300, 3, "o");
+    check_snap(s, 5000, 7, "a");
+    t.insert(1, "x");
+    CHECK(t.size() == 301);
+}
+
+static void copy_assign_over_snapshot() {
+    trie_t t = make(5000, 7, "a");
+    trie_t other = make(300, 3, "o");
+    auto s = t.snapshot();
+    t = other;
+    check_snap(s, 5000, 7, "a");
+    CHECK(t.size() == 300);
+}
+
+static void destroy_source_first() {
+    auto* t = new trie_t(make(5000, 7, "a"));
+    auto s1 = t->snapshot();
+    t->erase(7);
+    auto s2 = t->snapshot();
+    delete t;
+    check_snap(s1, 5000, 7, "a");
+    CHECK(s2.size() == 4999);
+}
+
+template<typename T, typename M>
+static void check_same(const T& t, const M& m) {
+    CHECK(t.size() == m.size());
+    auto it = t.begin();
+    for (auto& [k, v] : m) {
+        CHECK(it.key() == k && it.value() == v);
+        ++it;
+    }
+}
+
+// Sorted batches and range erase against std::map, with snapshots
+// taken and dropped along the way. A few clusters of keys keep the
+// trie growing past a leaf and shrinking back into a coalesce.
+template<typename V, typename MAKE>
+static void batches_under_snapshots(MAKE make_v) {
+    using T = kntrie<uint64_t, V>;
+    using S = decltype(std::declval<T&>().snapshot());
+    std::mt19937_64 rng(17);
+    T t;
+    std::map<uint64_t, V> m;
+    std::vector<std::pair<S, std::map<uint64_t, V>>> snaps;
+    for (int round = 0; round < 400; ++round) {
+        if (round % 5 == 0) {
+            snaps.emplace_back(t.snapshot(), m);
+            if (snaps.size() > 3) snaps.erase(snaps.begin() + rng() % snaps.size());
+        }
+        auto draw = [&] { uint64_t r = rng(); return (r % 2) << 24 | (r >> 32) % 20000; };
+        size_t n = 1 + rng() % (round % 4 == 0 ? 4000 : 300);
+        std::vector<uint64_t> ks(n);
+        for (auto& k : ks) k = draw();
+        std::sort(ks.begin(), ks.end());
+        // Drift between a few hundred keys and a few leaves' worth
+        int op = m.size() < 3000 ? 0 : m.size() > 12000 ? 1 + rng() % 2 : rng() % 3;
+        switch (op) {
+        case 0: {
+            std::vector<V> vs;
+            for (size_t i = 0; i < n; ++i) vs.push_back(make_v(round));
+            t.insert_sorted_batch(ks.data(), vs.data(), n);
+            for (size_t i = 0; i < n; ++i) m.emplace(ks[i], vs[i]);
+            break;
+        }
+        case 1:
+            t.erase_sorted_batch(ks.data(), n);
+            for (auto k : ks) m.erase(k);
+            break;
+        default: {
+            uint64_t a = ks.front(), b = a + rng() % (uint64_t(1) << (rng() % 27));
+            t.erase(t.lower_bound(a), t.upper_bound(b));
+            m.erase(m.lower_bound(a), m.upper_bound(b));
+        }
+        }
+        check_same(t, m);
+        for (auto& [s, sm] : snaps) check_same(s, sm);
+    }
+}
+
+// Bulk erases that rebuild nodes the erase never descends into: a
+// coalesce gathers untouched leaves, a collapse re-prefixes the sole
+// child left. Those must be private copies, not the snapshot's nodes.
+static void bulk_erase_rebuilds() {
+    using T = kntrie<uint64_t, uint64_t>;
+    auto fill = [](T& t, uint64_t n, uint64_t hi) {
+        for (uint64_t i = 0; i < n; ++i) t.insert(hi | i, i);
+    };
+    auto churn = [](T& t) {  // reuse any block freed too early
+        for (uint64_t i = 0; i < 3000; ++i) t.insert(uint64_t(9) << 40 | i * 3, i);
+    };
+    auto intact = [](const auto& s, uint64_t n, uint64_t hi) {
+        for (uint64_t i = 0; i < n; ++i) CHECK(*s.find_value(hi | i) == i);
+    };
+    for (int shape = 0; shape < 4; ++shape) {
+        T t;
+        fill(t, 5000, 0);
+        uint64_t other = shape % 2 ? uint64_t(1) << 32 : 0;
+        if (other) fill(t, 300, other);
+        auto s = t.snapshot();
+        if (shape == 0) {         // range erase down to a coalesce
+            t.erase(t.lower_bound(300), t.upper_bound(4000));
+        } else if (shape == 1) {  // range erase down to one child
+            t.erase(t.lower_bound(0), t.upper_bound(4999));
+        } else if (shape == 2) {  // batch erase down to a coalesce
+            std::vector<uint64_t> ks;
+            for (uint64_t k = 300; k <= 4000; ++k) ks.push_back(k);
+            t.erase_sorted_batch(ks.data(), ks.size());
+        } else {                  // batch erase down to one child
+            std::vector<uint64_t> ks;
+            for (uint64_t k = 0; k < 5000; ++k) ks.push_back(k);
+            t.erase_sorted_batch(ks.data(), ks.size());
+        }
+        churn(t);
+        CHECK(s.size() == (other ? 5300u : 5000u));
+        intact(s, 5000, 0);
+        if (other) intact(s, 300, other);
+    }
+}
+
+// A small batch under a snapshot copies a path, not the trie
+static void batches_copy_paths_only() {
+    kntrie<uint64_t, uint64_t> t;
+    for (uint64_t i = 0; i < 200000; ++i) t.insert(i * 977, i);
+    size_t full = t.memory_usage();
+    auto s = t.snapshot();
+    uint64_t ks[] = {5 * 977, 5 * 977 + 1, 100000 * 977};
+    uint64_t vs[] = {1, 2, 3};
+    t.insert_sorted_batch(ks, vs, 3);
+    t.erase_sorted_batch(ks, 3);
+    t.erase(t.lower_bound(7000 * 977), t.upper_bound(9000 * 977));
+    CHECK(t.memory_usage() < full + full / 10);
+    CHECK(s.size() == 200000);
+}
+
+int main() {
+    writes_after_snapshot();
+    move_assign_over_snapshot();
+    copy_assign_over_snapshot();
+    destroy_source_first();
+    batches_under_snapshots<uint64_t>([](int r) { return uint64_t(r); });
+    batches_under_snapshots<std::string>([](int r) { return std::string(30, 's') + std::to_string(r); });
+    bulk_erase_rebuilds();
+    batches_copy_paths_only();
+    std::puts("ok");
+}
@@ -0,0 +1,40 @@
+#ifndef KNTRIE_TEST_UTIL_HPP
+#define KNTRIE_TEST_UTIL_HPP
+
+// Minimal checks for the tests/ programs. Each test is a standalone
+// program that exits non-zero on the first failed CHECK; run.sh builds
+// and runs them all with ASan/UBSan.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n",           \
+                         __FILE__, __LINE__, #cond);                    \
+            std::exit(1);                                               \
+        }                                                               \
+    } while (0)
+
+// Key mixes for differential tests. Modes 0-2 reach every insert
+// shape: new leaves, prefix and chain splits, leaf overflow. Mode 3
+// keeps every key under one top byte, so the root has a prefix that
+// other keys fall outside.
+inline constexpr int DRAW_MODES = 4;
+
+template<typename K>
+inline K draw(std::mt19937_64& rng, int mode) {
+    uint64_t r = rng();
+    switch (mode) {
+    case 0:  return static_cast<K>(r);                   // sparse
+    case 1:  return static_cast<K>(r % 512);             // dense
+    case 2:  return static_cast<K>((r % 8) << 20 | (r >> 40) % 300);  // clusters
+    default: return static_cast<K>(uint64_t(0xA5) << (8 * sizeof(K) - 8) |
+                                   (r % 20000 & ~uint64_t(0) >> (72 - 8 * sizeof(K))));
+    }
+}
+
+#endif // KNTRIE_TEST_UTIL_HPP
@@ -0,0 +1,188 @@
+#include "kntrie.hpp"
+#include "test_util.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace gteitelbaum;
+
+// Out-of-line values: construction, assignment and destruction.
+
+static void assign_from_own_value() {
+    kntrie<uint64_t, std::string> t;
+    for (uint64_t i = 0; i < 100; ++i)
+        t.insert(i, std::string(40, char('a' + i % 26)) + std::to_string(i));
+    for (uint64_t i = 0; i < 100; ++i) {
+        std::string want = *t.find_value(i);
+        t.insert_or_assign(i, *t.find_value(i));
+        CHECK(*t.find_value(i) == want);
+        t.assign(i, *t.find_value(i));
+        CHECK(*t.find_value(i) == want);
+    }
+    CHECK(t.size() == 100);
+}
+
+static void insert_from_other_value() {
+    kntrie<uint64_t, std::string> t;
+    t.insert(1, std::string(64, 'x'));
+    for (uint64_t i = 2; i < 3000; ++i)
+        t.insert(i, *t.find_value(i - 1));
+    CHECK(*t.find_value(2999) == std::string(64, 'x'));
+}
+
+template<typename V>
+static void aligned_out_of_line() {
+    kntrie<uint64_t, V> t;
+    for (uint64_t i = 0; i < 20000; ++i) {
+        t.insert(i * 13, V{});
+        if (i % 3 == 0) t.erase(i * 13 - 26);  // reuse freed blocks
+    }
+    for (auto it = t.begin(); it != t.end(); ++it)
+        CHECK(reinterpret_cast<std::uintptr_t>(&it.value()) % alignof(V) == 0);
+}
+
+struct alignas(32) wide_t { double d[4]; };
+
+// Copies throw once copies_left runs out; live counts every instance
+struct fragile_t {
+    static inline long live = 0;
+    static inline long copies_left = -1;
+    std::string s;
+    explicit fragile_t(std::string v) : s(std::move(v)) { ++live; }
+    fragile_t(const fragile_t& o) : s(o.s) {
+        if (copies_left == 0) throw std::runtime_error("copy");
+        if (copies_left > 0) --copies_left;
+        ++live;
+    }
+    fragile_t& operator=(const fragile_t&) = default;
+    ~fragile_t() { --live; }
+};
+
+// A bulk build whose value copy throws frees everything it built and
+// leaves the trie empty and usable
+static void assign_sorted_throws() {
+    std::vector<std::pair<uint64_t, fragile_t>> src;
+    for (uint64_t i = 0; i < 30000; ++i)
+        src.emplace_back(i * 5, fragile_t(std::to_string(i)));
+    long base = fragile_t::live;
+    for (long at : {0L, 1L, 4095L, 4096L, 20000L, 29999L}) {
+        kntrie<uint64_t, fragile_t> t;
+        t.insert(3, fragile_t("old"));
+        fragile_t::copies_left = at;
+        bool threw = false;
+        try {
+            t.assign_sorted(src.begin(), src.end());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        fragile_t::copies_left = -1;
+        CHECK(threw);
+        CHECK(t.size() == 0 && t.begin() == t.end());
+        CHECK(fragile_t::live == base);
+        t.insert(7, fragile_t("new"));
+        CHECK(t.find_value(7)->s == "new" && !t.find_value(3));
+    }
+    kntrie<uint64_t, fragile_t> t;
+    t.assign_sorted(src.begin(), src.end());
+    CHECK(t.size() == src.size() && t.find_value(29999 * 5)->s == "29999");
+}
+
+// A batch merged into a leaf whose value copy throws frees the copies
+// it made and leaves the leaf as it was
+static void insert_batch_throws() {
+    std::vector<uint64_t> ks;
+    std::vector<fragile_t> vs;
+    for (uint64_t i = 0; i < 300; ++i) {
+        ks.push_back(i * 2);
+        vs.emplace_back(std::to_string(i));
+    }
+    long base = fragile_t::live;
+    for (long at : {0L, 1L, 120L, 199L}) {  // 200 keys are new
+        kntrie<uint64_t, fragile_t> t;
+        for (uint64_t i = 0; i < 100; ++i) t.insert(i * 3, fragile_t("old"));
+        fragile_t::copies_left = at;
+        bool threw = false;
+        try {
+            t.insert_sorted_batch(ks.data(), vs.data(), ks.size());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        fragile_t::copies_left = -1;
+        CHECK(threw && t.size() == 100);
+        CHECK(fragile_t::live == base + 100);
+        for (uint64_t i = 0; i < 300; ++i)
+            CHECK(!t.find_value(i) == (i % 3 != 0));
+    }
+}
+
+// memory_usage() counts exactly the blocks debug_stats() walks, plus
+// per_value bytes for each out-of-line value
+template<typename V>
+static void memory_matches_stats(size_t per_value) {
+    std::mt19937_64 rng(11);
+    for (int mode = 0; mode < DRAW_MODES; ++mode) {
+        kntrie<uint64_t, V> t;
+        auto matches = [&] {
+            return t.memory_usage() == t.debug_stats().total_bytes + t.size() * per_value;
+        };
+        CHECK(matches());
+        std::vector<uint64_t> keys;
+        for (int i = 0; i < 20000; ++i) {
+            keys.push_back(draw<uint64_t>(rng, mode));
+            t.insert(keys.back(), V{});
+        }
+        CHECK(matches());
+        for (size_t i = 0; i < keys.size(); i += 2) t.erase(keys[i]);
+        CHECK(matches());
+        for (uint64_t k : keys) t.erase(k);
+        CHECK(t.empty() && matches());
+    }
+}
+
+// upsert calls make_fn once per inserted key and never on a hit
+template<typename V, typename AGG = no_aggregate_t>
+static void upsert_makes_on_miss_only(V made, V updated) {
+    kntrie<uint64_t, V, std::allocator<uint64_t>, AGG> t;
+    long makes = 0, updates = 0;
+    auto make = [&] { ++makes; return made; };
+    auto update = [&](V& v) { ++updates; v = updated; };
+    for (uint64_t i = 0; i < 3000; ++i)
+        CHECK(t.upsert(i * 7, make, update).second);
+    CHECK(makes == 3000 && updates == 0);
+    for (uint64_t i = 0; i < 6000; ++i)
+        CHECK(t.upsert(i * 7, make, update).second == (i >= 3000));
+    CHECK(makes == 6000 && updates == 3000 && t.size() == 6000);
+    for (uint64_t i = 0; i < 6000; ++i)
+        CHECK(*t.find_value(i * 7) == (i < 3000 ? updated : made));
+
+    // A make_fn that throws leaves nothing behind
+    bool threw = false;
+    try {
+        t.upsert(5, [&]() -> V { throw std::runtime_error("make"); }, update);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw && !t.find_value(5) && t.size() == 6000);
+}
+
+int main() {
+    assign_from_own_value();
+    insert_from_other_value();
+    aligned_out_of_line<long double>();
+    aligned_out_of_line<wide_t>();
+    assign_sorted_throws();
+    insert_batch_throws();
+    memory_matches_stats<uint64_t>(0);
+    memory_matches_stats<bool>(0);
+    memory_matches_stats<std::string>(block_u64(sizeof(std::string) / 8) * 8);
+    memory_matches_stats<wide_t>(sizeof(wide_t));
+    upsert_makes_on_miss_only<uint64_t>(1, 2);
+    upsert_makes_on_miss_only<bool>(true, false);
+    upsert_makes_on_miss_only<std::string>(std::string(40, 'm'), "u");
+    upsert_makes_on_miss_only<uint64_t, sum_aggregate_t<uint64_t>>(1, 2);
+    std::puts("ok");
+}